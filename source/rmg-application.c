@@ -88,6 +88,7 @@ RmgApplication *
 rmg_application_new (const gchar *config, GError **error)
 {
   RmgApplication *app = g_new0 (RmgApplication, 1);
+  glong pool_capacity;
 
   g_assert (app);
   g_assert (error);
@@ -100,6 +101,10 @@ rmg_application_new (const gchar *config, GError **error)
   /* construct options noexept */
   app->options = rmg_options_new (config);
 
+  /* the crash path allocates no dispatcher events once the pool is warm */
+  pool_capacity = rmg_options_long_for (app->options, KEY_EVENT_POOL_CAPACITY);
+  rmg_devent_init_pool ((guint)CLAMP (pool_capacity, 0, G_MAXUINT16));
+
   /* construct journal and return if an error is set */
   app->journal = rmg_journal_new (app->options, error);
   if (*error != NULL)
@@ -130,7 +135,7 @@ rmg_application_new (const gchar *config, GError **error)
   rmg_monitor_build_proxy (app->monitor);
   rmg_monitor_read_services (app->monitor);
 
-  app->checker = rmg_checker_new (app->journal, app->options);
+  app->checker = rmg_checker_new (app->journal, app->options, app->dispatcher);
   rmg_checker_check_services (app->checker);
 
   /* rmg-monitor builds the dbus proxy and we register a callback to get it for
@@ -142,8 +147,28 @@ rmg_application_new (const gchar *config, GError **error)
 
   if (g_run_mode == RUN_MODE_PRIMARY)
     {
-      app->crashmonitor = rmg_crashmonitor_new (app->dispatcher);
-      rmg_crashmonitor_build_proxy (app->crashmonitor);
+      g_autofree gchar *crash_source = rmg_options_string_for (app->options, KEY_CRASH_SOURCE);
+
+      if (g_strcmp0 (crash_source, "netlink") == 0)
+        {
+          g_autoptr (GError) proccon_error = NULL;
+
+          app->proccon = rmg_proccon_new (app->dispatcher, &proccon_error);
+          if (proccon_error != NULL)
+            g_warning ("Fail to create proc connector, fallback to D-Bus crash source. Error %s",
+                       proccon_error->message);
+          else
+            {
+              g_info ("Process crash source using the proc connector");
+              rmg_proccon_set_monitor (app->proccon, app->monitor);
+            }
+        }
+
+      if (app->proccon == NULL)
+        {
+          app->crashmonitor = rmg_crashmonitor_new (app->dispatcher);
+          rmg_crashmonitor_build_proxy (app->crashmonitor);
+        }
     }
 
   /* construct mainloop noexept */
@@ -188,9 +213,16 @@ rmg_application_unref (RmgApplication *app)
       if (app->crashmonitor != NULL)
         rmg_crashmonitor_unref (app->crashmonitor);
 
+      if (app->proccon != NULL)
+        rmg_proccon_unref (app->proccon);
+
       if (app->mainloop != NULL)
         g_main_loop_unref (app->mainloop);
 
+      /* the pools are process wide and report their counters once all owners are gone */
+      rmg_executor_release_pool ();
+      rmg_devent_release_pool ();
+
       g_free (app);
     }
 }
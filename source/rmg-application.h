@@ -32,6 +32,7 @@
 #include "rmg-logging.h"
 #include "rmg-monitor.h"
 #include "rmg-options.h"
+#include "rmg-proccon.h"
 #include "rmg-sdnotify.h"
 #include "rmg-types.h"
 
@@ -54,6 +55,7 @@ typedef struct _RmgApplication
   RmgDispatcher *dispatcher;
   RmgExecutor *executor;
   RmgCrashMonitor *crashmonitor;
+  RmgProcCon *proccon;
   GMainLoop *mainloop;
   grefcount rc;
 } RmgApplication;
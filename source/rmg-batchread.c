@@ -0,0 +1,445 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-batchread.c
+ */
+
+#include "rmg-batchread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef WITH_IO_URING
+#include <sys/eventfd.h>
+#endif
+
+/**
+ * @brief Files read per main loop iteration without io_uring
+ */
+#define RMG_BATCHREAD_CHUNK (32)
+
+#ifdef WITH_IO_URING
+/**
+ * @brief Ring completions carry the slot index and the operation in user data
+ */
+#define RMG_BATCHREAD_OP_BITS (2)
+#define RMG_BATCHREAD_OP_OPEN (0)
+#define RMG_BATCHREAD_OP_READ (1)
+#define RMG_BATCHREAD_OP_CLOSE (2)
+#endif
+
+/**
+ * @struct RmgBatchReadRequest
+ * @brief A file to read
+ */
+typedef struct _RmgBatchReadRequest
+{
+  gchar *path;  /**< File path */
+  gpointer tag; /**< Caller tag */
+} RmgBatchReadRequest;
+
+/**
+ * @brief GSource dispatch function
+ */
+static gboolean batchread_source_dispatch (GSource *source, GSourceFunc callback,
+                                           gpointer _batch);
+
+/**
+ * @brief GSource destroy notification callback function
+ */
+static void batchread_source_destroy_notify (gpointer _batch);
+
+/**
+ * @brief GSourceFuncs vtable
+ */
+static GSourceFuncs batchread_source_funcs = {
+  NULL, NULL, batchread_source_dispatch, NULL, NULL, NULL,
+};
+
+static void
+request_clear (gpointer _request)
+{
+  RmgBatchReadRequest *request = (RmgBatchReadRequest *)_request;
+
+  g_free (request->path);
+}
+
+static void
+slot_complete (RmgBatchRead *batch, guint index)
+{
+  RmgBatchReadSlot *slot = &batch->slots[index];
+  RmgBatchReadRequest *request
+      = &g_array_index (batch->requests, RmgBatchReadRequest, slot->request);
+
+  if (slot->error == 0 && slot->length >= 0)
+    {
+      slot->buffer[slot->length] = '\0';
+      batch->callback (request->tag, slot->buffer, (gsize)slot->length, 0, batch->user_data);
+    }
+  else
+    batch->callback (request->tag, NULL, 0, slot->error, batch->user_data);
+
+  batch->free_slots[batch->free_count++] = index;
+  batch->completed++;
+}
+
+static void
+slot_read (RmgBatchRead *batch, RmgBatchReadSlot *slot)
+{
+  RmgBatchReadRequest *request
+      = &g_array_index (batch->requests, RmgBatchReadRequest, slot->request);
+  gint fd;
+
+  slot->error = 0;
+  slot->length = -1;
+
+  fd = open (request->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    slot->error = errno;
+  else
+    {
+      slot->length = read (fd, slot->buffer, RMG_BATCHREAD_BUFFER_SIZE - 1);
+      if (slot->length < 0)
+        slot->error = errno;
+
+      close (fd);
+    }
+}
+
+static void
+read_sequential (RmgBatchRead *batch)
+{
+  for (guint i = 0; i < RMG_BATCHREAD_CHUNK && batch->next < batch->requests->len; i++)
+    {
+      RmgBatchReadSlot *slot = &batch->slots[0];
+
+      batch->free_count--;
+      slot->request = batch->next++;
+
+      slot_read (batch, slot);
+      slot_complete (batch, 0);
+    }
+}
+
+static void
+read_sequential_start (RmgBatchRead *batch)
+{
+  /* sequential reads run in chunks whenever the main loop is idle */
+  g_source_set_priority (RMG_EVENT_SOURCE (batch), G_PRIORITY_DEFAULT_IDLE);
+  g_source_set_ready_time (RMG_EVENT_SOURCE (batch), 0);
+}
+
+#ifdef WITH_IO_URING
+static gboolean
+ring_init (RmgBatchRead *batch)
+{
+  gint r;
+
+  /* each file takes an open, a read and a close entry */
+  r = io_uring_queue_init (RMG_BATCHREAD_SLOTS * 3, &batch->ring, 0);
+  if (r < 0)
+    {
+      g_debug ("Batched reads without io_uring. Error %s", g_strerror (-r));
+      return FALSE;
+    }
+
+  /* files are opened in the registered table and never get a process descriptor */
+  r = io_uring_register_files_sparse (&batch->ring, RMG_BATCHREAD_SLOTS);
+  if (r < 0)
+    {
+      g_debug ("Batched reads without io_uring direct descriptors. Error %s", g_strerror (-r));
+      io_uring_queue_exit (&batch->ring);
+      return FALSE;
+    }
+
+  batch->event_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (batch->event_fd < 0 || io_uring_register_eventfd (&batch->ring, batch->event_fd) < 0)
+    {
+      g_debug ("Batched reads without io_uring completion events");
+
+      if (batch->event_fd >= 0)
+        close (batch->event_fd);
+
+      batch->event_fd = -1;
+      io_uring_queue_exit (&batch->ring);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+ring_fallback (RmgBatchRead *batch)
+{
+  /* the ring is released first so no completion lands in a buffer read again below */
+  g_source_remove_unix_fd (RMG_EVENT_SOURCE (batch), batch->tag);
+  io_uring_queue_exit (&batch->ring);
+  close (batch->event_fd);
+
+  batch->tag = NULL;
+  batch->event_fd = -1;
+  batch->uring = FALSE;
+
+  /* the reads queued or in flight on the ring are done again */
+  for (guint i = 0; i < RMG_BATCHREAD_SLOTS; i++)
+    {
+      RmgBatchReadSlot *slot = &batch->slots[i];
+
+      if (slot->pending == 0)
+        continue;
+
+      slot->pending = 0;
+      slot_read (batch, slot);
+      slot_complete (batch, i);
+    }
+
+  /* the remaining requests continue with the sequential reads */
+  read_sequential_start (batch);
+}
+
+static void
+ring_submit (RmgBatchRead *batch)
+{
+  guint queued = 0;
+
+  while (batch->free_count > 0 && batch->next < batch->requests->len)
+    {
+      RmgBatchReadRequest *request
+          = &g_array_index (batch->requests, RmgBatchReadRequest, batch->next);
+      guint index = batch->free_slots[--batch->free_count];
+      RmgBatchReadSlot *slot = &batch->slots[index];
+      guint64 data = (guint64)index << RMG_BATCHREAD_OP_BITS;
+      struct io_uring_sqe *sqe = NULL;
+
+      slot->request = batch->next++;
+      slot->pending = 3;
+      slot->error = 0;
+      slot->length = -1;
+
+      /* a failed open cancels the read, the close always runs to release the slot */
+      sqe = io_uring_get_sqe (&batch->ring);
+      io_uring_prep_openat_direct (sqe, AT_FDCWD, request->path, O_RDONLY | O_CLOEXEC, 0, index);
+      io_uring_sqe_set_data64 (sqe, data | RMG_BATCHREAD_OP_OPEN);
+      sqe->flags |= IOSQE_IO_LINK;
+
+      sqe = io_uring_get_sqe (&batch->ring);
+      io_uring_prep_read (sqe, (gint)index, slot->buffer, RMG_BATCHREAD_BUFFER_SIZE - 1, 0);
+      io_uring_sqe_set_data64 (sqe, data | RMG_BATCHREAD_OP_READ);
+      sqe->flags |= IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+
+      sqe = io_uring_get_sqe (&batch->ring);
+      io_uring_prep_close_direct (sqe, index);
+      io_uring_sqe_set_data64 (sqe, data | RMG_BATCHREAD_OP_CLOSE);
+
+      queued++;
+    }
+
+  if (queued > 0)
+    {
+      gint r = io_uring_submit (&batch->ring);
+
+      if (r < 0)
+        {
+          g_warning ("Fail to submit batched reads, fallback to sequential reads. Error %s",
+                     g_strerror (-r));
+          ring_fallback (batch);
+        }
+    }
+}
+
+static void
+ring_reap (RmgBatchRead *batch)
+{
+  struct io_uring_cqe *cqe = NULL;
+  guint64 count;
+
+  /* the counter only wakes the main loop, the ring holds the completions */
+  if (read (batch->event_fd, &count, sizeof (count)) < 0 && errno != EAGAIN)
+    g_warning ("Fail to read batched reads eventfd. Error %s", g_strerror (errno));
+
+  while (io_uring_peek_cqe (&batch->ring, &cqe) == 0)
+    {
+      guint64 data = io_uring_cqe_get_data64 (cqe);
+      guint index = (guint)(data >> RMG_BATCHREAD_OP_BITS);
+      guint op = (guint)(data & ((1 << RMG_BATCHREAD_OP_BITS) - 1));
+      RmgBatchReadSlot *slot = &batch->slots[index];
+
+      if (op == RMG_BATCHREAD_OP_READ && cqe->res >= 0)
+        slot->length = cqe->res;
+      else if (op != RMG_BATCHREAD_OP_CLOSE && cqe->res < 0 && slot->error == 0)
+        slot->error = -cqe->res;
+
+      io_uring_cqe_seen (&batch->ring, cqe);
+
+      if (--slot->pending == 0)
+        slot_complete (batch, index);
+    }
+}
+#endif
+
+static gboolean
+batchread_source_dispatch (GSource *source, GSourceFunc callback, gpointer _batch)
+{
+  RmgBatchRead *batch = (RmgBatchRead *)source;
+
+  RMG_UNUSED (callback);
+  RMG_UNUSED (_batch);
+
+#ifdef WITH_IO_URING
+  if (batch->uring)
+    {
+      ring_reap (batch);
+      ring_submit (batch);
+    }
+  else
+#endif
+    read_sequential (batch);
+
+  if (batch->completed < batch->requests->len)
+    return G_SOURCE_CONTINUE;
+
+  if (batch->done != NULL)
+    batch->done (batch->user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+batchread_source_destroy_notify (gpointer _batch)
+{
+  RmgBatchRead *batch = (RmgBatchRead *)_batch;
+
+  g_assert (batch);
+  g_debug ("BatchRead destroy notification");
+
+  rmg_batchread_unref (batch);
+}
+
+RmgBatchRead *
+rmg_batchread_new (RmgBatchReadCallback callback, RmgBatchReadDone done, gpointer user_data,
+                   GDestroyNotify user_data_destroy)
+{
+  RmgBatchRead *batch = NULL;
+
+  g_assert (callback);
+
+  batch = (RmgBatchRead *)g_source_new (&batchread_source_funcs, sizeof (RmgBatchRead));
+
+  g_assert (batch);
+
+  g_ref_count_init (&batch->rc);
+
+  batch->requests = g_array_new (FALSE, FALSE, sizeof (RmgBatchReadRequest));
+  g_array_set_clear_func (batch->requests, request_clear);
+
+  batch->callback = callback;
+  batch->done = done;
+  batch->user_data = user_data;
+  batch->user_data_destroy = user_data_destroy;
+
+#ifdef WITH_IO_URING
+  batch->event_fd = -1;
+#endif
+
+  return batch;
+}
+
+RmgBatchRead *
+rmg_batchread_ref (RmgBatchRead *batch)
+{
+  g_assert (batch);
+  g_ref_count_inc (&batch->rc);
+  return batch;
+}
+
+void
+rmg_batchread_unref (RmgBatchRead *batch)
+{
+  g_assert (batch);
+
+  if (g_ref_count_dec (&batch->rc) == TRUE)
+    {
+#ifdef WITH_IO_URING
+      if (batch->uring)
+        {
+          io_uring_queue_exit (&batch->ring);
+          close (batch->event_fd);
+        }
+#endif
+
+      for (guint i = 0; i < RMG_BATCHREAD_SLOTS; i++)
+        g_free (batch->slots[i].buffer);
+
+      if (batch->user_data_destroy != NULL)
+        batch->user_data_destroy (batch->user_data);
+
+      g_array_free (batch->requests, TRUE);
+      g_source_unref (RMG_EVENT_SOURCE (batch));
+    }
+}
+
+void
+rmg_batchread_add (RmgBatchRead *batch, const gchar *path, gpointer tag)
+{
+  RmgBatchReadRequest request = { .path = g_strdup (path), .tag = tag };
+
+  g_assert (batch);
+  g_assert (path);
+
+  g_array_append_val (batch->requests, request);
+}
+
+void
+rmg_batchread_submit (RmgBatchRead *batch)
+{
+  guint slots = 1;
+
+  g_assert (batch);
+
+#ifdef WITH_IO_URING
+  batch->uring = ring_init (batch);
+  if (batch->uring)
+    slots = RMG_BATCHREAD_SLOTS;
+#endif
+
+  for (guint i = 0; i < slots; i++)
+    {
+      batch->slots[i].buffer = g_malloc (RMG_BATCHREAD_BUFFER_SIZE);
+      batch->free_slots[batch->free_count++] = slots - 1 - i;
+    }
+
+  g_source_set_callback (RMG_EVENT_SOURCE (batch), NULL, batch, batchread_source_destroy_notify);
+
+#ifdef WITH_IO_URING
+  if (batch->uring)
+    {
+      batch->tag = g_source_add_unix_fd (RMG_EVENT_SOURCE (batch), batch->event_fd, G_IO_IN);
+      ring_submit (batch);
+    }
+  else
+#endif
+    read_sequential_start (batch);
+
+  /* an empty batch completes on the first dispatch */
+  if (batch->requests->len == 0)
+    g_source_set_ready_time (RMG_EVENT_SOURCE (batch), 0);
+
+  g_source_attach (RMG_EVENT_SOURCE (batch), NULL);
+}
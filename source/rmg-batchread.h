@@ -0,0 +1,141 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-batchread.h
+ */
+
+#pragma once
+
+#include "rmg-types.h"
+
+#include <glib.h>
+#ifdef WITH_IO_URING
+#include <liburing.h>
+#endif
+
+G_BEGIN_DECLS
+
+/**
+ * @brief Number of files read concurrently
+ */
+#define RMG_BATCHREAD_SLOTS (64)
+
+/**
+ * @brief Maximum content read from each file, longer files are truncated
+ */
+#define RMG_BATCHREAD_BUFFER_SIZE (4096)
+
+/**
+ * @brief Called for each file read
+ * @param tag The tag the file was added with
+ * @param content The nul terminated file content or NULL on error
+ * @param length The content length
+ * @param error The errno value if the file was not read, 0 otherwise
+ * @param user_data The batch user data
+ */
+typedef void (*RmgBatchReadCallback) (gpointer tag, const gchar *content, gsize length, gint error,
+                                      gpointer user_data);
+
+/**
+ * @brief Called once all files were read
+ * @param user_data The batch user data
+ */
+typedef void (*RmgBatchReadDone) (gpointer user_data);
+
+/**
+ * @struct RmgBatchReadSlot
+ * @brief A file read in progress
+ */
+typedef struct _RmgBatchReadSlot
+{
+  guint request; /**< Index of the request using the slot */
+  guint pending; /**< Operations of the request not completed */
+  gssize length; /**< Bytes read */
+  gint error;    /**< First operation error */
+  gchar *buffer; /**< Content buffer of RMG_BATCHREAD_BUFFER_SIZE */
+} RmgBatchReadSlot;
+
+/**
+ * @struct RmgBatchRead
+ * @brief Batched reader of small procfs and cgroupfs files
+ */
+typedef struct _RmgBatchRead
+{
+  GSource source;                              /**< Event loop source */
+  gpointer tag;                                /**< Ring completion eventfd tag */
+  GArray *requests;                            /**< Files to read */
+  guint next;                                  /**< Next request to start */
+  guint completed;                             /**< Requests completed */
+  RmgBatchReadSlot slots[RMG_BATCHREAD_SLOTS]; /**< Reads in progress */
+  guint free_slots[RMG_BATCHREAD_SLOTS];       /**< Stack of unused slot indexes */
+  guint free_count;                            /**< Unused slots */
+  RmgBatchReadCallback callback;               /**< Per file callback */
+  RmgBatchReadDone done;                       /**< Completion callback */
+  gpointer user_data;                          /**< Data passed to the callbacks */
+  GDestroyNotify user_data_destroy;            /**< Release of user_data */
+#ifdef WITH_IO_URING
+  struct io_uring ring; /**< Submission ring */
+  gboolean uring;       /**< The ring is available, sequential reads are used otherwise */
+  gint event_fd;        /**< Eventfd signaled on ring completions */
+#endif
+  grefcount rc; /**< Reference counter variable  */
+} RmgBatchRead;
+
+/*
+ * @brief Create a new batched reader
+ * @param callback Called for each file read
+ * @param done Called once all files were read
+ * @param user_data Data passed to the callbacks
+ * @param user_data_destroy Called with user_data when the batch is released
+ * @return A new RmgBatchRead object
+ */
+RmgBatchRead *rmg_batchread_new (RmgBatchReadCallback callback, RmgBatchReadDone done,
+                                 gpointer user_data, GDestroyNotify user_data_destroy);
+
+/**
+ * @brief Aquire batched reader object
+ * @param batch Pointer to the batched reader object
+ */
+RmgBatchRead *rmg_batchread_ref (RmgBatchRead *batch);
+
+/**
+ * @brief Release batched reader object
+ * @param batch Pointer to the batched reader object
+ */
+void rmg_batchread_unref (RmgBatchRead *batch);
+
+/**
+ * @brief Add a file to read
+ * @param batch Pointer to the batched reader object
+ * @param path The file path
+ * @param tag Passed back to the callback with the file content
+ */
+void rmg_batchread_add (RmgBatchRead *batch, const gchar *path, gpointer tag);
+
+/**
+ * @brief Start reading the files from the main loop
+ * The caller reference is passed to the batch which releases itself once done
+ * @param batch Pointer to the batched reader object
+ */
+void rmg_batchread_submit (RmgBatchRead *batch);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgBatchRead, rmg_batchread_unref);
+
+G_END_DECLS
@@ -0,0 +1,398 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-cgwatch.c
+ */
+
+#include "rmg-cgwatch.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define RMG_CGROUP_ROOT "/sys/fs/cgroup"
+#define RMG_CGWATCH_BUFFER_SIZE (4096)
+
+extern const gchar *sd_dbus_name;
+
+/**
+ * @brief GSource prepare function
+ */
+static gboolean cgwatch_source_prepare (GSource *source, gint *timeout);
+
+/**
+ * @brief GSource dispatch function
+ */
+static gboolean cgwatch_source_dispatch (GSource *source, GSourceFunc callback, gpointer _cgwatch);
+
+/**
+ * @brief GSource destroy notification callback function
+ */
+static void cgwatch_source_destroy_notify (gpointer _cgwatch);
+
+/**
+ * @brief Add inotify watches for the entry cgroup files
+ */
+static void cgwatch_entry_arm (RmgCGWatch *cgwatch, RmgCGWatchEntry *entry);
+
+/**
+ * @brief GSourceFuncs vtable
+ */
+static GSourceFuncs cgwatch_source_funcs = {
+  cgwatch_source_prepare, NULL, cgwatch_source_dispatch, NULL, NULL, NULL,
+};
+
+static gboolean
+read_event_value (const gchar *cgroup_path, const gchar *file_name, const gchar *key,
+                  guint64 *value)
+{
+  g_autofree gchar *path = g_build_filename (cgroup_path, file_name, NULL);
+  g_autofree gchar *content = NULL;
+  gsize key_len = strlen (key);
+  gboolean found = FALSE;
+  gchar **lines = NULL;
+
+  if (!g_file_get_contents (path, &content, NULL, NULL))
+    return FALSE;
+
+  lines = g_strsplit (content, "\n", -1);
+
+  for (gint i = 0; lines[i] != NULL && !found; i++)
+    {
+      /* lines are "key value" so the separator makes the key match exact */
+      if (strncmp (lines[i], key, key_len) == 0 && lines[i][key_len] == ' ')
+        {
+          *value = g_ascii_strtoull (lines[i] + key_len + 1, NULL, 10);
+          found = TRUE;
+        }
+    }
+
+  g_strfreev (lines);
+
+  return found;
+}
+
+static void
+cgwatch_entry_disarm (RmgCGWatch *cgwatch, RmgCGWatchEntry *entry)
+{
+  if (entry->events_wd >= 0)
+    {
+      g_hash_table_remove (cgwatch->watches, GINT_TO_POINTER (entry->events_wd));
+      inotify_rm_watch (cgwatch->inotify_fd, entry->events_wd);
+      entry->events_wd = -1;
+    }
+
+  if (entry->memory_wd >= 0)
+    {
+      g_hash_table_remove (cgwatch->watches, GINT_TO_POINTER (entry->memory_wd));
+      inotify_rm_watch (cgwatch->inotify_fd, entry->memory_wd);
+      entry->memory_wd = -1;
+    }
+}
+
+static void
+cgwatch_entry_changed (RmgCGWatchEntry *entry, gint wd)
+{
+  guint64 value = 0;
+
+  if (wd == entry->events_wd)
+    {
+      if (!read_event_value (entry->cgroup_path, "cgroup.events", "populated", &value))
+        return;
+
+      if (entry->populated && value == 0)
+        rmg_mentry_provisional_crash (entry->mentry, "cgroup empty");
+
+      entry->populated = (value != 0);
+    }
+  else if (wd == entry->memory_wd)
+    {
+      if (!read_event_value (entry->cgroup_path, "memory.events", "oom_kill", &value))
+        return;
+
+      if (value > entry->oom_kills)
+        {
+          rmg_mentry_set_result (entry->mentry, "oom-kill");
+          rmg_mentry_provisional_crash (entry->mentry, "oom kill");
+        }
+
+      entry->oom_kills = value;
+    }
+}
+
+static gboolean
+cgwatch_source_prepare (GSource *source, gint *timeout)
+{
+  RMG_UNUSED (source);
+  *timeout = -1;
+  return FALSE;
+}
+
+static gboolean
+cgwatch_source_dispatch (GSource *source, GSourceFunc callback, gpointer _cgwatch)
+{
+  RmgCGWatch *cgwatch = (RmgCGWatch *)source;
+  gchar buf[RMG_CGWATCH_BUFFER_SIZE]
+      __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+  gssize len;
+
+  RMG_UNUSED (callback);
+  RMG_UNUSED (_cgwatch);
+
+  while ((len = read (cgwatch->inotify_fd, buf, sizeof (buf))) > 0)
+    {
+      for (gchar *ptr = buf; ptr < buf + len;)
+        {
+          const struct inotify_event *ievent = (const struct inotify_event *)(gpointer)ptr;
+          RmgCGWatchEntry *entry
+              = g_hash_table_lookup (cgwatch->watches, GINT_TO_POINTER (ievent->wd));
+
+          ptr += sizeof (struct inotify_event) + ievent->len;
+
+          if (entry == NULL)
+            continue;
+
+          if ((ievent->mask & IN_IGNORED) != 0)
+            {
+              /* the cgroup was removed with the unit stop, rearm on next start */
+              g_hash_table_remove (cgwatch->watches, GINT_TO_POINTER (ievent->wd));
+
+              if (ievent->wd == entry->events_wd)
+                entry->events_wd = -1;
+              else if (ievent->wd == entry->memory_wd)
+                entry->memory_wd = -1;
+
+              continue;
+            }
+
+          cgwatch_entry_changed (entry, ievent->wd);
+        }
+    }
+
+  if (len < 0 && errno != EAGAIN)
+    g_warning ("Fail to read cgroup events. Error %s", g_strerror (errno));
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+cgwatch_source_destroy_notify (gpointer _cgwatch)
+{
+  RmgCGWatch *cgwatch = (RmgCGWatch *)_cgwatch;
+
+  g_assert (cgwatch);
+  g_debug ("CGWatch destroy notification");
+
+  rmg_cgwatch_unref (cgwatch);
+}
+
+static void
+control_group_ready_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgCGWatchEntry *entry = (RmgCGWatchEntry *)user_data;
+  RmgCGWatch *cgwatch = (RmgCGWatch *)entry->cgwatch;
+  g_autoptr (GVariant) response = NULL;
+  g_autoptr (GVariant) value = NULL;
+  g_autoptr (GError) error = NULL;
+
+  entry->resolving = FALSE;
+
+  response = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &error);
+  if (error != NULL)
+    {
+      g_warning ("Fail to read ControlGroup for service '%s'. Error %s",
+                 entry->mentry->service_name, error->message);
+    }
+  else
+    {
+      const gchar *control_group = NULL;
+
+      g_variant_get (response, "(v)", &value);
+      control_group = g_variant_get_string (value, NULL);
+
+      /* the property is empty while the unit has no processes */
+      if (control_group != NULL && control_group[0] != '\0')
+        {
+          entry->cgroup_path = g_build_filename (RMG_CGROUP_ROOT, control_group, NULL);
+          cgwatch_entry_arm (cgwatch, entry);
+        }
+    }
+
+  rmg_cgwatch_unref (cgwatch);
+}
+
+static void
+cgwatch_entry_arm (RmgCGWatch *cgwatch, RmgCGWatchEntry *entry)
+{
+  g_autofree gchar *events_path = NULL;
+  g_autofree gchar *memory_path = NULL;
+  guint64 value = 0;
+
+  if (entry->cgroup_path == NULL)
+    {
+      if (entry->resolving || entry->mentry->manager_proxy == NULL)
+        return;
+
+      entry->resolving = TRUE;
+
+      g_dbus_connection_call (g_dbus_proxy_get_connection (entry->mentry->manager_proxy),
+                              sd_dbus_name, entry->mentry->object_path,
+                              "org.freedesktop.DBus.Properties", "Get",
+                              g_variant_new ("(ss)", "org.freedesktop.systemd1.Service",
+                                             "ControlGroup"),
+                              G_VARIANT_TYPE ("(v)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                              control_group_ready_cb, rmg_cgwatch_ref (cgwatch));
+      return;
+    }
+
+  cgwatch_entry_disarm (cgwatch, entry);
+
+  events_path = g_build_filename (entry->cgroup_path, "cgroup.events", NULL);
+  memory_path = g_build_filename (entry->cgroup_path, "memory.events", NULL);
+
+  entry->events_wd = inotify_add_watch (cgwatch->inotify_fd, events_path, IN_MODIFY);
+  if (entry->events_wd < 0)
+    {
+      g_debug ("Cannot watch '%s'. Error %s", events_path, g_strerror (errno));
+      return;
+    }
+
+  g_hash_table_insert (cgwatch->watches, GINT_TO_POINTER (entry->events_wd), entry);
+
+  /* memory controller may not be enabled for this cgroup */
+  entry->memory_wd = inotify_add_watch (cgwatch->inotify_fd, memory_path, IN_MODIFY);
+  if (entry->memory_wd >= 0)
+    g_hash_table_insert (cgwatch->watches, GINT_TO_POINTER (entry->memory_wd), entry);
+
+  if (read_event_value (entry->cgroup_path, "cgroup.events", "populated", &value))
+    entry->populated = (value != 0);
+
+  if (read_event_value (entry->cgroup_path, "memory.events", "oom_kill", &value))
+    entry->oom_kills = value;
+
+  g_debug ("Watching cgroup events for service '%s' at '%s'", entry->mentry->service_name,
+           entry->cgroup_path);
+}
+
+static void
+remove_watch_entry (gpointer _entry)
+{
+  RmgCGWatchEntry *entry = (RmgCGWatchEntry *)_entry;
+
+  rmg_mentry_unref (entry->mentry);
+  g_free (entry->cgroup_path);
+  g_free (entry);
+}
+
+RmgCGWatch *
+rmg_cgwatch_new (GError **error)
+{
+  RmgCGWatch *cgwatch = NULL;
+  gint fd;
+
+  fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+    {
+      g_set_error (error, g_quark_from_static_string ("CGWatchNew"), 1,
+                   "Fail to create inotify instance. Error %s", g_strerror (errno));
+      return NULL;
+    }
+
+  cgwatch = (RmgCGWatch *)g_source_new (&cgwatch_source_funcs, sizeof (RmgCGWatch));
+
+  g_assert (cgwatch);
+
+  g_ref_count_init (&cgwatch->rc);
+
+  cgwatch->inotify_fd = fd;
+  cgwatch->entries
+      = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, remove_watch_entry);
+  cgwatch->watches = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  g_source_set_callback (RMG_EVENT_SOURCE (cgwatch), NULL, cgwatch, cgwatch_source_destroy_notify);
+  g_source_attach (RMG_EVENT_SOURCE (cgwatch), NULL);
+
+  cgwatch->tag = g_source_add_unix_fd (RMG_EVENT_SOURCE (cgwatch), cgwatch->inotify_fd, G_IO_IN);
+
+  return cgwatch;
+}
+
+RmgCGWatch *
+rmg_cgwatch_ref (RmgCGWatch *cgwatch)
+{
+  g_assert (cgwatch);
+  g_ref_count_inc (&cgwatch->rc);
+  return cgwatch;
+}
+
+void
+rmg_cgwatch_unref (RmgCGWatch *cgwatch)
+{
+  g_assert (cgwatch);
+
+  if (g_ref_count_dec (&cgwatch->rc) == TRUE)
+    {
+      g_hash_table_destroy (cgwatch->watches);
+      g_hash_table_destroy (cgwatch->entries);
+
+      if (cgwatch->inotify_fd >= 0)
+        close (cgwatch->inotify_fd);
+
+      g_source_unref (RMG_EVENT_SOURCE (cgwatch));
+    }
+}
+
+void
+rmg_cgwatch_add_entry (RmgCGWatch *cgwatch, RmgMEntry *mentry)
+{
+  RmgCGWatchEntry *entry = NULL;
+
+  g_assert (cgwatch);
+  g_assert (mentry);
+
+  if (g_hash_table_contains (cgwatch->entries, mentry->service_name))
+    return;
+
+  entry = g_new0 (RmgCGWatchEntry, 1);
+
+  entry->mentry = rmg_mentry_ref (mentry);
+  entry->cgwatch = cgwatch;
+  entry->events_wd = -1;
+  entry->memory_wd = -1;
+
+  g_hash_table_insert (cgwatch->entries, mentry->service_name, entry);
+
+  if (mentry->active_state == SERVICE_STATE_ACTIVE)
+    cgwatch_entry_arm (cgwatch, entry);
+}
+
+void
+rmg_cgwatch_rearm (RmgCGWatch *cgwatch, RmgMEntry *mentry)
+{
+  RmgCGWatchEntry *entry = NULL;
+
+  g_assert (cgwatch);
+  g_assert (mentry);
+
+  entry = g_hash_table_lookup (cgwatch->entries, mentry->service_name);
+  if (entry != NULL)
+    cgwatch_entry_arm (cgwatch, entry);
+}
@@ -0,0 +1,98 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-cgwatch.h
+ */
+
+#pragma once
+
+#include "rmg-mentry.h"
+#include "rmg-types.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgCGWatchEntry
+ * @brief Cgroup event watches for one monitored unit
+ */
+typedef struct _RmgCGWatchEntry
+{
+  RmgMEntry *mentry;  /**< The monitored unit entry */
+  gpointer cgwatch;   /**< Back reference to the owner */
+  gchar *cgroup_path; /**< Unit cgroup directory or NULL until resolved */
+  gint events_wd;     /**< Watch descriptor for cgroup.events */
+  gint memory_wd;     /**< Watch descriptor for memory.events */
+  gboolean populated; /**< Last populated value */
+  guint64 oom_kills;  /**< Last oom_kill counter value */
+  gboolean resolving; /**< ControlGroup property read in progress */
+} RmgCGWatchEntry;
+
+/**
+ * @struct RmgCGWatch
+ * @brief The RmgCGWatch opaque data structure
+ */
+typedef struct _RmgCGWatch
+{
+  GSource source;      /**< Event loop source */
+  gpointer tag;        /**< The inotify file descriptor tag */
+  gint inotify_fd;     /**< The inotify file descriptor */
+  GHashTable *entries; /**< Watch entries indexed by service name atom */
+  GHashTable *watches; /**< Watch entries indexed by watch descriptor */
+  grefcount rc;        /**< Reference counter variable  */
+} RmgCGWatch;
+
+/*
+ * @brief Create a new cgroup watch object
+ * @param error The error object set if inotify is not available
+ * @return On success return a new RmgCGWatch object otherwise return NULL
+ */
+RmgCGWatch *rmg_cgwatch_new (GError **error);
+
+/**
+ * @brief Aquire cgwatch object
+ * @param cgwatch Pointer to the cgwatch object
+ */
+RmgCGWatch *rmg_cgwatch_ref (RmgCGWatch *cgwatch);
+
+/**
+ * @brief Release cgwatch object
+ * @param cgwatch Pointer to the cgwatch object
+ */
+void rmg_cgwatch_unref (RmgCGWatch *cgwatch);
+
+/**
+ * @brief Watch the cgroup of a monitored unit
+ * @param cgwatch Pointer to the cgwatch object
+ * @param mentry The monitor entry, a reference is kept by cgwatch
+ */
+void rmg_cgwatch_add_entry (RmgCGWatch *cgwatch, RmgMEntry *mentry);
+
+/**
+ * @brief Re-arm the cgroup watches of an entry after the unit started again
+ * @param cgwatch Pointer to the cgwatch object
+ * @param mentry The monitor entry
+ */
+void rmg_cgwatch_rearm (RmgCGWatch *cgwatch, RmgMEntry *mentry);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgCGWatch, rmg_cgwatch_unref);
+
+G_END_DECLS
@@ -22,6 +22,7 @@
  */
 
 #include "rmg-checker.h"
+#include "rmg-utils.h"
 
 /**
  * @brief Post new event
@@ -30,11 +31,6 @@
  */
 static void post_checker_event (RmgChecker *checker, CheckerEventType type);
 
-/**
- * @brief GSource prepare function
- */
-static gboolean checker_source_prepare (GSource *source, gint *timeout);
-
 /**
  * @brief GSource dispatch function
  */
@@ -51,30 +47,51 @@ static gboolean checker_source_callback (gpointer _checker, gpointer _event);
 static void checker_source_destroy_notify (gpointer _checker);
 
 /**
- * @brief Async queue destroy notification callback function
+ * @brief Schedule the next integrity check
  */
-static void checker_queue_destroy_notify (gpointer _checker);
+static void checker_schedule_audit (RmgChecker *checker, guint interval);
 
 /**
- * @brief Start check services timer
+ * @brief Check services timer callback
  */
-static void checker_start_check_services_timer (RmgChecker *checker);
+static gboolean check_services_timer_callback (gpointer user_data);
 
 /**
- * @brief Check services timer callback
+ * @brief Unit states reply callback
  */
-static gboolean check_services_timer_callback (gpointer user_data);
+static void list_units_async_cb (GObject *source_object, GAsyncResult *res, gpointer user_data);
 
 /**
- * @brief Check services callback for matching service
+ * @brief Load the service probes from the journal
  */
-static void check_services_callback_for_service (gpointer _journal, gpointer _data);
+static void checker_load_probes (RmgChecker *checker);
+
+/**
+ * @brief Run the due probes within the concurrency budget and arm the timer
+ */
+static void checker_schedule_probes (RmgChecker *checker);
+
+/**
+ * @brief Probe timer callback
+ */
+static gboolean probe_timer_callback (gpointer user_data);
+
+/**
+ * @brief Probe run completion callback
+ */
+static void probe_run_done (gpointer _probe, gboolean healthy, gpointer user_data);
+
+/**
+ * @brief Unit state reply callback for a service failing its probe
+ */
+static void probe_unit_state_async_cb (GObject *source_object, GAsyncResult *res,
+                                       gpointer user_data);
 
 /**
  * @brief GSourceFuncs vtable
  */
 static GSourceFuncs checker_source_funcs = {
-  checker_source_prepare, NULL, checker_source_dispatch, NULL, NULL, NULL,
+  NULL, NULL, checker_source_dispatch, NULL, NULL, NULL,
 };
 
 static void
@@ -87,32 +104,21 @@ post_checker_event (RmgChecker *checker, CheckerEventType type)
   e = g_new0 (RmgCheckerEvent, 1);
   e->type = type;
 
-  g_async_queue_push (checker->queue, e);
-}
-
-static gboolean
-checker_source_prepare (GSource *source, gint *timeout)
-{
-  RmgChecker *checker = (RmgChecker *)source;
-
-  RMG_UNUSED (timeout);
-
-  return (g_async_queue_length (checker->queue) > 0);
+  rmg_eventqueue_push (checker->queue, e);
 }
 
 static gboolean
 checker_source_dispatch (GSource *source, GSourceFunc callback, gpointer _checker)
 {
   RmgChecker *checker = (RmgChecker *)source;
-  gpointer event = g_async_queue_try_pop (checker->queue);
 
   RMG_UNUSED (callback);
   RMG_UNUSED (_checker);
 
-  if (event == NULL)
-    return G_SOURCE_CONTINUE;
+  if (!rmg_eventqueue_dispatch (checker->queue, checker->callback, checker))
+    return G_SOURCE_REMOVE;
 
-  return checker->callback (checker, event) == TRUE ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+  return G_SOURCE_CONTINUE;
 }
 
 static gboolean
@@ -127,7 +133,9 @@ checker_source_callback (gpointer _checker, gpointer _event)
   switch (event->type)
     {
     case CHECKER_EVENT_CHECK_SERVICES:
-      checker_start_check_services_timer (checker);
+      checker_schedule_audit (checker, checker->audit_boot_delay);
+      checker_load_probes (checker);
+      checker_schedule_probes (checker);
       break;
 
     default:
@@ -151,66 +159,420 @@ checker_source_destroy_notify (gpointer _checker)
 }
 
 static void
-checker_queue_destroy_notify (gpointer _checker)
+probe_free (gpointer _probe)
 {
-  RMG_UNUSED (_checker);
-  g_debug ("Checker queue destroy notification");
+  RmgProbe *probe = (RmgProbe *)_probe;
+
+  rmg_probe_cancel (probe);
+  rmg_probe_unref (probe);
 }
 
 static void
-check_services_callback_for_service (gpointer _journal, gpointer _data)
+checker_load_probes (RmgChecker *checker)
 {
-  RmgJournal *journal = (RmgJournal *)_journal;
-  const char *service_name = (const char *)_data;
+  g_autoptr (GError) error = NULL;
+  gint64 start = g_get_monotonic_time () + (gint64)checker->audit_boot_delay * G_USEC_PER_SEC;
+  GList *entries = NULL;
+
+  g_list_free_full (checker->probes, probe_free);
+  checker->probes = NULL;
+  checker->probes_running = 0;
 
-  RMG_UNUSED (journal);
+  entries = rmg_journal_get_probes (checker->journal, &error);
+  if (error != NULL)
+    g_warning ("Fail to read service probes. Error %s", error->message);
+
+  for (GList *l = entries; l != NULL; l = l->next)
+    {
+      RmgProbeResponseEntry *entry = (RmgProbeResponseEntry *)l->data;
+      RmgProbe *probe = rmg_probe_new (entry->service_name, entry->type, entry->target,
+                                       entry->interval, entry->timeout, entry->threshold);
 
-  /* TODO: We may want to check if the service is running here and trigger
-   *       a restart without increment the rvector to allow crash detaction
-   *       mechanism to be triggered in case of failures */
-  g_debug ("Service '%s' request integrity check", service_name);
+      /* the first runs are spread over the interval to avoid a burst after boot */
+      probe->due_time
+          = start + (gint64)(g_random_double () * (gdouble)probe->interval * G_USEC_PER_SEC);
+
+      checker->probes = g_list_prepend (checker->probes, probe);
+
+      g_clear_pointer (&entry->service_name, g_ref_string_release);
+      g_free (entry->target);
+      g_free (entry);
+    }
+
+  g_list_free (entries);
+
+  g_debug ("Checker loaded %u service probes", g_list_length (checker->probes));
+}
+
+static gint64
+probe_next_due (RmgProbe *probe, gint64 now)
+{
+  gint64 interval = (gint64)probe->interval * G_USEC_PER_SEC;
+  gint64 jitter = interval / 10;
+
+  /* jitter keeps probes with the same interval from running in lockstep */
+  return now + interval + (gint64)(g_random_double_range (-1.0, 1.0) * (gdouble)jitter);
+}
+
+static void
+checker_schedule_probes (RmgChecker *checker)
+{
+  gint64 now = g_get_monotonic_time ();
+  gint64 next_due = G_MAXINT64;
+  GDBusConnection *connection = NULL;
+
+  g_assert (checker);
+
+  if (checker->probe_source != 0)
+    {
+      g_source_remove (checker->probe_source);
+      checker->probe_source = 0;
+    }
+
+  /* probes start once the proxy is available to check the unit state on failures */
+  if (checker->proxy == NULL)
+    return;
+
+  connection = g_dbus_proxy_get_connection (checker->proxy);
+
+  for (GList *l = checker->probes; l != NULL; l = l->next)
+    {
+      RmgProbe *probe = (RmgProbe *)l->data;
+
+      if (probe->running)
+        continue;
+
+      if (probe->due_time > now)
+        {
+          next_due = MIN (next_due, probe->due_time);
+          continue;
+        }
+
+      /* due probes over the budget start as the running probes complete */
+      if (checker->probes_running >= checker->probe_concurrency)
+        continue;
+
+      checker->probes_running++;
+      rmg_probe_run (probe, connection, probe_run_done, checker);
+    }
+
+  if (next_due != G_MAXINT64)
+    {
+      checker->probe_source = g_timeout_add ((guint)((next_due - now + 999) / 1000),
+                                             probe_timer_callback, checker);
+    }
 }
 
 static gboolean
-check_services_timer_callback (gpointer user_data)
+probe_timer_callback (gpointer user_data)
 {
   RmgChecker *checker = (RmgChecker *)user_data;
 
+  checker->probe_source = 0;
+  checker_schedule_probes (checker);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+checker_suspend_probes (RmgChecker *checker, const gchar *service_name, gint64 until)
+{
+  for (GList *l = checker->probes; l != NULL; l = l->next)
+    {
+      RmgProbe *probe = (RmgProbe *)l->data;
+
+      if (probe->service_name != service_name)
+        continue;
+
+      if (probe->running)
+        {
+          rmg_probe_cancel (probe);
+          checker->probes_running--;
+        }
+
+      probe->failures = 0;
+      probe->due_time = until;
+    }
+}
+
+static void
+probe_escalate (RmgChecker *checker, RmgProbe *probe, gint64 now)
+{
   g_autoptr (GError) error = NULL;
+  glong relax_timeout;
+
+  relax_timeout = rmg_journal_get_relaxing_timeout (checker->journal, probe->service_name, &error);
+  if (error != NULL)
+    g_warning ("Fail to read relax timeout for %s. Error %s", probe->service_name, error->message);
 
+  /* the service probes rest while the recovery action takes effect */
+  relax_timeout = MAX (relax_timeout, (glong)probe->interval);
+  checker_suspend_probes (checker, probe->service_name,
+                          now + (gint64)relax_timeout * G_USEC_PER_SEC);
+
+  g_dbus_proxy_call (checker->proxy, "ListUnitsByNames",
+                     g_variant_new ("(^as)", (const gchar *[]){ probe->service_name, NULL }),
+                     G_DBUS_CALL_FLAGS_NONE, -1, NULL, probe_unit_state_async_cb,
+                     rmg_checker_ref (checker));
+}
+
+static void
+probe_run_done (gpointer _probe, gboolean healthy, gpointer user_data)
+{
+  RmgProbe *probe = (RmgProbe *)_probe;
+  RmgChecker *checker = (RmgChecker *)user_data;
+  gint64 now = g_get_monotonic_time ();
+
+  checker->probes_running--;
+  probe->due_time = probe_next_due (probe, now);
+
+  if (healthy)
+    {
+      if (probe->failures > 0)
+        {
+          g_info ("Service '%s' %s probe recovered after %u failures", probe->service_name,
+                  rmg_utils_probe_name (probe->type), probe->failures);
+        }
+
+      probe->failures = 0;
+    }
+  else if (++probe->failures >= probe->threshold)
+    {
+      g_warning ("Service '%s' %s probe '%s' failed %u times", probe->service_name,
+                 rmg_utils_probe_name (probe->type), probe->target, probe->failures);
+      probe_escalate (checker, probe, now);
+    }
+  else
+    {
+      g_info ("Service '%s' %s probe '%s' failed (%u/%u)", probe->service_name,
+              rmg_utils_probe_name (probe->type), probe->target, probe->failures,
+              probe->threshold);
+    }
+
+  checker_schedule_probes (checker);
+}
+
+static void
+probe_unit_state_async_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgChecker *checker = (RmgChecker *)user_data;
+  g_autoptr (GVariant) response = NULL;
+  g_autoptr (GVariantIter) iter = NULL;
+  g_autoptr (GError) error = NULL;
+  const gchar *unit_name = NULL;
+  const gchar *active_state = NULL;
+  const gchar *object_path = NULL;
+
+  response = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (error != NULL)
+    {
+      g_warning ("Fail to read the state of a service failing its probe. Error %s",
+                 error->message);
+      rmg_checker_unref (checker);
+      return;
+    }
+
+  g_variant_get (response, "(a(ssssssouso))", &iter);
+
+  while (g_variant_iter_next (iter, "(&s&s&s&s&s&s&ou&s&o)", &unit_name, NULL, NULL,
+                              &active_state, NULL, NULL, &object_path, NULL, NULL, NULL))
+    {
+      RmgDEvent *event = NULL;
+
+      /* services in any other state are handled by systemd and the crash recovery */
+      if (g_strcmp0 (active_state, "active") != 0)
+        {
+          g_info ("Service '%s' failing its probe is %s, no recovery", unit_name, active_state);
+          continue;
+        }
+
+      g_warning ("Service '%s' is active but unresponsive, dispatch probe failure", unit_name);
+
+      event = rmg_devent_new (DEVENT_SERVICE_CRASHED);
+      rmg_devent_set_service_name (event, unit_name);
+      rmg_devent_set_object_path (event, object_path);
+      rmg_devent_set_manager_proxy (event, checker->proxy);
+      rmg_devent_set_failure (event, FAILURE_PROBE, 0, 0);
+
+      rmg_dispatcher_push_service_event (checker->dispatcher, event);
+    }
+
+  rmg_checker_unref (checker);
+}
+
+static void
+checker_schedule_audit (RmgChecker *checker, guint interval)
+{
   g_assert (checker);
 
-  rmg_journal_call_foreach_checkstart (checker->journal, check_services_callback_for_service,
-                                       &error);
-  return false;
+  if (checker->audit_source != 0)
+    g_source_remove (checker->audit_source);
+
+  checker->audit_source = g_timeout_add_seconds (interval, check_services_timer_callback, checker);
+}
+
+static gboolean
+unit_state_running (const gchar *active_state)
+{
+  return g_strcmp0 (active_state, "active") == 0 || g_strcmp0 (active_state, "activating") == 0
+         || g_strcmp0 (active_state, "reloading") == 0
+         || g_strcmp0 (active_state, "refreshing") == 0;
 }
 
 static void
-checker_start_check_services_timer (RmgChecker *checker)
+list_units_async_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgChecker *checker = (RmgChecker *)user_data;
+  g_autoptr (GVariant) response = NULL;
+  g_autoptr (GVariantIter) iter = NULL;
+  g_autoptr (GError) error = NULL;
+  const gchar *unit_name = NULL;
+  const gchar *load_state = NULL;
+  const gchar *active_state = NULL;
+  guint started = 0;
+  guint settling = 0;
+
+  response = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (error != NULL)
+    {
+      g_warning ("Fail to read check start service states. Error %s", error->message);
+      checker_schedule_audit (checker, checker->audit_min_interval);
+      rmg_checker_unref (checker);
+      return;
+    }
+
+  g_variant_get (response, "(a(ssssssouso))", &iter);
+
+  while (g_variant_iter_next (iter, "(&s&s&s&s&s&s&ou&s&o)", &unit_name, NULL, &load_state,
+                              &active_state, NULL, NULL, NULL, NULL, NULL, NULL))
+    {
+      g_autoptr (RmgDEvent) event = NULL;
+
+      if (unit_state_running (active_state))
+        continue;
+
+      /* failed services are handled by the crash recovery */
+      if (g_strcmp0 (active_state, "failed") == 0)
+        continue;
+
+      if (g_strcmp0 (active_state, "deactivating") == 0)
+        {
+          settling++;
+          continue;
+        }
+
+      if (g_strcmp0 (load_state, "loaded") != 0)
+        {
+          g_warning ("Service '%s' has check start set but is %s", unit_name, load_state);
+          continue;
+        }
+
+      /* the rvector is untouched so the crash detection applies if the start fails */
+      g_info ("Service '%s' is %s on integrity check, request start", unit_name, active_state);
+
+      event = rmg_devent_new (DEVENT_UNKNOWN);
+      rmg_devent_set_service_name (event, unit_name);
+      rmg_devent_set_manager_proxy (event, checker->proxy);
+
+      rmg_executor_push_event (checker->dispatcher->executor, EXECUTOR_EVENT_SERVICE_RESTART,
+                               event);
+      started++;
+    }
+
+  /* the check relaxes while all services keep running */
+  if (started > 0 || settling > 0)
+    checker->audit_interval = checker->audit_min_interval;
+  else
+    checker->audit_interval = MIN (checker->audit_interval * 2, checker->audit_max_interval);
+
+  g_debug ("Integrity check started %u services, next check in %us", started,
+           checker->audit_interval);
+
+  checker_schedule_audit (checker, checker->audit_interval);
+  rmg_checker_unref (checker);
+}
+
+static gboolean
+check_services_timer_callback (gpointer user_data)
 {
-  glong timeout;
+  RmgChecker *checker = (RmgChecker *)user_data;
+  GVariantBuilder builder;
+  g_autoptr (GError) error = NULL;
+  GList *names = NULL;
 
   g_assert (checker);
 
-  timeout = (glong)rmg_options_long_for (checker->options, KEY_INTEGRITY_CHECK_SEC);
-  g_timeout_add_seconds_full (G_PRIORITY_DEFAULT, (guint)timeout, check_services_timer_callback,
-                              checker, NULL);
+  checker->audit_source = 0;
+
+  if (checker->proxy == NULL)
+    {
+      checker_schedule_audit (checker, checker->audit_min_interval);
+      return G_SOURCE_REMOVE;
+    }
+
+  names = rmg_journal_get_checkstart_service_names (checker->journal, &error);
+  if (error != NULL)
+    g_warning ("Fail to read check start services. Error %s", error->message);
+
+  /* the units may be reloaded with check start services later */
+  if (names == NULL)
+    {
+      checker_schedule_audit (checker, checker->audit_max_interval);
+      return G_SOURCE_REMOVE;
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+
+  for (GList *l = names; l != NULL; l = l->next)
+    g_variant_builder_add (&builder, "s", (const gchar *)l->data);
+
+  g_list_free_full (names, (GDestroyNotify)g_ref_string_release);
+
+  /* all states are read in one call, units not loaded are reported as not-found */
+  g_dbus_proxy_call (checker->proxy, "ListUnitsByNames", g_variant_new ("(as)", &builder),
+                     G_DBUS_CALL_FLAGS_NONE, -1, NULL, list_units_async_cb,
+                     rmg_checker_ref (checker));
+
+  return G_SOURCE_REMOVE;
 }
 
 RmgChecker *
-rmg_checker_new (RmgJournal *journal, RmgOptions *options)
+rmg_checker_new (RmgJournal *journal, RmgOptions *options, RmgDispatcher *dispatcher)
 {
   RmgChecker *checker = (RmgChecker *)g_source_new (&checker_source_funcs, sizeof (RmgChecker));
+  glong boot_delay;
+  glong min_interval;
+  glong max_interval;
+  glong concurrency;
 
   g_assert (checker);
   g_assert (journal);
   g_assert (options);
+  g_assert (dispatcher);
 
   g_ref_count_init (&checker->rc);
 
   checker->options = rmg_options_ref (options);
   checker->journal = rmg_journal_ref (journal);
-  checker->queue = g_async_queue_new_full (checker_queue_destroy_notify);
+  checker->dispatcher = rmg_dispatcher_ref (dispatcher);
+
+  boot_delay = rmg_options_long_for (options, KEY_INTEGRITY_CHECK_SEC);
+  min_interval = rmg_options_long_for (options, KEY_INTEGRITY_CHECK_MIN_SEC);
+  max_interval = rmg_options_long_for (options, KEY_INTEGRITY_CHECK_MAX_SEC);
+  concurrency = rmg_options_long_for (options, KEY_PROBE_CONCURRENCY);
+
+  checker->audit_min_interval = (guint)CLAMP (min_interval, 1, G_MAXINT);
+  checker->audit_max_interval = (guint)CLAMP (max_interval, checker->audit_min_interval, G_MAXINT);
+  checker->audit_interval = checker->audit_min_interval;
+  checker->audit_boot_delay = (guint)MAX (boot_delay, 0);
+  checker->probe_concurrency = (guint)CLAMP (concurrency, 1, G_MAXINT);
+
+  /* control events are few and must not be lost */
+  checker->queue = rmg_eventqueue_new ("checker", RMG_EVENTQUEUE_CONTROL_SIZE,
+                                       RMG_EVENTQUEUE_CONTROL_SIZE, EVENTQUEUE_OVERFLOW_GROW,
+                                       g_free);
+  g_source_add_unix_fd (RMG_EVENT_SOURCE (checker), rmg_eventqueue_get_fd (checker->queue),
+                        G_IO_IN);
   checker->callback = checker_source_callback;
 
   g_source_set_callback (RMG_EVENT_SOURCE (checker), NULL, checker, checker_source_destroy_notify);
@@ -240,10 +602,21 @@ rmg_checker_unref (RmgChecker *checker)
       if (checker->options != NULL)
         rmg_options_unref (checker->options);
 
+      if (checker->dispatcher != NULL)
+        rmg_dispatcher_unref (checker->dispatcher);
+
+      if (checker->audit_source != 0)
+        g_source_remove (checker->audit_source);
+
+      if (checker->probe_source != 0)
+        g_source_remove (checker->probe_source);
+
+      g_list_free_full (checker->probes, probe_free);
+
       if (checker->proxy != NULL)
         g_object_unref (checker->proxy);
 
-      g_async_queue_unref (checker->queue);
+      rmg_eventqueue_unref (checker->queue);
       g_source_unref (RMG_EVENT_SOURCE (checker));
     }
 }
@@ -257,6 +630,9 @@ rmg_checker_set_proxy (RmgChecker *checker, GDBusProxy *dbus_proxy)
 
   g_debug ("Proxy available for checker");
   checker->proxy = g_object_ref (dbus_proxy);
+
+  /* probes loaded before the proxy was available wait for it */
+  checker_schedule_probes (checker);
 }
 
 void
@@ -24,6 +24,8 @@
 #pragma once
 
 #include "rmg-dispatcher.h"
+#include "rmg-eventqueue.h"
+#include "rmg-probe.h"
 #include "rmg-types.h"
 
 #include <gio/gio.h>
@@ -58,19 +60,32 @@ typedef struct _RmgCheckerEvent
 typedef struct _RmgChecker
 {
   GSource source;              /**< Event loop source */
-  GAsyncQueue *queue;          /**< Async queue */
+  RmgEventQueue *queue;        /**< Event queue */
   RmgCheckerCallback callback; /**< Callback function */
   grefcount rc;                /**< Reference counter variable  */
   RmgOptions *options;
   RmgJournal *journal;
+  RmgDispatcher *dispatcher;
   GDBusProxy *proxy;
+  guint audit_source;       /**< Next integrity check timer or 0 */
+  guint audit_boot_delay;   /**< Seconds before the first integrity check */
+  guint audit_interval;     /**< Current seconds between integrity checks */
+  guint audit_min_interval; /**< Interval after a service had to be started */
+  guint audit_max_interval; /**< Interval limit once all services keep running */
+  GList *probes;            /**< Liveness probes of the recovery units */
+  guint probe_source;       /**< Timer of the earliest due probe or 0 */
+  guint probe_concurrency;  /**< Probes allowed to run at the same time */
+  guint probes_running;     /**< Probes currently running */
 } RmgChecker;
 
 /*
  * @brief Create a new checker object
+ * @param journal The journal with the check start services and probes
+ * @param options The options object
+ * @param dispatcher The dispatcher receiving probe failures, its executor starts services
  * @return On success return a new RmgChecker object otherwise return NULL
  */
-RmgChecker *rmg_checker_new (RmgJournal *journal, RmgOptions *options);
+RmgChecker *rmg_checker_new (RmgJournal *journal, RmgOptions *options, RmgDispatcher *dispatcher);
 
 /**
  * @brief Aquire checker object
@@ -91,7 +106,9 @@ void rmg_checker_unref (RmgChecker *checker);
 void rmg_checker_set_proxy (RmgChecker *checker, GDBusProxy *dbus_proxy);
 
 /**
- * @brief Service integrity checker
+ * @brief Start the periodic service integrity check and the liveness probes
+ * The first check runs IntegrityCheckTimeout seconds after the call and the first
+ * run of each probe is spread over its interval after the same delay
  * @param checker Pointer to the checker object
  */
 void rmg_checker_check_services (RmgChecker *checker);
@@ -143,7 +143,7 @@ process_message (RmgClient *c, RmgMessage *msg)
     {
     case RMG_MESSAGE_REPLICA_DESCRIPTOR:
       {
-        c->context_name = g_strdup (rmg_message_get_context_name (msg));
+        rmg_utils_set_name (&c->context_name, rmg_message_get_context_name (msg));
         g_info ("Replica instance id=%d identify with name=%s", c->sockfd, c->context_name);
       }
       break;
@@ -288,9 +288,7 @@ rmg_client_unref (RmgClient *client)
       if (client->server != NULL)
         rmg_server_unref ((RmgServer *)client->server);
 
-      if (client->context_name != NULL)
-        g_free (client->context_name);
-
+      g_clear_pointer (&client->context_name, g_ref_string_release);
       g_source_unref (RMG_EVENT_SOURCE (client));
     }
 }
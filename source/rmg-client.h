@@ -45,7 +45,7 @@ typedef struct _RmgClient
   gpointer tag;        /**< Unix server socket tag  */
   grefcount rc;        /**< Reference counter variable  */
   gint sockfd;         /**< Module file descriptor (client fd) */
-  gchar *context_name; /**< Client context name */
+  gchar *context_name; /**< Client context name atom */
   gpointer dispatcher; /**< Optional reference to dispatcher */
   gpointer server;     /**< Optional reference to server */
 } RmgClient;
@@ -0,0 +1,454 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-command.c
+ */
+
+#include "rmg-command.h"
+
+#include <string.h>
+
+/**
+ * @brief Seconds the output is still read after the process exited
+ */
+#define COMMAND_OUTPUT_GRACE_SEC (1)
+
+/**
+ * @brief Characters that need the shell when found outside of quotes
+ */
+#define COMMAND_SHELL_CHARS "|&;<>()$`*?[~#{!\n"
+
+/* Preserve the size and order from RmgCommandSlot */
+static const gchar *command_slot_name[] = { "${path}", "${service_name}" };
+static const gchar *command_slot_param[] = { "${1}", "${2}" };
+
+static RmgCommand *
+command_new_take (const gchar *name, gchar **argv, glong timeout)
+{
+  RmgCommand *command = g_new0 (RmgCommand, 1);
+
+  g_ref_count_init (&command->rc);
+
+  command->name = g_strdup (name);
+  command->argv = argv;
+  command->timeout = (guint)CLAMP (timeout, 1, G_MAXINT / 1000);
+  command->output_tail = g_string_new (NULL);
+  command->exit_status = -1;
+
+  return command;
+}
+
+static gint
+command_slot_at (const gchar *text)
+{
+  for (gint i = 0; i < COMMAND_SLOT_COUNT; i++)
+    {
+      if (g_str_has_prefix (text, command_slot_name[i]))
+        return i;
+    }
+
+  return -1;
+}
+
+static void
+command_arg_init (RmgCommandArg *arg, const gchar *text)
+{
+  GPtrArray *parts = g_ptr_array_new ();
+  GArray *slots = g_array_new (FALSE, FALSE, sizeof (RmgCommandSlot));
+  const gchar *start = text;
+  const gchar *p = text;
+
+  while ((p = strstr (p, "${")) != NULL)
+    {
+      gint index = command_slot_at (p);
+      RmgCommandSlot slot;
+
+      if (index < 0)
+        {
+          p += 2;
+          continue;
+        }
+
+      slot = (RmgCommandSlot)index;
+      g_ptr_array_add (parts, g_strndup (start, (gsize)(p - start)));
+      g_array_append_val (slots, slot);
+
+      p += strlen (command_slot_name[index]);
+      start = p;
+    }
+
+  g_ptr_array_add (parts, g_strdup (start));
+  g_ptr_array_add (parts, NULL);
+
+  arg->n_slots = slots->len;
+  arg->parts = (gchar **)g_ptr_array_free (parts, FALSE);
+  arg->slots = (RmgCommandSlot *)g_array_free (slots, FALSE);
+}
+
+/*
+ * Copy the command line into a sh script reading the slot values from positional
+ * parameters so the values are never parsed by the shell. Return TRUE if the command
+ * line uses shell syntax.
+ */
+static gboolean
+command_template_script (const gchar *command_line, GString *script)
+{
+  gboolean shell = FALSE;
+  gchar quote = '\0';
+  const gchar *p = command_line;
+
+  while (*p != '\0')
+    {
+      gint slot = command_slot_at (p);
+
+      if (slot >= 0)
+        {
+          if (quote == '"')
+            g_string_append (script, command_slot_param[slot]);
+          else if (quote == '\'')
+            g_string_append_printf (script, "'\"%s\"'", command_slot_param[slot]);
+          else
+            g_string_append_printf (script, "\"%s\"", command_slot_param[slot]);
+
+          p += strlen (command_slot_name[slot]);
+          continue;
+        }
+
+      if (quote != '\'' && *p == '\\' && *(p + 1) != '\0')
+        {
+          g_string_append_len (script, p, 2);
+          p += 2;
+          continue;
+        }
+
+      if (*p == quote)
+        quote = '\0';
+      else if (quote == '\0' && (*p == '\'' || *p == '"'))
+        quote = *p;
+      else if (quote == '\0' && strchr (COMMAND_SHELL_CHARS, *p) != NULL)
+        shell = TRUE;
+      else if (quote == '"' && (*p == '$' || *p == '`'))
+        shell = TRUE;
+
+      g_string_append_c (script, *p);
+      p++;
+    }
+
+  return shell;
+}
+
+static void
+command_complete (RmgCommand *command)
+{
+  RmgCommandCallback callback = command->callback;
+
+  if (!command->exited || !command->output_closed || callback == NULL)
+    return;
+
+  if (command->timeout_source != 0)
+    {
+      g_source_remove (command->timeout_source);
+      command->timeout_source = 0;
+    }
+
+  command->callback = NULL;
+  callback (command, command->user_data);
+
+  /* release the reference taken by rmg_command_run */
+  rmg_command_unref (command);
+}
+
+static gboolean
+command_timeout_cb (gpointer _command)
+{
+  RmgCommand *command = (RmgCommand *)_command;
+
+  command->timeout_source = 0;
+
+  if (!command->exited && command->subprocess != NULL)
+    {
+      g_warning ("Command %s timed out after %u seconds", command->name, command->timeout);
+      command->timed_out = TRUE;
+      g_subprocess_force_exit (command->subprocess);
+    }
+
+  /* stop reading output held open by children left behind by the process */
+  g_cancellable_cancel (command->cancellable);
+  command_complete (command);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+command_output_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgCommand *command = (RmgCommand *)user_data;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *line = NULL;
+  gsize length = 0;
+
+  line = g_data_input_stream_read_line_finish (G_DATA_INPUT_STREAM (source_object), res, &length,
+                                               &error);
+  if (line == NULL)
+    {
+      if (error != NULL && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_debug ("Fail to read command %s output. Error %s", command->name, error->message);
+
+      command->output_closed = TRUE;
+      command_complete (command);
+    }
+  else
+    {
+      GString *tail = command->output_tail;
+
+      g_info ("%s: %s", command->name, line);
+
+      g_string_append_len (tail, line, (gssize)length);
+      g_string_append_c (tail, '\n');
+
+      if (tail->len > RMG_COMMAND_OUTPUT_TAIL)
+        g_string_erase (tail, 0, (gssize)(tail->len - RMG_COMMAND_OUTPUT_TAIL));
+
+      g_data_input_stream_read_line_async (command->output, G_PRIORITY_DEFAULT,
+                                           command->cancellable, command_output_cb,
+                                           rmg_command_ref (command));
+    }
+
+  rmg_command_unref (command);
+}
+
+static void
+command_wait_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgCommand *command = (RmgCommand *)user_data;
+  GSubprocess *subprocess = G_SUBPROCESS (source_object);
+
+  if (!g_subprocess_wait_finish (subprocess, res, &command->error))
+    command->exit_status = -1;
+  else if (g_subprocess_get_if_exited (subprocess))
+    command->exit_status = g_subprocess_get_exit_status (subprocess);
+  else
+    command->exit_status = -1;
+
+  command->exited = TRUE;
+
+  if (!command->output_closed)
+    {
+      if (command->timeout_source != 0)
+        g_source_remove (command->timeout_source);
+
+      command->timeout_source
+          = g_timeout_add_seconds (COMMAND_OUTPUT_GRACE_SEC, command_timeout_cb, command);
+    }
+
+  command_complete (command);
+  rmg_command_unref (command);
+}
+
+RmgCommand *
+rmg_command_new (const gchar *name, const gchar *const *argv, glong timeout)
+{
+  g_assert (name);
+  g_assert (argv && argv[0]);
+
+  return command_new_take (name, g_strdupv ((gchar **)(guintptr)argv), timeout);
+}
+
+RmgCommand *
+rmg_command_ref (RmgCommand *command)
+{
+  g_assert (command);
+  g_ref_count_inc (&command->rc);
+  return command;
+}
+
+void
+rmg_command_unref (RmgCommand *command)
+{
+  g_assert (command);
+
+  if (g_ref_count_dec (&command->rc) == TRUE)
+    {
+      if (command->timeout_source != 0)
+        g_source_remove (command->timeout_source);
+
+      g_clear_object (&command->output);
+      g_clear_object (&command->subprocess);
+      g_clear_object (&command->cancellable);
+      g_clear_error (&command->error);
+      g_string_free (command->output_tail, TRUE);
+      g_strfreev (command->argv);
+      g_free (command->name);
+      g_free (command);
+    }
+}
+
+void
+rmg_command_run (RmgCommand *command, RmgCommandCallback callback, gpointer user_data)
+{
+  g_assert (command);
+  g_assert (callback);
+  g_assert (command->subprocess == NULL && command->callback == NULL);
+
+  command->callback = callback;
+  command->user_data = user_data;
+  command->cancellable = g_cancellable_new ();
+
+  /* released once the callback returns */
+  rmg_command_ref (command);
+
+  command->subprocess = g_subprocess_newv ((const gchar *const *)command->argv,
+                                           G_SUBPROCESS_FLAGS_STDOUT_PIPE
+                                               | G_SUBPROCESS_FLAGS_STDERR_MERGE,
+                                           &command->error);
+  if (command->subprocess == NULL)
+    {
+      command->exited = TRUE;
+      command->output_closed = TRUE;
+
+      /* the callback is never called before rmg_command_run returns */
+      command->timeout_source = g_idle_add (command_timeout_cb, command);
+      return;
+    }
+
+  command->output = g_data_input_stream_new (g_subprocess_get_stdout_pipe (command->subprocess));
+
+  g_data_input_stream_read_line_async (command->output, G_PRIORITY_DEFAULT, command->cancellable,
+                                       command_output_cb, rmg_command_ref (command));
+  g_subprocess_wait_async (command->subprocess, NULL, command_wait_cb, rmg_command_ref (command));
+
+  command->timeout_source = g_timeout_add_seconds (command->timeout, command_timeout_cb, command);
+}
+
+RmgCommandTemplate *
+rmg_command_template_new (const gchar *command_line)
+{
+  RmgCommandTemplate *tmpl = g_new0 (RmgCommandTemplate, 1);
+  g_autoptr (GString) script = g_string_new (NULL);
+  g_autoptr (GError) error = NULL;
+  g_auto (GStrv) argv = NULL;
+  gint argc = 0;
+
+  g_assert (command_line);
+
+  g_ref_count_init (&tmpl->rc);
+
+  tmpl->command_line = g_strdup (command_line);
+  tmpl->shell = command_template_script (command_line, script);
+
+  if (!tmpl->shell)
+    {
+      if (!g_shell_parse_argv (command_line, &argc, &argv, &error))
+        {
+          g_warning ("Fail to parse command '%s'. Error %s", command_line, error->message);
+          tmpl->shell = TRUE;
+        }
+      else if (strchr (argv[0], '=') != NULL)
+        {
+          /* variable assignments are left to the shell */
+          tmpl->shell = TRUE;
+        }
+    }
+
+  if (tmpl->shell)
+    {
+      const gchar *shell_argv[]
+          = { "sh", "-c", script->str, "recoverymanager", "${path}", "${service_name}", NULL };
+
+      g_clear_pointer (&argv, g_strfreev);
+      argv = g_strdupv ((gchar **)(guintptr)shell_argv);
+      argc = (gint)g_strv_length (argv);
+    }
+
+  tmpl->argc = (guint)argc;
+  tmpl->args = g_new0 (RmgCommandArg, tmpl->argc);
+
+  for (guint i = 0; i < tmpl->argc; i++)
+    command_arg_init (&tmpl->args[i], argv[i]);
+
+  g_debug ("Command '%s' runs %s", command_line, tmpl->shell ? "with sh" : "without shell");
+
+  return tmpl;
+}
+
+RmgCommandTemplate *
+rmg_command_template_ref (RmgCommandTemplate *tmpl)
+{
+  g_assert (tmpl);
+  g_ref_count_inc (&tmpl->rc);
+  return tmpl;
+}
+
+void
+rmg_command_template_unref (RmgCommandTemplate *tmpl)
+{
+  g_assert (tmpl);
+
+  if (g_ref_count_dec (&tmpl->rc) == TRUE)
+    {
+      for (guint i = 0; i < tmpl->argc; i++)
+        {
+          g_strfreev (tmpl->args[i].parts);
+          g_free (tmpl->args[i].slots);
+        }
+
+      g_free (tmpl->args);
+      g_free (tmpl->command_line);
+      g_free (tmpl);
+    }
+}
+
+RmgCommand *
+rmg_command_template_instance (RmgCommandTemplate *tmpl, const gchar *name,
+                               const gchar *const *values, glong timeout)
+{
+  gchar **argv = NULL;
+
+  g_assert (tmpl);
+  g_assert (name);
+
+  argv = g_new0 (gchar *, tmpl->argc + 1);
+
+  for (guint i = 0; i < tmpl->argc; i++)
+    {
+      RmgCommandArg *arg = &tmpl->args[i];
+      GString *value = NULL;
+
+      if (arg->n_slots == 0)
+        {
+          argv[i] = g_strdup (arg->parts[0]);
+          continue;
+        }
+
+      value = g_string_new (arg->parts[0]);
+
+      for (guint j = 0; j < arg->n_slots; j++)
+        {
+          const gchar *slot_value = values != NULL ? values[arg->slots[j]] : NULL;
+
+          g_string_append (value, slot_value != NULL ? slot_value : "");
+          g_string_append (value, arg->parts[j + 1]);
+        }
+
+      argv[i] = g_string_free (value, FALSE);
+    }
+
+  return command_new_take (name, argv, timeout);
+}
@@ -0,0 +1,172 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-command.h
+ */
+
+#pragma once
+
+#include "rmg-types.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @brief Bytes of command output kept for the completion callback
+ */
+#define RMG_COMMAND_OUTPUT_TAIL (4096)
+
+/**
+ * @enum RmgCommandSlot
+ * @brief Substitution slots of a command template
+ */
+typedef enum _RmgCommandSlot
+{
+  COMMAND_SLOT_PATH,         /**< ${path} placeholder */
+  COMMAND_SLOT_SERVICE_NAME, /**< ${service_name} placeholder */
+  COMMAND_SLOT_COUNT
+} RmgCommandSlot;
+
+/**
+ * @struct RmgCommandArg
+ * @brief A command template argument split around its substitution slots
+ */
+typedef struct _RmgCommandArg
+{
+  gchar **parts;         /**< Literal parts, one more than the slots */
+  RmgCommandSlot *slots; /**< Slot between two consecutive parts */
+  guint n_slots;         /**< Number of slots in the argument */
+} RmgCommandArg;
+
+/**
+ * @struct RmgCommandTemplate
+ * @brief A configured command line parsed once into an argv template
+ */
+typedef struct _RmgCommandTemplate
+{
+  gchar *command_line; /**< The configured command line */
+  gboolean shell;      /**< The command line uses shell syntax and runs with sh */
+  RmgCommandArg *args; /**< The argv template */
+  guint argc;          /**< Number of arguments in the argv template */
+  grefcount rc;        /**< Reference counter variable  */
+} RmgCommandTemplate;
+
+/**
+ * @function RmgCommandCallback
+ * @brief Command completion callback
+ */
+typedef void (*RmgCommandCallback) (gpointer _command, gpointer user_data);
+
+/**
+ * @struct RmgCommand
+ * @brief A command run asynchronously from the main context
+ */
+typedef struct _RmgCommand
+{
+  gchar *name;                 /**< Label used for the command output in logs */
+  gchar **argv;                /**< The program and its arguments */
+  guint timeout;               /**< Seconds before the command is killed */
+  GSubprocess *subprocess;     /**< The running process */
+  GDataInputStream *output;    /**< Merged stdout and stderr of the process */
+  GCancellable *cancellable;   /**< Cancellable of the output read */
+  guint timeout_source;        /**< Timeout or output grace source */
+  gboolean exited;             /**< The process was reaped */
+  gboolean output_closed;      /**< The output reached end of stream */
+  gboolean timed_out;          /**< The process was killed on timeout */
+  gint exit_status;            /**< Exit code, -1 if the process did not exit normally */
+  GString *output_tail;        /**< Last bytes of the process output */
+  GError *error;               /**< Spawn or wait error */
+  RmgCommandCallback callback; /**< Completion callback */
+  gpointer user_data;          /**< Completion callback user data */
+  grefcount rc;                /**< Reference counter variable  */
+} RmgCommand;
+
+/*
+ * @brief Create a new command object
+ * @param name The label used for the command output in logs
+ * @param argv The program and its arguments, the program is searched in PATH
+ * @param timeout Seconds before the command is killed
+ * @return A new RmgCommand object
+ */
+RmgCommand *rmg_command_new (const gchar *name, const gchar *const *argv, glong timeout);
+
+/*
+ * @brief Create a new command template object
+ * The command line is split into arguments as the shell would. Placeholders ${path} and
+ * ${service_name} are replaced in the arguments when a command is created and never
+ * reparsed. A command line using shell syntax runs with sh and receives the placeholder
+ * values as positional parameters.
+ * @param command_line The configured command line
+ * @return A new RmgCommandTemplate object
+ */
+RmgCommandTemplate *rmg_command_template_new (const gchar *command_line);
+
+/**
+ * @brief Aquire command template object
+ * @param tmpl Pointer to the command template object
+ */
+RmgCommandTemplate *rmg_command_template_ref (RmgCommandTemplate *tmpl);
+
+/**
+ * @brief Release command template object
+ * @param tmpl Pointer to the command template object
+ */
+void rmg_command_template_unref (RmgCommandTemplate *tmpl);
+
+/**
+ * @brief Create a command from a template
+ * @param tmpl Pointer to the command template object
+ * @param name The label used for the command output in logs
+ * @param values Slot values indexed by RmgCommandSlot, NULL values are replaced with empty strings
+ * @param timeout Seconds before the command is killed
+ * @return A new RmgCommand object
+ */
+RmgCommand *rmg_command_template_instance (RmgCommandTemplate *tmpl, const gchar *name,
+                                           const gchar *const *values, glong timeout);
+
+/**
+ * @brief Aquire command object
+ * @param command Pointer to the command object
+ */
+RmgCommand *rmg_command_ref (RmgCommand *command);
+
+/**
+ * @brief Release command object
+ * @param command Pointer to the command object
+ */
+void rmg_command_unref (RmgCommand *command);
+
+/**
+ * @brief Run the command
+ * The output is logged line by line while the command runs and the callback is called once
+ * from the main context when the process exits, is killed on timeout or fails to spawn.
+ * The command holds a reference on itself until the callback returns.
+ * @param command Pointer to the command object
+ * @param callback The completion callback
+ * @param user_data The completion callback user data
+ */
+void rmg_command_run (RmgCommand *command, RmgCommandCallback callback, gpointer user_data);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgCommand, rmg_command_unref);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgCommandTemplate, rmg_command_template_unref);
+
+G_END_DECLS
@@ -0,0 +1,242 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-crashfilter.c
+ */
+
+#include "rmg-crashfilter.h"
+
+/**
+ * @struct RmgCrashFilterProcess
+ * @brief Last notification of a process in a context
+ */
+typedef struct _RmgCrashFilterProcess
+{
+  gchar *process_name; /**< Process name atom */
+  gchar *context_name; /**< Context name atom */
+  gint64 last_time;    /**< Monotonic time of the last accepted notification */
+  guint coalesced;     /**< Notifications coalesced since the last accepted one */
+  GList *order;        /**< Link in the filter process order queue */
+} RmgCrashFilterProcess;
+
+static guint
+process_hash (gconstpointer _process)
+{
+  const RmgCrashFilterProcess *process = (const RmgCrashFilterProcess *)_process;
+
+  /* names are atoms so the pointers are hashed */
+  return g_direct_hash (process->process_name) ^ (g_direct_hash (process->context_name) * 31);
+}
+
+static gboolean
+process_equal (gconstpointer _a, gconstpointer _b)
+{
+  const RmgCrashFilterProcess *a = (const RmgCrashFilterProcess *)_a;
+  const RmgCrashFilterProcess *b = (const RmgCrashFilterProcess *)_b;
+
+  return a->process_name == b->process_name && a->context_name == b->context_name;
+}
+
+static void
+process_free (gpointer _process)
+{
+  RmgCrashFilterProcess *process = (RmgCrashFilterProcess *)_process;
+
+  g_ref_string_release (process->process_name);
+  g_ref_string_release (process->context_name);
+  g_free (process);
+}
+
+static void
+process_evict_oldest (RmgCrashFilter *filter)
+{
+  RmgCrashFilterProcess *oldest = (RmgCrashFilterProcess *)filter->process_order->head->data;
+
+  g_queue_delete_link (filter->process_order, oldest->order);
+  g_hash_table_remove (filter->processes, oldest);
+}
+
+static void
+crashfilter_report (RmgCrashFilter *filter)
+{
+  g_info ("Crash filter accepted %lu notifications, dropped %lu duplicate crash ids and "
+          "coalesced %lu",
+          (gulong)filter->accepted, (gulong)filter->suppressed_ids,
+          (gulong)filter->suppressed_window);
+
+  filter->reported = filter->suppressed_ids + filter->suppressed_window;
+}
+
+static gboolean
+crash_id_seen (RmgCrashFilter *filter, const gchar *crash_id)
+{
+  GList *link = g_hash_table_lookup (filter->crash_ids, crash_id);
+
+  if (link != NULL)
+    {
+      /* refresh the id as most recent */
+      g_queue_unlink (filter->crash_id_order, link);
+      g_queue_push_tail_link (filter->crash_id_order, link);
+      return TRUE;
+    }
+
+  g_queue_push_tail (filter->crash_id_order, g_strdup (crash_id));
+  g_hash_table_insert (filter->crash_ids, filter->crash_id_order->tail->data,
+                       filter->crash_id_order->tail);
+
+  if (g_queue_get_length (filter->crash_id_order) > filter->capacity)
+    {
+      gchar *oldest = g_queue_pop_head (filter->crash_id_order);
+
+      g_hash_table_remove (filter->crash_ids, oldest);
+      g_free (oldest);
+    }
+
+  return FALSE;
+}
+
+RmgCrashFilter *
+rmg_crashfilter_new (glong window_ms, guint capacity)
+{
+  RmgCrashFilter *filter = g_new0 (RmgCrashFilter, 1);
+
+  g_ref_count_init (&filter->rc);
+
+  filter->capacity = MAX (capacity, 1);
+  filter->window_usec = (gint64)MAX (window_ms, 0) * 1000;
+  filter->crash_ids = g_hash_table_new (g_str_hash, g_str_equal);
+  filter->crash_id_order = g_queue_new ();
+  filter->processes = g_hash_table_new_full (process_hash, process_equal, process_free, NULL);
+  filter->process_order = g_queue_new ();
+
+  return filter;
+}
+
+RmgCrashFilter *
+rmg_crashfilter_ref (RmgCrashFilter *filter)
+{
+  g_assert (filter);
+  g_ref_count_inc (&filter->rc);
+  return filter;
+}
+
+void
+rmg_crashfilter_unref (RmgCrashFilter *filter)
+{
+  g_assert (filter);
+
+  if (g_ref_count_dec (&filter->rc) == TRUE)
+    {
+      crashfilter_report (filter);
+
+      g_queue_free (filter->process_order);
+      g_hash_table_destroy (filter->crash_ids);
+      g_queue_free_full (filter->crash_id_order, g_free);
+      g_hash_table_destroy (filter->processes);
+      g_free (filter);
+    }
+}
+
+gboolean
+rmg_crashfilter_accept (RmgCrashFilter *filter, const gchar *crash_id, const gchar *process_name,
+                        const gchar *context_name)
+{
+  RmgCrashFilterProcess lookup = { NULL };
+  RmgCrashFilterProcess *process = NULL;
+  gint64 now = g_get_monotonic_time ();
+
+  g_assert (filter);
+  g_assert (process_name);
+  g_assert (context_name);
+
+  /* crash handlers may emit the same crash more than once */
+  if (crash_id != NULL && crash_id_seen (filter, crash_id))
+    {
+      filter->suppressed_ids++;
+      g_debug ("Drop duplicate crash id %s for process %s in context %s (total %lu)", crash_id,
+               process_name, context_name, (gulong)filter->suppressed_ids);
+      return FALSE;
+    }
+
+  if (filter->window_usec == 0)
+    {
+      filter->accepted++;
+
+      if (filter->suppressed_ids > filter->reported)
+        crashfilter_report (filter);
+
+      return TRUE;
+    }
+
+  lookup.process_name = g_ref_string_new_intern (process_name);
+  lookup.context_name = g_ref_string_new_intern (context_name);
+
+  process = g_hash_table_lookup (filter->processes, &lookup);
+
+  /* a new process takes over the lookup atoms */
+  if (process != NULL)
+    {
+      g_ref_string_release (lookup.process_name);
+      g_ref_string_release (lookup.context_name);
+    }
+
+  if (process != NULL && (now - process->last_time) < filter->window_usec)
+    {
+      process->coalesced++;
+      filter->suppressed_window++;
+      return FALSE;
+    }
+
+  if (process == NULL)
+    {
+      /* processes are ordered by last accepted notification so expired ones go first */
+      while (g_hash_table_size (filter->processes) >= filter->capacity)
+        process_evict_oldest (filter);
+
+      process = g_new0 (RmgCrashFilterProcess, 1);
+      process->process_name = lookup.process_name;
+      process->context_name = lookup.context_name;
+
+      g_hash_table_add (filter->processes, process);
+      g_queue_push_tail (filter->process_order, process);
+      process->order = filter->process_order->tail;
+    }
+  else
+    {
+      if (process->coalesced > 0)
+        {
+          g_info ("Process '%s' in context '%s' had %u crash notifications coalesced",
+                  process_name, context_name, process->coalesced);
+          process->coalesced = 0;
+        }
+
+      /* refresh the process as most recent */
+      g_queue_unlink (filter->process_order, process->order);
+      g_queue_push_tail_link (filter->process_order, process->order);
+    }
+
+  process->last_time = now;
+  filter->accepted++;
+
+  if (filter->suppressed_ids + filter->suppressed_window > filter->reported)
+    crashfilter_report (filter);
+
+  return TRUE;
+}
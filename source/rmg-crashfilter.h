@@ -0,0 +1,84 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-crashfilter.h
+ */
+
+#pragma once
+
+#include "rmg-types.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgCrashFilter
+ * @brief Deduplication of process crash notifications
+ */
+typedef struct _RmgCrashFilter
+{
+  GHashTable *crash_ids;     /**< Recent crash ids mapped to their order queue link */
+  GQueue *crash_id_order;    /**< Recent crash ids, least recent first */
+  GHashTable *processes;     /**< Last notification per process and context */
+  GQueue *process_order;     /**< Processes by last accepted notification, oldest first */
+  guint capacity;            /**< Maximum crash ids and processes remembered */
+  gint64 window_usec;        /**< Window coalescing crashes of the same process */
+  guint64 accepted;          /**< Notifications passed to the dispatcher */
+  guint64 suppressed_ids;    /**< Notifications dropped as duplicate crash id */
+  guint64 suppressed_window; /**< Notifications coalesced in the process window */
+  guint64 reported;          /**< Suppressed notifications covered by the last report */
+  grefcount rc;              /**< Reference counter variable  */
+} RmgCrashFilter;
+
+/*
+ * @brief Create a new crash filter object
+ * @param window_ms Window in milliseconds coalescing crashes of the same process, 0 disables
+ * @param capacity Maximum number of crash ids and processes remembered
+ * @return A new RmgCrashFilter object
+ */
+RmgCrashFilter *rmg_crashfilter_new (glong window_ms, guint capacity);
+
+/**
+ * @brief Aquire crash filter object
+ * @param filter Pointer to the crash filter object
+ */
+RmgCrashFilter *rmg_crashfilter_ref (RmgCrashFilter *filter);
+
+/**
+ * @brief Release crash filter object
+ * @param filter Pointer to the crash filter object
+ */
+void rmg_crashfilter_unref (RmgCrashFilter *filter);
+
+/**
+ * @brief Check if a crash notification should be dispatched
+ * @param filter Pointer to the crash filter object
+ * @param crash_id The crash id or NULL if the source does not provide one
+ * @param process_name The process name
+ * @param context_name The context name
+ * @return TRUE if the notification is new, FALSE if it is a duplicate
+ */
+gboolean rmg_crashfilter_accept (RmgCrashFilter *filter, const gchar *crash_id,
+                                 const gchar *process_name, const gchar *context_name);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgCrashFilter, rmg_crashfilter_unref);
+
+G_END_DECLS
@@ -34,11 +34,6 @@ const gchar *cdm_dbus_interface_crashes = "ro.fxdata.crashmanager.Crashes";
  */
 static void post_crashmonitor_event (RmgCrashMonitor *crashmonitor, CrashMonitorEventType type);
 
-/**
- * @brief GSource prepare function
- */
-static gboolean crashmonitor_source_prepare (GSource *source, gint *timeout);
-
 /**
  * @brief GSource dispatch function
  */
@@ -55,11 +50,6 @@ static gboolean crashmonitor_source_callback (gpointer _crashmonitor, gpointer _
  */
 static void crashmonitor_source_destroy_notify (gpointer _crashmonitor);
 
-/**
- * @brief Async queue destroy notification callback function
- */
-static void crashmonitor_queue_destroy_notify (gpointer _crashmonitor);
-
 /**
  * @brief Build proxy local
  */
@@ -74,7 +64,7 @@ static void call_notify_proxy_entry (gpointer _notify_object, gpointer _dbus_pro
  * @brief GSourceFuncs vtable
  */
 static GSourceFuncs crashmonitor_source_funcs = {
-  crashmonitor_source_prepare, NULL, crashmonitor_source_dispatch, NULL, NULL, NULL,
+  NULL, NULL, crashmonitor_source_dispatch, NULL, NULL, NULL,
 };
 
 static void
@@ -87,32 +77,21 @@ post_crashmonitor_event (RmgCrashMonitor *crashmonitor, CrashMonitorEventType ty
   e = g_new0 (RmgCrashMonitorEvent, 1);
   e->type = type;
 
-  g_async_queue_push (crashmonitor->queue, e);
-}
-
-static gboolean
-crashmonitor_source_prepare (GSource *source, gint *timeout)
-{
-  RmgCrashMonitor *crashmonitor = (RmgCrashMonitor *)source;
-
-  RMG_UNUSED (timeout);
-
-  return (g_async_queue_length (crashmonitor->queue) > 0);
+  rmg_eventqueue_push (crashmonitor->queue, e);
 }
 
 static gboolean
 crashmonitor_source_dispatch (GSource *source, GSourceFunc callback, gpointer _crashmonitor)
 {
   RmgCrashMonitor *crashmonitor = (RmgCrashMonitor *)source;
-  gpointer event = g_async_queue_try_pop (crashmonitor->queue);
 
   RMG_UNUSED (callback);
   RMG_UNUSED (_crashmonitor);
 
-  if (event == NULL)
-    return G_SOURCE_CONTINUE;
+  if (!rmg_eventqueue_dispatch (crashmonitor->queue, crashmonitor->callback, crashmonitor))
+    return G_SOURCE_REMOVE;
 
-  return crashmonitor->callback (crashmonitor, event) == TRUE ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+  return G_SOURCE_CONTINUE;
 }
 
 static gboolean
@@ -150,13 +129,6 @@ crashmonitor_source_destroy_notify (gpointer _crashmonitor)
   rmg_crashmonitor_unref (crashmonitor);
 }
 
-static void
-crashmonitor_queue_destroy_notify (gpointer _crashmonitor)
-{
-  RMG_UNUSED (_crashmonitor);
-  g_debug ("CrashMonitor queue destroy notification");
-}
-
 static void
 on_manager_signal (GDBusProxy *proxy, gchar *sender_name, gchar *signal_name, GVariant *parameters,
                    gpointer user_data)
@@ -172,11 +144,17 @@ on_manager_signal (GDBusProxy *proxy, gchar *sender_name, gchar *signal_name, GV
       const gchar *proc_context = NULL;
       const gchar *proc_crashid = NULL;
 
-      g_variant_get (parameters, "(sss)", &proc_name, &proc_context, &proc_crashid);
+      g_variant_get (parameters, "(&s&s&s)", &proc_name, &proc_context, &proc_crashid);
 
       if ((proc_name != NULL) && (proc_context != NULL) && (proc_crashid != NULL))
         {
-          RmgDEvent *event = rmg_devent_new (DEVENT_INFORM_PROCESS_CRASH);
+          RmgDEvent *event = NULL;
+
+          if (!rmg_crashfilter_accept (crashmonitor->dispatcher->crashfilter, proc_crashid,
+                                       proc_name, proc_context))
+            return;
+
+          event = rmg_devent_new (DEVENT_INFORM_PROCESS_CRASH);
 
           rmg_devent_set_process_name (event, proc_name);
           rmg_devent_set_context_name (event, proc_context);
@@ -253,7 +231,12 @@ rmg_crashmonitor_new (RmgDispatcher *dispatcher)
 
   g_ref_count_init (&crashmonitor->rc);
   crashmonitor->dispatcher = rmg_dispatcher_ref (dispatcher);
-  crashmonitor->queue = g_async_queue_new_full (crashmonitor_queue_destroy_notify);
+  /* control events are few and must not be lost */
+  crashmonitor->queue = rmg_eventqueue_new ("crashmonitor", RMG_EVENTQUEUE_CONTROL_SIZE,
+                                            RMG_EVENTQUEUE_CONTROL_SIZE, EVENTQUEUE_OVERFLOW_GROW,
+                                            g_free);
+  g_source_add_unix_fd (RMG_EVENT_SOURCE (crashmonitor),
+                        rmg_eventqueue_get_fd (crashmonitor->queue), G_IO_IN);
   crashmonitor->callback = crashmonitor_source_callback;
 
   g_source_set_callback (RMG_EVENT_SOURCE (crashmonitor), NULL, crashmonitor,
@@ -284,7 +267,7 @@ rmg_crashmonitor_unref (RmgCrashMonitor *crashmonitor)
       if (crashmonitor->proxy != NULL)
         g_object_unref (crashmonitor->proxy);
 
-      g_async_queue_unref (crashmonitor->queue);
+      rmg_eventqueue_unref (crashmonitor->queue);
       g_list_free_full (crashmonitor->notify_proxy, remove_notify_proxy_entry);
       g_source_unref (RMG_EVENT_SOURCE (crashmonitor));
     }
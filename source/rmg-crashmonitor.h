@@ -24,6 +24,7 @@
 #pragma once
 
 #include "rmg-dispatcher.h"
+#include "rmg-eventqueue.h"
 #include "rmg-types.h"
 
 #include <gio/gio.h>
@@ -70,7 +71,7 @@ typedef struct _RmgCrashMonitorNotifyProxy
 typedef struct _RmgCrashMonitor
 {
   GSource source;                   /**< Event loop source */
-  GAsyncQueue *queue;               /**< Async queue */
+  RmgEventQueue *queue;             /**< Event queue */
   RmgCrashMonitorCallback callback; /**< Callback function */
   RmgDispatcher *dispatcher;
   grefcount rc;
@@ -0,0 +1,567 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-datareset.c
+ */
+
+#include "rmg-datareset.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1)
+#endif
+
+#define DATARESET_IOPRIO_WHO_PROCESS (1)
+#define DATARESET_IOPRIO_CLASS_IDLE (3)
+#define DATARESET_IOPRIO_CLASS_SHIFT (13)
+
+#define DATARESET_DENTS_BUFFER (32768)
+#define DATARESET_PROGRESS_SEC (5)
+
+/* the root task has an empty name which no directory entry can have */
+#define DATARESET_ROOT_TASK ""
+
+/**
+ * @struct DataResetDirent
+ * @brief Directory entry layout returned by getdents64
+ */
+typedef struct _DataResetDirent
+{
+  guint64 d_ino;
+  gint64 d_off;
+  gushort d_reclen;
+  guchar d_type;
+  gchar d_name[];
+} DataResetDirent;
+
+/**
+ * @struct DataResetEntry
+ * @brief A directory entry read before the directory is modified
+ */
+typedef struct _DataResetEntry
+{
+  gchar *name;
+  guchar type;
+} DataResetEntry;
+
+/**
+ * @brief Remove the content of an open directory
+ * @param spread Push the subdirectories to the worker pool instead of removing them in place
+ */
+static void datareset_clear (RmgDataReset *reset, gint fd, const gchar *name, gboolean spread);
+
+/**
+ * @brief Report the completion in the main context
+ */
+static gboolean datareset_complete_cb (gpointer _reset);
+
+static void
+datareset_error (RmgDataReset *reset, const gchar *name, gint error)
+{
+  g_atomic_int_inc (&reset->errors);
+  g_debug ("Data reset %s fail on '%s'. Error %s", reset->name, name, g_strerror (error));
+}
+
+static void
+datareset_throttle (RmgDataReset *reset)
+{
+  gint64 now = 0;
+
+  if (reset->rate == 0)
+    return;
+
+  /* background resets run a single worker so the pacing state is not shared */
+  now = g_get_monotonic_time ();
+  reset->next_time = MAX (reset->next_time, now - G_USEC_PER_SEC) + G_USEC_PER_SEC / reset->rate;
+
+  if (reset->next_time > now)
+    g_usleep ((gulong)(reset->next_time - now));
+}
+
+static void
+datareset_entry_clear (gpointer _entry)
+{
+  g_free (((DataResetEntry *)_entry)->name);
+}
+
+static GArray *
+datareset_read_entries (RmgDataReset *reset, gint fd, const gchar *name)
+{
+  GArray *entries = g_array_new (FALSE, FALSE, sizeof (DataResetEntry));
+  guint64 buffer[DATARESET_DENTS_BUFFER / sizeof (guint64)];
+  glong count = 0;
+
+  g_array_set_clear_func (entries, datareset_entry_clear);
+
+  /* the whole listing is read first since removing entries while reading may skip some */
+  while ((count = syscall (SYS_getdents64, fd, buffer, sizeof (buffer))) > 0)
+    {
+      glong offset = 0;
+
+      while (offset < count)
+        {
+          DataResetDirent *dirent = (DataResetDirent *)((gchar *)buffer + offset);
+
+          offset += dirent->d_reclen;
+
+          if (g_strcmp0 (dirent->d_name, ".") != 0 && g_strcmp0 (dirent->d_name, "..") != 0)
+            {
+              DataResetEntry entry = { g_strdup (dirent->d_name), dirent->d_type };
+
+              g_array_append_val (entries, entry);
+            }
+        }
+    }
+
+  if (count < 0)
+    datareset_error (reset, name, errno);
+
+  return entries;
+}
+
+static void
+datareset_release (RmgDataReset *reset)
+{
+  if (g_atomic_int_dec_and_test (&reset->pending))
+    g_idle_add (datareset_complete_cb, reset);
+}
+
+static void
+datareset_remove_directory (RmgDataReset *reset, gint parent_fd, const gchar *name)
+{
+  struct stat st;
+  gint fd;
+
+  /* a directory replaced with a symbolic link is not followed */
+  fd = openat (parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    {
+      datareset_error (reset, name, errno);
+      return;
+    }
+
+  if (fstat (fd, &st) != 0 || st.st_dev != reset->device)
+    {
+      /* mount points inside the data directory are left in place */
+      datareset_error (reset, name, EXDEV);
+      close (fd);
+      return;
+    }
+
+  datareset_clear (reset, fd, name, FALSE);
+  close (fd);
+
+  if (unlinkat (parent_fd, name, AT_REMOVEDIR) == 0)
+    g_atomic_int_inc (&reset->directories);
+  else
+    datareset_error (reset, name, errno);
+
+  datareset_throttle (reset);
+}
+
+static void
+datareset_clear (RmgDataReset *reset, gint fd, const gchar *name, gboolean spread)
+{
+  g_autoptr (GArray) entries = datareset_read_entries (reset, fd, name);
+
+  for (guint i = 0; i < entries->len; i++)
+    {
+      DataResetEntry *entry = &g_array_index (entries, DataResetEntry, i);
+      gboolean is_directory = entry->type == DT_DIR;
+
+      /* the root is cleared as the shell glob of the reset command which skips hidden entries */
+      if (spread && entry->name[0] == '.')
+        continue;
+
+      if (entry->type == DT_UNKNOWN)
+        {
+          struct stat st;
+
+          if (fstatat (fd, entry->name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+              datareset_error (reset, entry->name, errno);
+              continue;
+            }
+
+          is_directory = S_ISDIR (st.st_mode);
+        }
+
+      if (!is_directory)
+        {
+          if (unlinkat (fd, entry->name, 0) == 0)
+            g_atomic_int_inc (&reset->files);
+          else
+            datareset_error (reset, entry->name, errno);
+
+          datareset_throttle (reset);
+        }
+      else if (spread)
+        {
+          g_atomic_int_inc (&reset->pending);
+          g_thread_pool_push (reset->pool, g_strdup (entry->name), NULL);
+        }
+      else
+        datareset_remove_directory (reset, fd, entry->name);
+    }
+}
+
+static void
+datareset_worker (gpointer _name, gpointer _reset)
+{
+  RmgDataReset *reset = (RmgDataReset *)_reset;
+  g_autofree gchar *name = (gchar *)_name;
+
+  if (reset->background)
+    {
+      /* the pool threads are exclusive to this reset so the priorities do not leak */
+      (void)syscall (SYS_ioprio_set, DATARESET_IOPRIO_WHO_PROCESS, 0,
+                     DATARESET_IOPRIO_CLASS_IDLE << DATARESET_IOPRIO_CLASS_SHIFT);
+      (void)setpriority (PRIO_PROCESS, (id_t)syscall (SYS_gettid), 19);
+    }
+
+  /* the subdirectories of the root are spread across the workers */
+  if (g_strcmp0 (name, DATARESET_ROOT_TASK) == 0)
+    datareset_clear (reset, reset->root_fd, reset->path, TRUE);
+  else
+    datareset_remove_directory (reset, reset->root_fd, name);
+
+  datareset_release (reset);
+}
+
+static gboolean
+datareset_progress_cb (gpointer _reset)
+{
+  RmgDataReset *reset = (RmgDataReset *)_reset;
+
+  g_info ("Data reset %s of '%s' in progress, removed %d files %d directories", reset->name,
+          reset->path, g_atomic_int_get (&reset->files), g_atomic_int_get (&reset->directories));
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+datareset_complete_cb (gpointer _reset)
+{
+  RmgDataReset *reset = (RmgDataReset *)_reset;
+  RmgDataResetCallback callback = reset->callback;
+
+  reset->duration = g_get_monotonic_time () - reset->start_time;
+
+  if (reset->progress_source != 0)
+    {
+      g_source_remove (reset->progress_source);
+      reset->progress_source = 0;
+    }
+
+  /* the last worker is leaving its task */
+  if (reset->pool != NULL)
+    {
+      g_thread_pool_free (reset->pool, FALSE, TRUE);
+      reset->pool = NULL;
+    }
+
+  if (reset->root_fd >= 0)
+    {
+      close (reset->root_fd);
+      reset->root_fd = -1;
+    }
+
+  g_info ("Data reset %s of '%s' removed %d files %d directories with %d errors in %ldms",
+          reset->name, reset->path, reset->files, reset->directories, reset->errors,
+          (glong)(reset->duration / 1000));
+
+  reset->callback = NULL;
+  callback (reset, reset->user_data);
+
+  /* release the reference taken by rmg_datareset_run */
+  rmg_datareset_unref (reset);
+
+  return G_SOURCE_REMOVE;
+}
+
+RmgDataReset *
+rmg_datareset_new (const gchar *name, const gchar *path, glong workers, GError **error)
+{
+  RmgDataReset *reset = NULL;
+
+  g_assert (name);
+
+  if (path == NULL)
+    {
+      g_set_error (error, g_quark_from_static_string ("DataResetNew"), EINVAL,
+                   "No data directory configured");
+      return NULL;
+    }
+
+  reset = g_new0 (RmgDataReset, 1);
+
+  g_ref_count_init (&reset->rc);
+
+  reset->name = g_strdup (name);
+  reset->path = g_strdup (path);
+  reset->workers = (guint)CLAMP (workers, 1, 64);
+  reset->root_fd = -1;
+
+  return reset;
+}
+
+RmgDataReset *
+rmg_datareset_ref (RmgDataReset *reset)
+{
+  g_assert (reset);
+  g_ref_count_inc (&reset->rc);
+  return reset;
+}
+
+void
+rmg_datareset_unref (RmgDataReset *reset)
+{
+  g_assert (reset);
+
+  if (g_ref_count_dec (&reset->rc) == TRUE)
+    {
+      g_free (reset->name);
+      g_free (reset->path);
+      g_free (reset);
+    }
+}
+
+void
+rmg_datareset_run (RmgDataReset *reset, RmgDataResetCallback callback, gpointer user_data)
+{
+  g_autoptr (GError) error = NULL;
+  struct stat st;
+
+  g_assert (reset);
+  g_assert (callback);
+  g_assert (reset->callback == NULL);
+
+  reset->callback = callback;
+  reset->user_data = user_data;
+  reset->start_time = g_get_monotonic_time ();
+
+  /* released once the callback returns */
+  rmg_datareset_ref (reset);
+
+  if (!g_path_is_absolute (reset->path) || g_strcmp0 (reset->path, "/") == 0)
+    {
+      g_warning ("Data reset %s refuses to clear path '%s'", reset->name, reset->path);
+      reset->errors++;
+      g_idle_add (datareset_complete_cb, reset);
+      return;
+    }
+
+  reset->root_fd = open (reset->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (reset->root_fd < 0 || fstat (reset->root_fd, &st) != 0)
+    {
+      g_warning ("Data reset %s fail to open '%s'. Error %s", reset->name, reset->path,
+                 g_strerror (errno));
+      reset->errors++;
+      g_idle_add (datareset_complete_cb, reset);
+      return;
+    }
+
+  reset->device = st.st_dev;
+  reset->pending = 1;
+
+  reset->pool = g_thread_pool_new (datareset_worker, reset, (gint)reset->workers,
+                                   reset->background, &error);
+  if (reset->pool == NULL)
+    {
+      g_warning ("Data reset %s fail to create workers. Error %s", reset->name, error->message);
+      reset->errors++;
+      g_idle_add (datareset_complete_cb, reset);
+      return;
+    }
+
+  reset->progress_source
+      = g_timeout_add_seconds (DATARESET_PROGRESS_SEC, datareset_progress_cb, reset);
+
+  g_thread_pool_push (reset->pool, g_strdup (DATARESET_ROOT_TASK), NULL);
+}
+
+void
+rmg_datareset_set_background (RmgDataReset *reset, glong rate)
+{
+  g_assert (reset);
+  g_assert (reset->callback == NULL);
+
+  reset->background = TRUE;
+  reset->workers = 1;
+  reset->rate = (guint)CLAMP (rate, 0, G_USEC_PER_SEC);
+}
+
+static void
+datareset_keep_hidden (gint trash_fd, const gchar *entry, gint data_fd)
+{
+  struct dirent *dirent = NULL;
+  DIR *dir = NULL;
+  gint fd;
+
+  fd = openat (trash_fd, entry, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0 || (dir = fdopendir (fd)) == NULL)
+    {
+      g_warning ("Fail to open swapped data '%s'. Error %s", entry, g_strerror (errno));
+      if (fd >= 0)
+        close (fd);
+      return;
+    }
+
+  /* hidden entries are moved back to match the shell glob of the reset command */
+  while ((dirent = readdir (dir)) != NULL)
+    {
+      if (dirent->d_name[0] != '.' || g_strcmp0 (dirent->d_name, ".") == 0
+          || g_strcmp0 (dirent->d_name, "..") == 0)
+        continue;
+
+      if (renameat (fd, dirent->d_name, data_fd, dirent->d_name) != 0)
+        g_warning ("Fail to keep hidden data '%s'. Error %s", dirent->d_name, g_strerror (errno));
+    }
+
+  closedir (dir);
+}
+
+gboolean
+rmg_datareset_swap (const gchar *path, const gchar *tag, gchar **trash_path, GError **error)
+{
+  g_autofree gchar *parent = NULL;
+  g_autofree gchar *base = NULL;
+  g_autofree gchar *entry = NULL;
+  const gchar *step = NULL;
+  struct stat st;
+  gint parent_fd = -1;
+  gint trash_fd = -1;
+  gint fd = -1;
+  gint saved_errno = 0;
+
+  g_assert (tag);
+  g_assert (trash_path);
+
+  if (path == NULL)
+    {
+      g_set_error (error, g_quark_from_static_string ("DataResetSwap"), EINVAL,
+                   "No data directory configured");
+      return FALSE;
+    }
+
+  if (!g_path_is_absolute (path) || g_strcmp0 (path, "/") == 0)
+    {
+      g_set_error (error, g_quark_from_static_string ("DataResetSwap"), EINVAL,
+                   "Refuse to swap path '%s'", path);
+      return FALSE;
+    }
+
+  parent = g_path_get_dirname (path);
+  base = g_path_get_basename (path);
+  entry = g_strdup_printf ("%s-%s-%" G_GINT64_FORMAT, tag, base, g_get_real_time ());
+
+  step = "open parent directory";
+  parent_fd = open (parent, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (parent_fd < 0)
+    goto fail;
+
+  step = "stat data directory";
+  if (fstatat (parent_fd, base, &st, AT_SYMLINK_NOFOLLOW) != 0)
+    goto fail;
+
+  if (!S_ISDIR (st.st_mode))
+    {
+      errno = ENOTDIR;
+      goto fail;
+    }
+
+  step = "create trash directory";
+  if (mkdirat (parent_fd, RMG_DATARESET_TRASH, 0700) != 0 && errno != EEXIST)
+    goto fail;
+
+  trash_fd = openat (parent_fd, RMG_DATARESET_TRASH,
+                     O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (trash_fd < 0)
+    goto fail;
+
+  step = "create empty directory";
+  if (mkdirat (trash_fd, entry, 0700) != 0)
+    goto fail;
+
+  fd = openat (trash_fd, entry, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0 || fchown (fd, st.st_uid, st.st_gid) != 0 || fchmod (fd, st.st_mode & 07777) != 0)
+    goto fail_entry;
+
+  /* the data path never disappears, it refers to the old or to the empty directory */
+  step = "exchange directories";
+  if (syscall (SYS_renameat2, parent_fd, base, trash_fd, entry, RENAME_EXCHANGE) != 0)
+    goto fail_entry;
+
+  datareset_keep_hidden (trash_fd, entry, fd);
+
+  close (fd);
+  close (trash_fd);
+  close (parent_fd);
+
+  *trash_path = g_build_filename (parent, RMG_DATARESET_TRASH, NULL);
+
+  return TRUE;
+
+fail_entry:
+  saved_errno = errno;
+  (void)unlinkat (trash_fd, entry, AT_REMOVEDIR);
+  errno = saved_errno;
+
+fail:
+  saved_errno = errno;
+
+  if (fd >= 0)
+    close (fd);
+
+  if (trash_fd >= 0)
+    close (trash_fd);
+
+  if (parent_fd >= 0)
+    close (parent_fd);
+
+  g_set_error (error, g_quark_from_static_string ("DataResetSwap"), saved_errno,
+               "Fail to %s for '%s': %s", step, path, g_strerror (saved_errno));
+
+  return FALSE;
+}
+
+RmgDataResetMode
+rmg_datareset_mode_from (const gchar *name)
+{
+  if (g_strcmp0 (name, "command") == 0)
+    return DATA_RESET_MODE_COMMAND;
+  else if (g_strcmp0 (name, "swap") == 0)
+    return DATA_RESET_MODE_SWAP;
+  else if (g_strcmp0 (name, "native") == 0)
+    return DATA_RESET_MODE_NATIVE;
+
+  g_warning ("Unknown data reset mode '%s', using command", name);
+
+  return DATA_RESET_MODE_COMMAND;
+}
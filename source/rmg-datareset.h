@@ -0,0 +1,146 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-datareset.h
+ */
+
+#pragma once
+
+#include "rmg-types.h"
+
+#include <glib.h>
+#include <sys/types.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @brief Directory next to the data directories holding the swapped out data
+ */
+#define RMG_DATARESET_TRASH ".recoverymanager-trash"
+
+/**
+ * @enum RmgDataResetMode
+ * @brief How service data is reset
+ */
+typedef enum _RmgDataResetMode
+{
+  DATA_RESET_MODE_NATIVE,
+  DATA_RESET_MODE_COMMAND,
+  DATA_RESET_MODE_SWAP
+} RmgDataResetMode;
+
+/**
+ * @function RmgDataResetCallback
+ * @brief Data reset completion callback
+ */
+typedef void (*RmgDataResetCallback) (gpointer _reset, gpointer user_data);
+
+/**
+ * @struct RmgDataReset
+ * @brief Clears the content of a data directory in-process
+ */
+typedef struct _RmgDataReset
+{
+  gchar *name;                   /**< Label used in logs */
+  gchar *path;                   /**< The directory cleared */
+  guint workers;                 /**< Threads clearing subdirectories in parallel */
+  guint rate;                    /**< Entries removed per second, 0 for no limit */
+  gboolean background;           /**< Run at idle I/O priority and lowest CPU priority */
+  gint64 next_time;              /**< Monotonic time the next entry may be removed */
+  GThreadPool *pool;             /**< Workers of the run in progress */
+  gint root_fd;                  /**< The open directory cleared */
+  dev_t device;                  /**< Device of the directory, other filesystems are kept */
+  gint pending;                  /**< Tasks not yet completed, atomic */
+  gint files;                    /**< Files removed, atomic */
+  gint directories;              /**< Directories removed, atomic */
+  gint errors;                   /**< Entries failed to remove, atomic */
+  gint64 start_time;             /**< Monotonic time of the run start */
+  gint64 duration;               /**< Run duration in microseconds */
+  guint progress_source;         /**< Progress report timer */
+  RmgDataResetCallback callback; /**< Completion callback */
+  gpointer user_data;            /**< Completion callback user data */
+  grefcount rc;                  /**< Reference counter variable  */
+} RmgDataReset;
+
+/*
+ * @brief Create a new data reset object
+ * @param name The label used in logs
+ * @param path The absolute path of the directory to clear
+ * @param workers Threads clearing subdirectories in parallel
+ * @param error The GError object set if no path is given
+ * @return A new RmgDataReset object or NULL on error
+ */
+RmgDataReset *rmg_datareset_new (const gchar *name, const gchar *path, glong workers,
+                                 GError **error);
+
+/**
+ * @brief Aquire data reset object
+ * @param reset Pointer to the data reset object
+ */
+RmgDataReset *rmg_datareset_ref (RmgDataReset *reset);
+
+/**
+ * @brief Release data reset object
+ * @param reset Pointer to the data reset object
+ */
+void rmg_datareset_unref (RmgDataReset *reset);
+
+/**
+ * @brief Run the reset as a low priority background job
+ * A single worker at idle I/O priority removes at most rate entries per second
+ * @param reset Pointer to the data reset object
+ * @param rate Entries removed per second, 0 for no limit
+ */
+void rmg_datareset_set_background (RmgDataReset *reset, glong rate);
+
+/**
+ * @brief Remove the directory content without following symbolic links
+ * The directory itself and its hidden entries are kept. The callback is called once from the
+ * main context when all entries were processed. The reset holds a reference on itself until the
+ * callback returns.
+ * @param reset Pointer to the data reset object
+ * @param callback The completion callback
+ * @param user_data The completion callback user data
+ */
+void rmg_datareset_run (RmgDataReset *reset, RmgDataResetCallback callback, gpointer user_data);
+
+/**
+ * @brief Replace a data directory with an empty one in a single rename
+ * An empty directory with the owner and mode of the data directory is created in the trash
+ * directory next to it and exchanged with the data directory. The data is left in the trash
+ * directory for the reaper and the hidden entries are moved back. Both directories have to be
+ * on the same filesystem.
+ * @param path The absolute path of the data directory, NULL fails with an error
+ * @param tag Prefix of the trash entry name
+ * @param trash_path Return location of the trash directory path
+ * @param error The GError object or NULL
+ * @return TRUE if the data directory was swapped
+ */
+gboolean rmg_datareset_swap (const gchar *path, const gchar *tag, gchar **trash_path,
+                             GError **error);
+
+/**
+ * @brief Get the data reset mode from its name
+ */
+RmgDataResetMode rmg_datareset_mode_from (const gchar *name);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgDataReset, rmg_datareset_unref);
+
+G_END_DECLS
@@ -22,13 +22,45 @@
  */
 
 #include "rmg-devent.h"
+#include "rmg-pool.h"
+#include "rmg-utils.h"
+
+/* shared by all modules creating dispatcher events for the process lifetime */
+static RmgPool *devent_pool = NULL;
+
+void
+rmg_devent_init_pool (guint capacity)
+{
+  g_assert (devent_pool == NULL);
+  devent_pool = rmg_pool_new ("devent", sizeof (RmgDEvent), capacity);
+}
+
+void
+rmg_devent_release_pool (void)
+{
+  if (devent_pool == NULL)
+    return;
+
+  /* events still referenced by attached sources keep the slab alive */
+  if (rmg_pool_report (devent_pool) == 0)
+    {
+      rmg_pool_unref (devent_pool);
+      devent_pool = NULL;
+    }
+}
 
 RmgDEvent *
 rmg_devent_new (DispatcherEventType type)
 {
-  RmgDEvent *event = g_new0 (RmgDEvent, 1);
+  RmgDEvent *event = NULL;
+
+  if (devent_pool != NULL)
+    event = (RmgDEvent *)rmg_pool_alloc0 (devent_pool);
+  else
+    event = g_new0 (RmgDEvent, 1);
 
   event->type = type;
+  event->weight = 1;
   g_ref_count_init (&event->rc);
 
   return event;
@@ -49,22 +81,19 @@ rmg_devent_unref (RmgDEvent *event)
 
   if (g_ref_count_dec (&event->rc) == TRUE)
     {
-      if (event->service_name != NULL)
-        g_free (event->service_name);
-
-      if (event->process_name != NULL)
-        g_free (event->process_name);
-
-      if (event->object_path != NULL)
-        g_free (event->object_path);
-
-      if (event->context_name != NULL)
-        g_free (event->context_name);
+      g_clear_pointer (&event->service_name, g_ref_string_release);
+      g_clear_pointer (&event->process_name, g_ref_string_release);
+      g_clear_pointer (&event->object_path, g_ref_string_release);
+      g_clear_pointer (&event->context_name, g_ref_string_release);
 
       if (event->manager_proxy != NULL)
         g_object_unref (event->manager_proxy);
 
-      g_free (event);
+      /* the pool returns events allocated before its creation to the heap */
+      if (devent_pool != NULL)
+        rmg_pool_free (devent_pool, event);
+      else
+        g_free (event);
     }
 }
 
@@ -79,28 +108,28 @@ void
 rmg_devent_set_service_name (RmgDEvent *event, const gchar *service_name)
 {
   g_assert (event);
-  event->service_name = g_strdup (service_name);
+  rmg_utils_set_name (&event->service_name, service_name);
 }
 
 void
 rmg_devent_set_process_name (RmgDEvent *event, const gchar *process_name)
 {
   g_assert (event);
-  event->process_name = g_strdup (process_name);
+  rmg_utils_set_name (&event->process_name, process_name);
 }
 
 void
 rmg_devent_set_object_path (RmgDEvent *event, const gchar *object_path)
 {
   g_assert (event);
-  event->object_path = g_strdup (object_path);
+  rmg_utils_set_name (&event->object_path, object_path);
 }
 
 void
 rmg_devent_set_context_name (RmgDEvent *event, const gchar *context_name)
 {
   g_assert (event);
-  event->context_name = g_strdup (context_name);
+  rmg_utils_set_name (&event->context_name, context_name);
 }
 
 void
@@ -109,3 +138,28 @@ rmg_devent_set_manager_proxy (RmgDEvent *event, GDBusProxy *manager_proxy)
   g_assert (event);
   event->manager_proxy = g_object_ref (manager_proxy);
 }
+
+void
+rmg_devent_set_weight (RmgDEvent *event, glong weight)
+{
+  g_assert (event);
+  event->weight = weight;
+}
+
+void
+rmg_devent_set_failure (RmgDEvent *event, RmgFailureReason failure_reason, gint32 exit_code,
+                        gint32 exit_status)
+{
+  g_assert (event);
+
+  event->failure_reason = failure_reason;
+  event->exit_code = exit_code;
+  event->exit_status = exit_status;
+}
+
+void
+rmg_devent_set_escalate (RmgDEvent *event, const gchar *escalate)
+{
+  g_assert (event);
+  event->escalate = escalate;
+}
@@ -41,6 +41,8 @@ typedef enum _DispatcherEventType
   DEVENT_INFORM_SERVICE_FAILED,
   DEVENT_SERVICE_CRASHED,
   DEVENT_SERVICE_RESTARTED,
+  DEVENT_SERVICE_RECOVERED,
+  DEVENT_SERVICE_RECOVERY_FAILED,
   DEVENT_REMOTE_CONTEXT_RESTART,
   DEVENT_REMOTE_PLATFORM_RESTART,
   DEVENT_REMOTE_FACTORY_RESET
@@ -52,15 +54,33 @@ typedef enum _DispatcherEventType
  */
 typedef struct _RmgDEvent
 {
-  DispatcherEventType type;  /**< The event type the element holds */
-  gchar *service_name;       /**< Service name for the event */
-  gchar *process_name;       /**< Proccess name for the event */
-  gchar *object_path;        /**< Service object path */
-  gchar *context_name;       /**< Service context name */
-  GDBusProxy *manager_proxy; /**< Systemd manager proxy */
-  grefcount rc;              /**< Reference counter variable  */
+  DispatcherEventType type;        /**< The event type the element holds */
+  gchar *service_name;             /**< Service name for the event (atom) */
+  gchar *process_name;             /**< Proccess name for the event (atom) */
+  gchar *object_path;              /**< Service object path (atom) */
+  gchar *context_name;             /**< Service context name (atom) */
+  GDBusProxy *manager_proxy;       /**< Systemd manager proxy */
+  glong weight;                    /**< Number of failures the event accounts for */
+  RmgFailureReason failure_reason; /**< Crash reason from the unit Result */
+  gint32 exit_code;                /**< Main process ExecMainCode (CLD_*) */
+  gint32 exit_status;              /**< Main process exit status or signal number */
+  const gchar *escalate;           /**< Why the crash escalates the action or NULL */
+  grefcount rc;                    /**< Reference counter variable  */
 } RmgDEvent;
 
+/**
+ * @brief Preallocate the dispatcher events
+ * Events are allocated from the heap until the pool is created
+ * @param capacity The number of events preallocated
+ */
+void rmg_devent_init_pool (guint capacity);
+
+/**
+ * @brief Report the dispatcher event pool counters at shutdown
+ * The pool is freed only when no event still holds a slab block
+ */
+void rmg_devent_release_pool (void);
+
 /*
  * @brief Create a new dispatcher event object
  * @return The new RmgDispatcher object
@@ -86,6 +106,7 @@ void rmg_devent_set_type (RmgDEvent *event, DispatcherEventType type);
 
 /**
  * @brief Set dispatcher event service name
+ * The event holds the names as atoms released with the event
  */
 void rmg_devent_set_service_name (RmgDEvent *event, const gchar *service_name);
 
@@ -109,6 +130,24 @@ void rmg_devent_set_context_name (RmgDEvent *event, const gchar *context_name);
  */
 void rmg_devent_set_manager_proxy (RmgDEvent *event, GDBusProxy *manager_proxy);
 
+/**
+ * @brief Set the number of coalesced failures the event accounts for
+ */
+void rmg_devent_set_weight (RmgDEvent *event, glong weight);
+
+/**
+ * @brief Set the failure reason and main process exit details of a crash event
+ */
+void rmg_devent_set_failure (RmgDEvent *event, RmgFailureReason failure_reason, gint32 exit_code,
+                             gint32 exit_status);
+
+/**
+ * @brief Mark a crash event as escalating the service to its next action
+ * @param event Pointer to the event object
+ * @param escalate Static description of the escalation cause or NULL
+ */
+void rmg_devent_set_escalate (RmgDEvent *event, const gchar *escalate);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgDEvent, rmg_devent_unref);
 
 G_END_DECLS
@@ -31,11 +31,6 @@
  */
 static void post_dispatcher_event (RmgDispatcher *dispatcher, RmgDEvent *event);
 
-/**
- * @brief GSource prepare function
- */
-static gboolean dispatcher_source_prepare (GSource *source, gint *timeout);
-
 /**
  * @brief GSource dispatch function
  */
@@ -52,11 +47,6 @@ static gboolean dispatcher_source_callback (gpointer _dispatcher, gpointer _even
  */
 static void dispatcher_source_destroy_notify (gpointer _dispatcher);
 
-/**
- * @brief Async queue destroy notification callback function
- */
-static void dispatcher_queue_destroy_notify (gpointer _dispatcher);
-
 /**
  * @brief Handle service crash event
  */
@@ -72,16 +62,26 @@ static void do_friend_process_crash_event (RmgDispatcher *dispatcher, RmgDEvent
  */
 static void do_friend_service_failed_event (RmgDispatcher *dispatcher, RmgDEvent *event);
 
+/**
+ * @brief Handle the verified recovery of a crashed service
+ */
+static void do_process_service_recovered_event (RmgDispatcher *dispatcher, RmgDEvent *event);
+
 /**
  * @brief Start relax timer for event
  */
 static void do_relaxtimer_start (RmgJournal *journal, RmgDEvent *event);
 
+/**
+ * @brief Start relax timer for an action restarting the service unless the restart is tracked
+ */
+static void do_relaxtimer_start_on_restart (RmgDispatcher *dispatcher, RmgDEvent *event);
+
 /**
  * @brief GSourceFuncs vtable
  */
 static GSourceFuncs dispatcher_source_funcs = {
-  dispatcher_source_prepare, NULL, dispatcher_source_dispatch, NULL, NULL, NULL,
+  NULL, NULL, dispatcher_source_dispatch, NULL, NULL, NULL,
 };
 
 static void
@@ -90,32 +90,21 @@ post_dispatcher_event (RmgDispatcher *dispatcher, RmgDEvent *event)
   g_assert (dispatcher);
   g_assert (event);
 
-  g_async_queue_push (dispatcher->queue, event);
-}
-
-static gboolean
-dispatcher_source_prepare (GSource *source, gint *timeout)
-{
-  RmgDispatcher *dispatcher = (RmgDispatcher *)source;
-
-  RMG_UNUSED (timeout);
-
-  return (g_async_queue_length (dispatcher->queue) > 0);
+  rmg_eventqueue_push (dispatcher->queue, event);
 }
 
 static gboolean
 dispatcher_source_dispatch (GSource *source, GSourceFunc callback, gpointer _dispatcher)
 {
   RmgDispatcher *dispatcher = (RmgDispatcher *)source;
-  gpointer event = g_async_queue_try_pop (dispatcher->queue);
 
   RMG_UNUSED (callback);
   RMG_UNUSED (_dispatcher);
 
-  if (event == NULL)
-    return G_SOURCE_CONTINUE;
+  if (!rmg_eventqueue_dispatch (dispatcher->queue, dispatcher->callback, dispatcher))
+    return G_SOURCE_REMOVE;
 
-  return dispatcher->callback (dispatcher, event) == TRUE ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+  return G_SOURCE_CONTINUE;
 }
 
 static gboolean
@@ -150,6 +139,11 @@ dispatcher_source_callback (gpointer _dispatcher, gpointer _event)
       g_info ("Service '%s' restarted", event->service_name);
       break;
 
+    case DEVENT_SERVICE_RECOVERED:
+      g_info ("Service '%s' recovery verified", event->service_name);
+      do_process_service_recovered_event (dispatcher, event);
+      break;
+
     case DEVENT_REMOTE_CONTEXT_RESTART:
       g_info ("Service '%s' from container '%s' request container restart", event->service_name,
               event->context_name);
@@ -191,13 +185,6 @@ dispatcher_source_destroy_notify (gpointer _dispatcher)
   rmg_dispatcher_unref (dispatcher);
 }
 
-static void
-dispatcher_queue_destroy_notify (gpointer _dispatcher)
-{
-  RMG_UNUSED (_dispatcher);
-  g_debug ("Dispatcher queue destroy notification");
-}
-
 static RmgStatus
 run_mode_specific_init (RmgDispatcher *dispatcher, GError **error)
 {
@@ -257,6 +244,118 @@ do_relaxtimer_start (RmgJournal *journal, RmgDEvent *event)
     }
 }
 
+static void
+do_relaxtimer_start_on_restart (RmgDispatcher *dispatcher, RmgDEvent *event)
+{
+  /* a tracked restart starts the relaxation once the unit is verified active */
+  if (rmg_executor_tracks_jobs (dispatcher->executor))
+    return;
+
+  do_relaxtimer_start (dispatcher->journal, event);
+}
+
+static void
+do_process_service_recovered_event (RmgDispatcher *dispatcher, RmgDEvent *event)
+{
+  g_autoptr (GError) error = NULL;
+  glong rvector = 0;
+
+  g_assert (dispatcher);
+  g_assert (event);
+
+  /* an action with reset after already cleared the rvector */
+  rvector = rmg_journal_get_rvector (dispatcher->journal, event->service_name, &error);
+  if (error != NULL)
+    {
+      g_warning ("Fail to read the rvector for service %s. Error %s", event->service_name,
+                 error->message);
+      return;
+    }
+
+  if (rvector > 0)
+    do_relaxtimer_start (dispatcher->journal, event);
+}
+
+static gboolean
+do_escalate_action (RmgJournal *journal, RmgDEvent *event, const gchar *why)
+{
+  g_autoptr (GError) error = NULL;
+  RmgActionType next_action = ACTION_INVALID;
+  glong trigger_level_max = 0;
+  glong rvector = 0;
+
+  g_assert (journal);
+  g_assert (event);
+
+  rvector = rmg_journal_get_rvector (journal, event->service_name, &error);
+  if (error == NULL)
+    {
+      rmg_journal_get_service_action_skip (journal, event->service_name, &trigger_level_max,
+                                           &error);
+    }
+
+  /* the next action starts right after the last level of the current action */
+  if (error == NULL && trigger_level_max >= rvector)
+    rmg_journal_set_rvector (journal, event->service_name, trigger_level_max + 1, &error);
+
+  if (error == NULL && trigger_level_max >= rvector)
+    next_action = rmg_journal_get_service_action (journal, event->service_name, &error);
+
+  if (error != NULL)
+    {
+      g_warning ("Fail to escalate the action for service %s. Error %s", event->service_name,
+                 error->message);
+      return FALSE;
+    }
+
+  /* the last action of the unit cannot be escalated */
+  if (next_action == ACTION_INVALID)
+    {
+      if (trigger_level_max >= rvector)
+        rmg_journal_set_rvector (journal, event->service_name, rvector, &error);
+
+      return FALSE;
+    }
+
+  g_info ("Escalate action for service='%s' on '%s' to '%s' rvector=%ld", event->service_name, why,
+          rmg_utils_action_name (next_action), trigger_level_max + 1);
+
+  return TRUE;
+}
+
+static void
+do_skip_ineffective_actions (RmgJournal *journal, RmgDEvent *event)
+{
+  g_assert (journal);
+  g_assert (event);
+
+  if (event->failure_reason == FAILURE_UNKNOWN)
+    return;
+
+  while (TRUE)
+    {
+      g_autoptr (GError) error = NULL;
+      glong trigger_level_max = 0;
+      guint skip_mask = 0;
+
+      skip_mask = rmg_journal_get_service_action_skip (journal, event->service_name,
+                                                       &trigger_level_max, &error);
+      if (error != NULL)
+        {
+          g_warning ("Fail to read action skip for service %s. Error %s", event->service_name,
+                     error->message);
+          return;
+        }
+
+      if ((skip_mask & RMG_FAILURE_MASK (event->failure_reason)) == 0)
+        return;
+
+      /* the last action of the unit cannot be skipped */
+      if (!do_escalate_action (journal, event, rmg_utils_failure_name (event->failure_reason)))
+        return;
+    }
+}
+
 static void
 do_process_service_crash_event (RmgDispatcher *dispatcher, RmgDEvent *event)
 {
@@ -295,7 +394,10 @@ do_process_service_crash_event (RmgDispatcher *dispatcher, RmgDEvent *event)
       return;
     }
 
-  rmg_journal_set_rvector (dispatcher->journal, event->service_name, (rvector + 1), &error);
+  /* coalesced failures escalate the rvector in one step */
+  rvector += MAX (event->weight, 1);
+
+  rmg_journal_set_rvector (dispatcher->journal, event->service_name, rvector, &error);
   if (error != NULL)
     {
       g_warning ("Fail to increment the rvector for service %s. Error %s", event->service_name,
@@ -303,7 +405,27 @@ do_process_service_crash_event (RmgDispatcher *dispatcher, RmgDEvent *event)
       return;
     }
 
-  rvector += 1;
+  if (event->failure_reason != FAILURE_UNKNOWN)
+    {
+      g_info ("Service '%s' failed on '%s' exit code %d status %d", event->service_name,
+              rmg_utils_failure_name (event->failure_reason), event->exit_code,
+              event->exit_status);
+    }
+
+  /* a flapping service or a failed restart skips the remaining retries of the action */
+  if (event->escalate != NULL)
+    do_escalate_action (dispatcher->journal, event, event->escalate);
+
+  /* actions marked as ineffective for this failure reason are skipped */
+  do_skip_ineffective_actions (dispatcher->journal, event);
+
+  rvector = rmg_journal_get_rvector (dispatcher->journal, event->service_name, &error);
+  if (error != NULL)
+    {
+      g_warning ("Fail to read the rvector for service %s. Error %s", event->service_name,
+                 error->message);
+      return;
+    }
 
   /* read next applicable action and execute */
   action_type = rmg_journal_get_service_action (dispatcher->journal, event->service_name, &error);
@@ -329,6 +451,9 @@ do_process_service_crash_event (RmgDispatcher *dispatcher, RmgDEvent *event)
               rmg_utils_action_name (action_type), event->service_name, rvector);
     }
 
+  /* the executor orders the actions by context so it is set before any action is pushed */
+  rmg_devent_set_context_name (event, g_get_host_name ());
+
   switch (action_type)
     {
     case ACTION_SERVICE_IGNORE:
@@ -353,7 +478,7 @@ do_process_service_crash_event (RmgDispatcher *dispatcher, RmgDEvent *event)
             }
         }
       else
-        do_relaxtimer_start (dispatcher->journal, event);
+        do_relaxtimer_start_on_restart (dispatcher, event);
       break;
 
     case ACTION_PUBLIC_DATA_RESET:
@@ -369,7 +494,7 @@ do_process_service_crash_event (RmgDispatcher *dispatcher, RmgDEvent *event)
             }
         }
       else
-        do_relaxtimer_start (dispatcher->journal, event);
+        do_relaxtimer_start_on_restart (dispatcher, event);
       break;
 
     case ACTION_PRIVATE_DATA_RESET:
@@ -385,7 +510,7 @@ do_process_service_crash_event (RmgDispatcher *dispatcher, RmgDEvent *event)
             }
         }
       else
-        do_relaxtimer_start (dispatcher->journal, event);
+        do_relaxtimer_start_on_restart (dispatcher, event);
       break;
 
     case ACTION_SERVICE_DISABLE:
@@ -442,8 +567,7 @@ do_process_service_crash_event (RmgDispatcher *dispatcher, RmgDEvent *event)
       break;
     }
 
-  /* We set our current context and inform about this service crash */
-  event->context_name = g_strdup (g_get_host_name ());
+  /* inform about this service crash in our current context */
   do_friend_service_failed_event (dispatcher, event);
 }
 
@@ -499,7 +623,7 @@ foreach_client_notify_service_failed (gpointer _client, gpointer _event)
   g_assert (event);
 
   /* We inform the replica instances only if is not the event originator */
-  if (g_strcmp0 (client->context_name, event->context_name) != 0)
+  if (client->context_name != event->context_name)
     {
       g_autoptr (RmgMessage) msg = rmg_message_new (RMG_MESSAGE_INFORM_CLIENT_SERVICE_FAILED, 0);
 
@@ -560,7 +684,16 @@ rmg_dispatcher_new (RmgOptions *options, RmgJournal *journal, RmgExecutor *execu
   dispatcher->options = rmg_options_ref (options);
   dispatcher->journal = rmg_journal_ref (journal);
   dispatcher->executor = rmg_executor_ref (executor);
-  dispatcher->queue = g_async_queue_new_full (dispatcher_queue_destroy_notify);
+  dispatcher->queue = rmg_eventqueue_new_for_options ("dispatcher", options,
+                                                      (GDestroyNotify)rmg_devent_unref);
+  g_source_add_unix_fd (RMG_EVENT_SOURCE (dispatcher), rmg_eventqueue_get_fd (dispatcher->queue),
+                        G_IO_IN);
+  dispatcher->crash_debounce_ms = rmg_options_long_for (options, KEY_CRASH_DEBOUNCE_MS);
+  dispatcher->flap_window_sec = rmg_options_long_for (options, KEY_FLAP_WINDOW_SEC);
+  dispatcher->flap_threshold = rmg_options_long_for (options, KEY_FLAP_THRESHOLD);
+  dispatcher->crashfilter = rmg_crashfilter_new (
+      rmg_options_long_for (options, KEY_CRASH_DEDUP_WINDOW_MS),
+      (guint)CLAMP (rmg_options_long_for (options, KEY_CRASH_DEDUP_CAPACITY), 1, G_MAXUINT16));
 
   if (run_mode_specific_init (dispatcher, error) == RMG_STATUS_OK)
     {
@@ -610,7 +743,9 @@ rmg_dispatcher_unref (RmgDispatcher *dispatcher)
       if (dispatcher->manager != NULL)
         rmg_manager_unref (dispatcher->manager);
 
-      g_async_queue_unref (dispatcher->queue);
+      rmg_crashfilter_unref (dispatcher->crashfilter);
+
+      rmg_eventqueue_unref (dispatcher->queue);
       g_source_unref (RMG_EVENT_SOURCE (dispatcher));
     }
 }
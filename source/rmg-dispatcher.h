@@ -23,7 +23,9 @@
 
 #pragma once
 
+#include "rmg-crashfilter.h"
 #include "rmg-devent.h"
+#include "rmg-eventqueue.h"
 #include "rmg-executor.h"
 #include "rmg-journal.h"
 #include "rmg-manager.h"
@@ -48,13 +50,17 @@ typedef gboolean (*RmgDispatcherCallback) (gpointer _dispatcher, gpointer _event
 typedef struct _RmgDispatcher
 {
   GSource source;                 /**< Event loop source */
-  GAsyncQueue *queue;             /**< Async queue */
+  RmgEventQueue *queue;           /**< Event queue */
   RmgDispatcherCallback callback; /**< Dispatcher callback function */
   RmgOptions *options;
   RmgJournal *journal;
   RmgExecutor *executor;
   RmgServer *server;
   RmgManager *manager;
+  glong crash_debounce_ms;     /**< Window coalescing repeated failures of a service */
+  glong flap_window_sec;       /**< Window used to count failures for flap detection */
+  glong flap_threshold;        /**< Failures in flap window marking a service as flapping */
+  RmgCrashFilter *crashfilter; /**< Deduplication of process crash notifications */
   grefcount rc;
 } RmgDispatcher;
 
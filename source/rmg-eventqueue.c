@@ -0,0 +1,280 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-eventqueue.c
+ */
+
+#include "rmg-eventqueue.h"
+
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static void
+queue_wake (RmgEventQueue *queue)
+{
+  guint64 value = 1;
+
+  if (write (queue->event_fd, &value, sizeof (value)) < 0 && errno != EAGAIN)
+    g_warning ("Fail to wake event queue %s. Error %s", queue->name, g_strerror (errno));
+}
+
+static void
+queue_clear_wake (RmgEventQueue *queue)
+{
+  guint64 value = 0;
+
+  if (read (queue->event_fd, &value, sizeof (value)) < 0 && errno != EAGAIN)
+    g_warning ("Fail to clear event queue %s. Error %s", queue->name, g_strerror (errno));
+}
+
+static void
+queue_grow (RmgEventQueue *queue)
+{
+  guint capacity = queue->capacity * 2;
+  RmgEventQueueSlot *slots = g_new (RmgEventQueueSlot, capacity);
+
+  /* the ring is unwrapped so the oldest event moves to the first slot */
+  for (guint i = 0; i < queue->depth; i++)
+    slots[i] = queue->slots[(queue->head + i) % queue->capacity];
+
+  g_free (queue->slots);
+
+  queue->slots = slots;
+  queue->head = 0;
+  queue->capacity = capacity;
+
+  g_warning ("Event queue %s full, capacity raised to %u events", queue->name, capacity);
+}
+
+RmgEventQueue *
+rmg_eventqueue_new (const gchar *name, guint capacity, guint batch,
+                    RmgEventQueueOverflow overflow, GDestroyNotify event_free)
+{
+  RmgEventQueue *queue = g_new0 (RmgEventQueue, 1);
+
+  g_assert (name);
+
+  g_ref_count_init (&queue->rc);
+  g_mutex_init (&queue->lock);
+
+  queue->name = g_intern_string (name);
+  queue->capacity = MAX (capacity, 1);
+  queue->batch = MAX (batch, 1);
+  queue->overflow = overflow;
+  queue->event_free = event_free;
+  queue->slots = g_new0 (RmgEventQueueSlot, queue->capacity);
+  queue->batch_events = g_new0 (gpointer, queue->batch);
+
+  /* without the eventfd the owner source is never dispatched */
+  queue->event_fd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (queue->event_fd < 0)
+    g_error ("Fail to create event queue %s. Error %s", name, g_strerror (errno));
+
+  return queue;
+}
+
+RmgEventQueue *
+rmg_eventqueue_new_for_options (const gchar *name, RmgOptions *options, GDestroyNotify event_free)
+{
+  g_autofree gchar *overflow = NULL;
+  glong capacity;
+  glong batch;
+
+  g_assert (options);
+
+  capacity = rmg_options_long_for (options, KEY_EVENT_QUEUE_CAPACITY);
+  batch = rmg_options_long_for (options, KEY_EVENT_QUEUE_BATCH);
+  overflow = rmg_options_string_for (options, KEY_EVENT_QUEUE_OVERFLOW);
+
+  return rmg_eventqueue_new (name, (guint)CLAMP (capacity, 1, G_MAXINT / 2),
+                             (guint)CLAMP (batch, 1, G_MAXINT),
+                             rmg_eventqueue_overflow_from (overflow), event_free);
+}
+
+RmgEventQueue *
+rmg_eventqueue_ref (RmgEventQueue *queue)
+{
+  g_assert (queue);
+  g_ref_count_inc (&queue->rc);
+  return queue;
+}
+
+void
+rmg_eventqueue_unref (RmgEventQueue *queue)
+{
+  g_assert (queue);
+
+  if (g_ref_count_dec (&queue->rc) == TRUE)
+    {
+      g_debug ("Event queue %s pushed %lu dispatched %lu dropped %lu max depth %u "
+               "latency avg %ldus max %ldus",
+               queue->name, (gulong)queue->pushed, (gulong)queue->dispatched,
+               (gulong)queue->dropped, queue->max_depth,
+               (glong)(queue->dispatched > 0 ? queue->total_latency / (gint64)queue->dispatched
+                                             : 0),
+               (glong)queue->max_latency);
+
+      for (guint i = 0; i < queue->depth; i++)
+        {
+          gpointer event = queue->slots[(queue->head + i) % queue->capacity].event;
+
+          if (queue->event_free != NULL)
+            queue->event_free (event);
+        }
+
+      close (queue->event_fd);
+      g_mutex_clear (&queue->lock);
+
+      g_free (queue->batch_events);
+      g_free (queue->slots);
+      g_free (queue);
+    }
+}
+
+gint
+rmg_eventqueue_get_fd (RmgEventQueue *queue)
+{
+  g_assert (queue);
+  return queue->event_fd;
+}
+
+gboolean
+rmg_eventqueue_push (RmgEventQueue *queue, gpointer event)
+{
+  gpointer dropped = NULL;
+  gboolean accepted = TRUE;
+  guint64 dropped_total;
+
+  g_assert (queue);
+  g_assert (event);
+
+  g_mutex_lock (&queue->lock);
+
+  if (queue->depth == queue->capacity)
+    {
+      switch (queue->overflow)
+        {
+        case EVENTQUEUE_OVERFLOW_DROP_NEWEST:
+          dropped = event;
+          accepted = FALSE;
+          break;
+
+        case EVENTQUEUE_OVERFLOW_DROP_OLDEST:
+          dropped = queue->slots[queue->head].event;
+          queue->head = (queue->head + 1) % queue->capacity;
+          queue->depth--;
+          break;
+
+        default:
+          queue_grow (queue);
+          break;
+        }
+
+      if (dropped != NULL)
+        queue->dropped++;
+    }
+
+  if (accepted)
+    {
+      RmgEventQueueSlot *slot = &queue->slots[(queue->head + queue->depth) % queue->capacity];
+
+      slot->event = event;
+      slot->push_time = g_get_monotonic_time ();
+
+      /* the eventfd is signalled on the transition from empty only */
+      if (queue->depth++ == 0)
+        queue_wake (queue);
+
+      queue->pushed++;
+      queue->max_depth = MAX (queue->max_depth, queue->depth);
+    }
+
+  dropped_total = queue->dropped;
+
+  g_mutex_unlock (&queue->lock);
+
+  if (dropped != NULL)
+    {
+      /* logged on powers of two to bound the log rate under a storm */
+      if ((dropped_total & (dropped_total - 1)) == 0)
+        g_warning ("Event queue %s full, %lu events dropped", queue->name, (gulong)dropped_total);
+
+      if (queue->event_free != NULL)
+        queue->event_free (dropped);
+    }
+
+  return accepted;
+}
+
+gboolean
+rmg_eventqueue_dispatch (RmgEventQueue *queue, RmgEventQueueCallback callback, gpointer owner)
+{
+  gint64 now = g_get_monotonic_time ();
+  gboolean keep = TRUE;
+  guint count = 0;
+
+  g_assert (queue);
+  g_assert (callback);
+
+  g_mutex_lock (&queue->lock);
+
+  while (count < queue->batch && queue->depth > 0)
+    {
+      RmgEventQueueSlot *slot = &queue->slots[queue->head];
+      gint64 latency = now - slot->push_time;
+
+      queue->batch_events[count++] = slot->event;
+      queue->head = (queue->head + 1) % queue->capacity;
+      queue->depth--;
+
+      queue->total_latency += latency;
+      queue->max_latency = MAX (queue->max_latency, latency);
+    }
+
+  /* the eventfd stays readable while events are left for the next dispatch */
+  if (queue->depth == 0)
+    queue_clear_wake (queue);
+
+  queue->dispatched += count;
+
+  g_mutex_unlock (&queue->lock);
+
+  for (guint i = 0; i < count; i++)
+    {
+      if (keep)
+        keep = callback (owner, queue->batch_events[i]);
+      else if (queue->event_free != NULL)
+        queue->event_free (queue->batch_events[i]);
+    }
+
+  return keep;
+}
+
+RmgEventQueueOverflow
+rmg_eventqueue_overflow_from (const gchar *name)
+{
+  if (g_strcmp0 (name, "drop-newest") == 0)
+    return EVENTQUEUE_OVERFLOW_DROP_NEWEST;
+  else if (g_strcmp0 (name, "drop-oldest") == 0)
+    return EVENTQUEUE_OVERFLOW_DROP_OLDEST;
+
+  return EVENTQUEUE_OVERFLOW_GROW;
+}
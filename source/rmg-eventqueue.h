@@ -0,0 +1,160 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-eventqueue.h
+ */
+
+#pragma once
+
+#include "rmg-options.h"
+#include "rmg-types.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @brief Capacity and batch of the queues carrying a few control events
+ */
+#define RMG_EVENTQUEUE_CONTROL_SIZE (8)
+
+/**
+ * @enum RmgEventQueueOverflow
+ * @brief What happens to an event pushed on a full queue
+ */
+typedef enum _RmgEventQueueOverflow
+{
+  EVENTQUEUE_OVERFLOW_GROW,        /**< Double the capacity, no event is lost */
+  EVENTQUEUE_OVERFLOW_DROP_NEWEST, /**< Drop the pushed event */
+  EVENTQUEUE_OVERFLOW_DROP_OLDEST  /**< Drop the oldest queued event */
+} RmgEventQueueOverflow;
+
+/**
+ * @function RmgEventQueueCallback
+ * @brief Event handler, returning FALSE stops the dispatch and removes the owner source
+ */
+typedef gboolean (*RmgEventQueueCallback) (gpointer _owner, gpointer _event);
+
+/**
+ * @struct RmgEventQueueSlot
+ * @brief A queued event with its push time
+ */
+typedef struct _RmgEventQueueSlot
+{
+  gpointer event;   /**< The queued event */
+  gint64 push_time; /**< Monotonic time the event was pushed */
+} RmgEventQueueSlot;
+
+/**
+ * @struct RmgEventQueue
+ * @brief Bounded event queue waking the main loop through an eventfd
+ */
+typedef struct _RmgEventQueue
+{
+  GMutex lock;                    /**< Protects the ring and the counters */
+  gint event_fd;                  /**< Readable while events are queued */
+  const gchar *name;              /**< Interned queue name used in logs */
+  RmgEventQueueSlot *slots;       /**< Event ring */
+  guint capacity;                 /**< Ring size */
+  guint head;                     /**< Ring index of the oldest event */
+  guint depth;                    /**< Events queued */
+  guint batch;                    /**< Maximum events handled per dispatch */
+  gpointer *batch_events;         /**< Events popped by the dispatch in progress */
+  RmgEventQueueOverflow overflow; /**< Full queue policy */
+  GDestroyNotify event_free;      /**< Releases events dropped or left on the queue */
+  guint64 pushed;                 /**< Events pushed */
+  guint64 dispatched;             /**< Events handled */
+  guint64 dropped;                /**< Events dropped on overflow */
+  guint max_depth;                /**< Highest depth seen */
+  gint64 total_latency;           /**< Sum of push to dispatch times in microseconds */
+  gint64 max_latency;             /**< Highest push to dispatch time in microseconds */
+  grefcount rc;                   /**< Reference counter variable  */
+} RmgEventQueue;
+
+/*
+ * @brief Create a new event queue object
+ * @param name The queue name used in logs
+ * @param capacity The number of events queued before the overflow policy applies
+ * @param batch The maximum number of events handled per dispatch
+ * @param overflow The full queue policy
+ * @param event_free Function releasing events not handled or NULL
+ * @return A new RmgEventQueue object
+ */
+RmgEventQueue *rmg_eventqueue_new (const gchar *name, guint capacity, guint batch,
+                                   RmgEventQueueOverflow overflow, GDestroyNotify event_free);
+
+/*
+ * @brief Create a new event queue object sized by the EventQueue options
+ * @param name The queue name used in logs
+ * @param options The options object
+ * @param event_free Function releasing events not handled or NULL
+ * @return A new RmgEventQueue object
+ */
+RmgEventQueue *rmg_eventqueue_new_for_options (const gchar *name, RmgOptions *options,
+                                               GDestroyNotify event_free);
+
+/**
+ * @brief Aquire event queue object
+ * @param queue Pointer to the event queue object
+ */
+RmgEventQueue *rmg_eventqueue_ref (RmgEventQueue *queue);
+
+/**
+ * @brief Release event queue object
+ * @param queue Pointer to the event queue object
+ */
+void rmg_eventqueue_unref (RmgEventQueue *queue);
+
+/**
+ * @brief Get the file descriptor to add to the owner source with G_IO_IN
+ * @param queue Pointer to the event queue object
+ * @return The eventfd
+ */
+gint rmg_eventqueue_get_fd (RmgEventQueue *queue);
+
+/**
+ * @brief Push an event, safe to call from any thread
+ * @param queue Pointer to the event queue object
+ * @param event The event, owned by the queue
+ * @return FALSE if the event was dropped on overflow
+ */
+gboolean rmg_eventqueue_push (RmgEventQueue *queue, gpointer event);
+
+/**
+ * @brief Handle up to a batch of events from the owner source dispatch
+ * The eventfd stays readable while events are left so other sources run in between
+ * @param queue Pointer to the event queue object
+ * @param callback The event handler
+ * @param owner The first handler argument
+ * @return FALSE if the handler returned FALSE
+ */
+gboolean rmg_eventqueue_dispatch (RmgEventQueue *queue, RmgEventQueueCallback callback,
+                                  gpointer owner);
+
+/**
+ * @brief Get overflow policy from string name
+ * @param name The policy name grow, drop-newest or drop-oldest
+ * @return The overflow policy, grow for unknown names
+ */
+RmgEventQueueOverflow rmg_eventqueue_overflow_from (const gchar *name);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgEventQueue, rmg_eventqueue_unref);
+
+G_END_DECLS
@@ -23,12 +23,26 @@
 
 #include "rmg-executor.h"
 #include "rmg-friendtimer.h"
+#include "rmg-pool.h"
 #include "rmg-utils.h"
 
 #ifdef WITH_LXC
 #include <lxc/lxccontainer.h>
 #endif
 
+extern const gchar *sd_dbus_name;
+extern const gchar *sd_dbus_object_path;
+extern const gchar *sd_dbus_interface_manager;
+
+/* Preserve the size and order from ExecutorEventType */
+static const gchar *executor_event_name[]
+    = { "friendProcessCrash", "friendServiceFailed", "resetService",    "resetPublicData",
+        "resetPrivateData",   "disableService",      "contextRestart",  "platformRestart",
+        "factoryReset" };
+
+/* executor events are preallocated for the process lifetime */
+static RmgPool *executor_event_pool = NULL;
+
 /**
  * @brief Post new event
  *
@@ -39,11 +53,6 @@
 static void post_executor_event (RmgExecutor *executor, ExecutorEventType type,
                                  RmgDEvent *dispatcher_event);
 
-/**
- * @brief GSource prepare function
- */
-static gboolean executor_source_prepare (GSource *source, gint *timeout);
-
 /**
  * @brief GSource dispatch function
  */
@@ -61,9 +70,95 @@ static gboolean executor_source_callback (gpointer _executor, gpointer _event);
 static void executor_source_destroy_notify (gpointer _executor);
 
 /**
- * @brief Async queue destroy notification callback function
+ * @brief Release an event left on the queue
  */
-static void executor_queue_destroy_notify (gpointer _executor);
+static void executor_event_free (gpointer _event);
+
+/**
+ * @brief Run the pending events whose lane is free while workers are available
+ */
+static void executor_schedule (RmgExecutor *executor);
+
+/**
+ * @brief Hold the event being run until an asynchronous operation completes
+ * @return The held event or NULL if no event is being run
+ */
+static RmgExecutorEvent *executor_event_hold (RmgExecutor *executor);
+
+/**
+ * @brief Release a held event, the lane is freed once the last hold is released
+ */
+static void executor_event_release (RmgExecutor *executor, RmgExecutorEvent *event);
+
+/**
+ * @function ExecutorActionDone
+ * @brief Action chained on the completion of a command or data reset
+ */
+typedef void (*ExecutorActionDone) (RmgExecutor *executor, RmgDEvent *dispatcher_event);
+
+/**
+ * @struct ExecutorAction
+ * @brief The action waiting for a command or data reset to complete
+ */
+typedef struct _ExecutorAction
+{
+  RmgExecutor *executor;       /**< The executor running the action */
+  RmgDEvent *dispatcher_event; /**< Event object from dispatcher */
+  RmgExecutorEvent *event;     /**< Held executor event, NULL outside the scheduler */
+  ExecutorActionDone done;     /**< Action chained on completion, can be NULL */
+} ExecutorAction;
+
+/**
+ * @struct ExecutorJob
+ * @brief A unit job queued by the service manager on executor request
+ */
+typedef struct _ExecutorJob
+{
+  RmgExecutor *executor;       /**< Executor reference held while the call is pending */
+  const gchar *method;         /**< The manager method which queued the job */
+  gchar *service_name;         /**< The unit name atom */
+  RmgDEvent *dispatcher_event; /**< Event the job recovers from, NULL for friend actions */
+  RmgExecutorEvent *event;     /**< Executor event held until the call reply */
+  gint64 start_time;           /**< Monotonic time of the call */
+} ExecutorJob;
+
+/**
+ * @struct ExecutorRestartStats
+ * @brief Restart to active latency of a service in milliseconds
+ */
+typedef struct _ExecutorRestartStats
+{
+  guint restarts;       /**< Restart jobs completed */
+  gint64 last_latency;  /**< Latency of the last restart */
+  gint64 max_latency;   /**< Highest latency */
+  gint64 total_latency; /**< Sum of the latencies */
+} ExecutorRestartStats;
+
+/**
+ * @brief Run a command without blocking the main loop
+ */
+static void executor_run_command (RmgExecutor *executor, RmgDEvent *dispatcher_event,
+                                  const gchar *name, RmgCommandTemplate *tmpl,
+                                  const gchar *path,
+                                  ExecutorActionDone done);
+
+/**
+ * @brief Clear a data directory in-process without blocking the main loop
+ */
+static void executor_run_data_reset (RmgExecutor *executor, RmgDEvent *dispatcher_event,
+                                     const gchar *name, const gchar *path,
+                                     ExecutorActionDone done);
+
+/**
+ * @brief Swap a data directory with an empty one and restart without waiting for the removal
+ */
+static void executor_swap_data (RmgExecutor *executor, RmgDEvent *dispatcher_event,
+                                const gchar *name, const gchar *path, ExecutorActionDone done);
+
+/**
+ * @brief Reap the trash left by data resets of a previous run
+ */
+static void executor_resume_reaper (RmgExecutor *executor);
 
 /**
  * @brief Process service restart event
@@ -118,7 +213,8 @@ static void do_process_platform_restart_event (RmgExecutor *executor, RmgDEvent
  * @brief Process service platform restart event for primary instance
  */
 static void do_process_platform_restart_event_primary (RmgExecutor *executor,
-                                                       RmgDEvent *dispatcher_event);
+                                                       RmgDEvent *dispatcher_event,
+                                                       ExecutorActionDone done);
 
 /**
  * @brief Process service platform restart event for replica instance
@@ -135,7 +231,8 @@ static void do_process_factory_reset_event (RmgExecutor *executor, RmgDEvent *di
  * @brief Process service factory reset event for primary instance
  */
 static void do_process_factory_reset_event_primary (RmgExecutor *executor,
-                                                    RmgDEvent *dispatcher_event);
+                                                    RmgDEvent *dispatcher_event,
+                                                    ExecutorActionDone done);
 
 /**
  * @brief Process service factory reset event for replica instance
@@ -152,7 +249,7 @@ static void enter_meditation (RmgExecutor *executor, RmgDEvent *dispatcher_event
  * @brief GSourceFuncs vtable
  */
 static GSourceFuncs executor_source_funcs = {
-  executor_source_prepare, NULL, executor_source_dispatch, NULL, NULL, NULL,
+  NULL, NULL, executor_source_dispatch, NULL, NULL, NULL,
 };
 
 static void
@@ -163,48 +260,137 @@ post_executor_event (RmgExecutor *executor, ExecutorEventType type, RmgDEvent *d
   g_assert (executor);
   g_assert (dispatcher_event);
 
-  e = g_new0 (RmgExecutorEvent, 1);
+  e = (RmgExecutorEvent *)rmg_pool_alloc0 (executor_event_pool);
 
   e->type = type;
   e->dispatcher_event = rmg_devent_ref (dispatcher_event);
 
-  g_async_queue_push (executor->queue, e);
+  rmg_eventqueue_push (executor->queue, e);
 }
 
 static gboolean
-executor_source_prepare (GSource *source, gint *timeout)
+executor_source_dispatch (GSource *source, GSourceFunc callback, gpointer _executor)
 {
   RmgExecutor *executor = (RmgExecutor *)source;
 
-  RMG_UNUSED (timeout);
+  RMG_UNUSED (callback);
+  RMG_UNUSED (_executor);
+
+  if (!rmg_eventqueue_dispatch (executor->queue, executor->callback, executor))
+    return G_SOURCE_REMOVE;
 
-  return (g_async_queue_length (executor->queue) > 0);
+  return G_SOURCE_CONTINUE;
 }
 
 static gboolean
-executor_source_dispatch (GSource *source, GSourceFunc callback, gpointer _executor)
+executor_event_is_barrier (RmgExecutorEvent *event)
 {
-  RmgExecutor *executor = (RmgExecutor *)source;
-  gpointer event = g_async_queue_try_pop (executor->queue);
+  return event->priority == EXECUTOR_PRIORITY_GLOBAL;
+}
 
-  RMG_UNUSED (callback);
-  RMG_UNUSED (_executor);
+static RmgActionType
+executor_event_severity (RmgExecutorEvent *event)
+{
+  switch (event->type)
+    {
+    case EXECUTOR_EVENT_SERVICE_RESTART:
+      return ACTION_SERVICE_RESET;
+
+    case EXECUTOR_EVENT_SERVICE_RESET_PUBLIC_DATA:
+      return ACTION_PUBLIC_DATA_RESET;
 
-  if (event == NULL)
-    return G_SOURCE_CONTINUE;
+    case EXECUTOR_EVENT_SERVICE_RESET_PRIVATE_DATA:
+      return ACTION_PRIVATE_DATA_RESET;
+
+    case EXECUTOR_EVENT_SERVICE_DISABLE:
+      return ACTION_SERVICE_DISABLE;
 
-  return executor->callback (executor, event) == TRUE ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+    case EXECUTOR_EVENT_CONTEXT_RESTART:
+      /* a context restart outside a container restarts the platform */
+      if (event->dispatcher_event->context_name == NULL)
+        return ACTION_PLATFORM_RESTART;
+      return ACTION_CONTEXT_RESET;
+
+    case EXECUTOR_EVENT_PLATFORM_RESTART:
+      return ACTION_PLATFORM_RESTART;
+
+    case EXECUTOR_EVENT_FACTORY_RESET:
+      return ACTION_FACTORY_RESET;
+
+    default:
+      break;
+    }
+
+  /* friend notifications are the least severe */
+  return ACTION_SERVICE_IGNORE;
 }
 
-static gboolean
-executor_source_callback (gpointer _executor, gpointer _event)
+static void
+executor_supersede (RmgExecutor *executor, RmgExecutorEvent *dropped, RmgExecutorEvent *by)
 {
-  RmgExecutor *executor = (RmgExecutor *)_executor;
-  RmgExecutorEvent *event = (RmgExecutorEvent *)_event;
+  executor->superseded++;
 
-  g_assert (executor);
-  g_assert (event);
+  g_info ("Drop %s for service='%s' superseded by pending %s for service='%s' (%u dropped)",
+          executor_event_name[dropped->type], dropped->dispatcher_event->service_name,
+          executor_event_name[by->type], by->dispatcher_event->service_name,
+          executor->superseded);
+
+  executor_event_free (dropped);
+}
+
+static void
+executor_enqueue (RmgExecutor *executor, RmgExecutorEvent *event)
+{
+  GList *link = NULL;
+
+  /* a pending global action makes work of lower or equal severity moot */
+  for (link = executor->pending->head; link != NULL; link = link->next)
+    {
+      RmgExecutorEvent *queued = (RmgExecutorEvent *)link->data;
 
+      if (queued->priority == EXECUTOR_PRIORITY_GLOBAL && queued->severity >= event->severity)
+        {
+          executor_supersede (executor, event, queued);
+          return;
+        }
+    }
+
+  /* a global action cancels the queued work it supersedes, running actions complete */
+  if (event->priority == EXECUTOR_PRIORITY_GLOBAL)
+    {
+      link = executor->pending->head;
+
+      while (link != NULL)
+        {
+          RmgExecutorEvent *queued = (RmgExecutorEvent *)link->data;
+          GList *next = link->next;
+
+          if (queued->severity < event->severity)
+            {
+              g_queue_delete_link (executor->pending, link);
+              executor_supersede (executor, queued, event);
+            }
+
+          link = next;
+        }
+    }
+
+  /* events are placed after the events of higher or equal priority */
+  for (link = executor->pending->tail; link != NULL; link = link->prev)
+    {
+      if (((RmgExecutorEvent *)link->data)->priority >= event->priority)
+        break;
+    }
+
+  if (link == NULL)
+    g_queue_push_head (executor->pending, event);
+  else
+    g_queue_insert_after (executor->pending, link, event);
+}
+
+static void
+executor_process_event (RmgExecutor *executor, RmgExecutorEvent *event)
+{
   switch (event->type)
     {
     case EXECUTOR_EVENT_FRIEND_PROCESS_CRASH:
@@ -246,9 +432,144 @@ executor_source_callback (gpointer _executor, gpointer _event)
     default:
       break;
     }
+}
 
-  rmg_devent_unref (event->dispatcher_event);
-  g_free (event);
+static void
+executor_run_event (RmgExecutor *executor, RmgExecutorEvent *event)
+{
+  event->holds = 1;
+  executor->running++;
+
+  if (executor_event_is_barrier (event))
+    executor->barrier = TRUE;
+
+  g_hash_table_add (executor->busy_lanes, event->lane);
+
+  /* asynchronous operations started by the action hold the event */
+  executor->current = event;
+  executor_process_event (executor, event);
+  executor->current = NULL;
+
+  executor_event_release (executor, event);
+}
+
+static RmgExecutorEvent *
+executor_event_hold (RmgExecutor *executor)
+{
+  if (executor->current == NULL)
+    return NULL;
+
+  executor->current->holds++;
+
+  return executor->current;
+}
+
+static void
+executor_event_release (RmgExecutor *executor, RmgExecutorEvent *event)
+{
+  if (event == NULL || --event->holds > 0)
+    return;
+
+  if (executor_event_is_barrier (event))
+    executor->barrier = FALSE;
+
+  g_hash_table_remove (executor->busy_lanes, event->lane);
+  executor->running--;
+  executor_event_free (event);
+
+  executor_schedule (executor);
+}
+
+static void
+executor_schedule_pass (RmgExecutor *executor)
+{
+  g_autoptr (GHashTable) blocked = g_hash_table_new (g_direct_hash, g_direct_equal);
+  GList *link = executor->pending->head;
+
+  while (link != NULL && executor->running < executor->workers && !executor->barrier)
+    {
+      RmgExecutorEvent *event = (RmgExecutorEvent *)link->data;
+      GList *next = link->next;
+
+      if (executor_event_is_barrier (event))
+        {
+          /* a global action waits for the running events and holds back the later ones */
+          if (executor->running == 0 && link == executor->pending->head)
+            {
+              g_queue_delete_link (executor->pending, link);
+              executor_run_event (executor, event);
+            }
+
+          break;
+        }
+
+      /* events of a lane run one at a time in the order they were pushed */
+      if (g_hash_table_contains (executor->busy_lanes, event->lane)
+          || g_hash_table_contains (blocked, event->lane))
+        {
+          g_hash_table_add (blocked, event->lane);
+        }
+      else
+        {
+          g_queue_delete_link (executor->pending, link);
+          executor_run_event (executor, event);
+        }
+
+      link = next;
+    }
+}
+
+static void
+executor_schedule (RmgExecutor *executor)
+{
+  /* events completing while a pass runs them trigger another pass */
+  if (executor->scheduling)
+    {
+      executor->reschedule = TRUE;
+      return;
+    }
+
+  executor->scheduling = TRUE;
+
+  do
+    {
+      executor->reschedule = FALSE;
+      executor_schedule_pass (executor);
+    }
+  while (executor->reschedule);
+
+  executor->scheduling = FALSE;
+}
+
+static gboolean
+executor_source_callback (gpointer _executor, gpointer _event)
+{
+  RmgExecutor *executor = (RmgExecutor *)_executor;
+  RmgExecutorEvent *event = (RmgExecutorEvent *)_event;
+  RmgDEvent *dispatcher_event = NULL;
+
+  g_assert (executor);
+  g_assert (event);
+
+  dispatcher_event = event->dispatcher_event;
+
+  /* container actions are ordered per container, other actions per service */
+  if (event->type == EXECUTOR_EVENT_CONTEXT_RESTART && dispatcher_event->context_name != NULL)
+    event->lane = dispatcher_event->context_name;
+  else
+    event->lane = dispatcher_event->service_name;
+
+  event->severity = executor_event_severity (event);
+
+  if (event->severity >= ACTION_PLATFORM_RESTART)
+    event->priority = EXECUTOR_PRIORITY_GLOBAL;
+  else if (event->severity == ACTION_CONTEXT_RESET)
+    event->priority = EXECUTOR_PRIORITY_CONTEXT;
+  else
+    event->priority = EXECUTOR_PRIORITY_SERVICE;
+
+  executor_enqueue (executor, event);
+  executor_schedule (executor);
 
   return TRUE;
 }
@@ -265,6 +586,358 @@ enter_meditation (RmgExecutor *executor, RmgDEvent *dispatcher_event)
   raise (SIGTERM);
 }
 
+static void
+executor_job_free (gpointer _job)
+{
+  ExecutorJob *job = (ExecutorJob *)_job;
+
+  if (job->executor != NULL)
+    {
+      executor_event_release (job->executor, job->event);
+      rmg_executor_unref (job->executor);
+    }
+
+  if (job->dispatcher_event != NULL)
+    rmg_devent_unref (job->dispatcher_event);
+
+  g_clear_pointer (&job->service_name, g_ref_string_release);
+  g_free (job);
+}
+
+static void
+executor_post_job_event (RmgExecutor *executor, ExecutorJob *job, DispatcherEventType type,
+                         RmgFailureReason failure_reason)
+{
+  RmgDEvent *event = NULL;
+
+  if (executor->job_callback == NULL)
+    return;
+
+  event = rmg_devent_new (type);
+  rmg_devent_set_service_name (event, job->service_name);
+
+  if (job->dispatcher_event->manager_proxy != NULL)
+    rmg_devent_set_manager_proxy (event, job->dispatcher_event->manager_proxy);
+
+  if (type == DEVENT_SERVICE_RECOVERY_FAILED)
+    rmg_devent_set_failure (event, failure_reason, 0, 0);
+
+  executor->job_callback (event, executor->job_data);
+}
+
+static void
+executor_job_done (RmgExecutor *executor, ExecutorJob *job, gint64 latency)
+{
+  ExecutorRestartStats *stats = NULL;
+
+  if (job->dispatcher_event == NULL)
+    {
+      g_info ("Friend %s job for unit='%s' done", job->method, job->service_name);
+      return;
+    }
+
+  stats = (ExecutorRestartStats *)g_hash_table_lookup (executor->restart_stats,
+                                                       job->service_name);
+  if (stats == NULL)
+    {
+      stats = g_new0 (ExecutorRestartStats, 1);
+      g_hash_table_insert (executor->restart_stats, g_ref_string_acquire (job->service_name),
+                           stats);
+    }
+
+  stats->restarts++;
+  stats->last_latency = latency;
+  stats->max_latency = MAX (stats->max_latency, latency);
+  stats->total_latency += latency;
+
+  g_info ("Service '%s' active %" G_GINT64_FORMAT "ms after restart, average %" G_GINT64_FORMAT
+          "ms max %" G_GINT64_FORMAT "ms over %u restarts",
+          job->service_name, latency, stats->total_latency / stats->restarts, stats->max_latency,
+          stats->restarts);
+
+  if (job->dispatcher_event->type == DEVENT_SERVICE_CRASHED)
+    executor_post_job_event (executor, job, DEVENT_SERVICE_RECOVERED, FAILURE_UNKNOWN);
+}
+
+static void
+executor_job_failed (RmgExecutor *executor, ExecutorJob *job, const gchar *result)
+{
+  RmgFailureReason failure_reason = FAILURE_UNKNOWN;
+
+  g_warning ("%s job for unit='%s' finished with result '%s'", job->method, job->service_name,
+             result);
+
+  if (job->dispatcher_event == NULL || job->dispatcher_event->type != DEVENT_SERVICE_CRASHED)
+    return;
+
+  /* a failed start leaves the unit failed and the monitor reports the crash, a dependency or
+   * timeout failure never reaches the failed state, canceled and skipped jobs are not
+   * failures of the service */
+  if (g_strcmp0 (result, "dependency") == 0)
+    failure_reason = FAILURE_DEPENDENCY;
+  else if (g_strcmp0 (result, "timeout") == 0)
+    failure_reason = FAILURE_TIMEOUT;
+  else if (g_strcmp0 (result, "failed") != 0)
+    return;
+
+  executor_post_job_event (executor, job, DEVENT_SERVICE_RECOVERY_FAILED, failure_reason);
+}
+
+static void
+on_job_removed (GDBusConnection *connection, const gchar *sender_name, const gchar *object_path,
+                const gchar *interface_name, const gchar *signal_name, GVariant *parameters,
+                gpointer user_data)
+{
+  RmgExecutor *executor = (RmgExecutor *)user_data;
+  const gchar *job_path = NULL;
+  const gchar *unit_name = NULL;
+  const gchar *result = NULL;
+  ExecutorJob *job = NULL;
+  guint32 job_id = 0;
+  gint64 latency = 0;
+
+  RMG_UNUSED (connection);
+  RMG_UNUSED (sender_name);
+  RMG_UNUSED (object_path);
+  RMG_UNUSED (interface_name);
+  RMG_UNUSED (signal_name);
+
+  g_variant_get (parameters, "(u&o&s&s)", &job_id, &job_path, &unit_name, &result);
+
+  job = (ExecutorJob *)g_hash_table_lookup (executor->jobs, job_path);
+  if (job == NULL)
+    return;
+
+  latency = (g_get_monotonic_time () - job->start_time) / 1000;
+
+  if (g_strcmp0 (result, "done") == 0)
+    executor_job_done (executor, job, latency);
+  else
+    executor_job_failed (executor, job, result);
+
+  g_hash_table_remove (executor->jobs, job_path);
+}
+
+static void
+executor_unit_call_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  ExecutorJob *job = (ExecutorJob *)user_data;
+  g_autoptr (RmgExecutor) executor = g_steal_pointer (&job->executor);
+  g_autoptr (GVariant) response = NULL;
+  g_autoptr (GError) error = NULL;
+  const gchar *job_path = NULL;
+
+  /* the lane is released once the manager accepted the request, it queues the unit jobs */
+  executor_event_release (executor, g_steal_pointer (&job->event));
+
+  response = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (response == NULL)
+    {
+      g_warning ("Fail to call %s on Manager proxy for unit='%s'. Error %s", job->method,
+                 job->service_name, error->message);
+
+      /* the unit was not restarted so the action did not recover the service */
+      if (job->dispatcher_event != NULL && job->dispatcher_event->type == DEVENT_SERVICE_CRASHED)
+        executor_post_job_event (executor, job, DEVENT_SERVICE_RECOVERY_FAILED, FAILURE_UNKNOWN);
+
+      executor_job_free (job);
+      return;
+    }
+
+  /* KillUnit queues no job */
+  if (!g_variant_is_of_type (response, G_VARIANT_TYPE ("(o)")))
+    {
+      executor_job_free (job);
+      return;
+    }
+
+  g_variant_get (response, "(&o)", &job_path);
+  g_debug ("%s job '%s' queued for unit='%s'", job->method, job_path, job->service_name);
+
+  /* the manager replies before it runs the job so JobRemoved follows this reply */
+  g_hash_table_insert (executor->jobs, g_strdup (job_path), job);
+}
+
+static ExecutorAction *
+executor_action_new (RmgExecutor *executor, RmgDEvent *dispatcher_event, ExecutorActionDone done)
+{
+  ExecutorAction *action = g_new0 (ExecutorAction, 1);
+
+  action->executor = rmg_executor_ref (executor);
+  action->dispatcher_event = rmg_devent_ref (dispatcher_event);
+  action->event = executor_event_hold (executor);
+  action->done = done;
+
+  return action;
+}
+
+static void
+executor_action_complete (ExecutorAction *action)
+{
+  RmgExecutor *executor = action->executor;
+  RmgExecutorEvent *current = executor->current;
+
+  /* operations chained on completion hold the event of the action */
+  executor->current = action->event;
+
+  if (action->done != NULL)
+    action->done (executor, action->dispatcher_event);
+
+  executor->current = current;
+  executor_event_release (executor, action->event);
+
+  rmg_devent_unref (action->dispatcher_event);
+  rmg_executor_unref (action->executor);
+  g_free (action);
+}
+
+static void
+executor_command_cb (gpointer _command, gpointer user_data)
+{
+  RmgCommand *command = (RmgCommand *)_command;
+  ExecutorAction *action = (ExecutorAction *)user_data;
+
+  if (command->error != NULL)
+    g_warning ("Fail to run %s. Error %s", command->name, command->error->message);
+  else if (command->exit_status != 0)
+    {
+      g_warning ("%s for service='%s' failed exitcode=%d%s output='%s'", command->name,
+                 action->dispatcher_event->service_name, command->exit_status,
+                 command->timed_out ? " (timed out)" : "", command->output_tail->str);
+    }
+  else
+    {
+      g_info ("%s for service='%s' exitcode=0", command->name,
+              action->dispatcher_event->service_name);
+    }
+
+  executor_action_complete (action);
+}
+
+static void
+executor_run_command (RmgExecutor *executor, RmgDEvent *dispatcher_event, const gchar *name,
+                      RmgCommandTemplate *tmpl, const gchar *path, ExecutorActionDone done)
+{
+  g_autoptr (RmgCommand) command = NULL;
+  ExecutorAction *action = executor_action_new (executor, dispatcher_event, done);
+  const gchar *values[COMMAND_SLOT_COUNT] = { NULL };
+
+  values[COMMAND_SLOT_PATH] = path;
+  values[COMMAND_SLOT_SERVICE_NAME] = dispatcher_event->service_name;
+
+  command = rmg_command_template_instance (
+      tmpl, name, values, rmg_options_long_for (executor->options, KEY_COMMAND_TIMEOUT_SEC));
+
+  /* the main loop keeps serving other services while the command runs */
+  rmg_command_run (command, executor_command_cb, action);
+}
+
+static void
+executor_datareset_cb (gpointer _reset, gpointer user_data)
+{
+  RmgDataReset *reset = (RmgDataReset *)_reset;
+  ExecutorAction *action = (ExecutorAction *)user_data;
+
+  if (reset->errors > 0)
+    {
+      g_warning ("%s for service='%s' left %d entries in '%s'", reset->name,
+                 action->dispatcher_event->service_name, reset->errors, reset->path);
+    }
+
+  executor_action_complete (action);
+}
+
+static void
+executor_run_data_reset (RmgExecutor *executor, RmgDEvent *dispatcher_event, const gchar *name,
+                         const gchar *path, ExecutorActionDone done)
+{
+  g_autoptr (RmgDataReset) reset = NULL;
+  g_autoptr (GError) error = NULL;
+  ExecutorAction *action = NULL;
+
+  reset = rmg_datareset_new (
+      name, path, rmg_options_long_for (executor->options, KEY_DATA_RESET_WORKERS), &error);
+  if (reset == NULL)
+    {
+      g_warning ("%s for service='%s' skipped. Error %s", name, dispatcher_event->service_name,
+                 error->message);
+
+      if (done != NULL)
+        done (executor, dispatcher_event);
+
+      return;
+    }
+
+  action = executor_action_new (executor, dispatcher_event, done);
+
+  /* the directory is cleared by worker threads while the main loop keeps running */
+  rmg_datareset_run (reset, executor_datareset_cb, action);
+}
+
+static void
+executor_swap_data (RmgExecutor *executor, RmgDEvent *dispatcher_event, const gchar *name,
+                    const gchar *path, ExecutorActionDone done)
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *trash_path = NULL;
+
+  if (!rmg_datareset_swap (path, dispatcher_event->service_name, &trash_path, &error))
+    {
+      if (path == NULL)
+        {
+          g_warning ("%s for service='%s' skipped. Error %s", name,
+                     dispatcher_event->service_name, error->message);
+
+          if (done != NULL)
+            done (executor, dispatcher_event);
+
+          return;
+        }
+
+      g_warning ("%s for service='%s' cannot swap, clear in place. Error %s", name,
+                 dispatcher_event->service_name, error->message);
+      executor_run_data_reset (executor, dispatcher_event, name, path, done);
+      return;
+    }
+
+  g_info ("%s for service='%s' swapped '%s' into '%s'", name, dispatcher_event->service_name,
+          path, trash_path);
+
+  rmg_reaper_add (executor->reaper, trash_path);
+
+  if (done != NULL)
+    done (executor, dispatcher_event);
+}
+
+static void
+executor_resume_reaper (RmgExecutor *executor)
+{
+  g_autoptr (GError) error = NULL;
+  GList *names = NULL;
+
+  names = rmg_journal_get_service_names (executor->journal, &error);
+  if (error != NULL)
+    {
+      g_warning ("Fail to read services for trash reaping. Error %s", error->message);
+      return;
+    }
+
+  /* trash left by a reset before a reboot is reaped again */
+  for (GList *l = names; l != NULL; l = l->next)
+    {
+      g_autofree gchar *public_path = NULL;
+      g_autofree gchar *private_path = NULL;
+
+      public_path = rmg_journal_get_public_data_path (executor->journal, l->data, NULL);
+      private_path = rmg_journal_get_private_data_path (executor->journal, l->data, NULL);
+
+      rmg_reaper_resume (executor->reaper, public_path);
+      rmg_reaper_resume (executor->reaper, private_path);
+    }
+
+  g_list_free_full (names, (GDestroyNotify)g_ref_string_release);
+}
+
 static void
 foreach_service_friend (gpointer _friend, gpointer _executor)
 {
@@ -286,7 +959,7 @@ foreach_service_friend_remove (gpointer data)
 
   g_assert (entry);
 
-  g_free (entry->service_name);
+  g_clear_pointer (&entry->service_name, g_ref_string_release);
   g_free (entry);
 }
 
@@ -326,14 +999,6 @@ do_process_service_reset_public_data_event (RmgExecutor *executor, RmgDEvent *di
 {
   g_autoptr (GError) error = NULL;
   g_autofree gchar *reset_path = NULL;
-  g_autofree gchar *reset_cmd = NULL;
-  g_autofree gchar *reset_with_path_cmd = NULL;
-  g_autofree gchar *reset_with_name_cmd = NULL;
-  g_autofree gchar *standard_output = NULL;
-  g_autofree gchar *command_line = NULL;
-  gchar **path_tokens = NULL;
-  gchar **name_tokens = NULL;
-  gint exit_status;
 
   g_assert (executor);
   g_assert (dispatcher_event);
@@ -347,29 +1012,33 @@ do_process_service_reset_public_data_event (RmgExecutor *executor, RmgDEvent *di
       return;
     }
 
-  reset_cmd = rmg_options_string_for (executor->options, KEY_PUBLIC_DATA_RESET_CMD);
-
-  path_tokens = g_strsplit (reset_cmd, "${path}", 3);
-  reset_with_path_cmd = g_strjoinv (reset_path, path_tokens);
-  g_strfreev (path_tokens);
-
-  name_tokens = g_strsplit (reset_with_path_cmd, "${service_name}", 3);
-  reset_with_name_cmd = g_strjoinv (dispatcher_event->service_name, name_tokens);
-  g_strfreev (name_tokens);
+  if (executor->reset_mode == DATA_RESET_MODE_NATIVE)
+    {
+      g_info ("Reset public data for service='%s' path='%s'", dispatcher_event->service_name,
+              reset_path);
 
-  g_info ("Reset public data for service='%s' command='%s'", dispatcher_event->service_name,
-          reset_with_name_cmd);
+      /* do service restart once the data reset completes */
+      executor_run_data_reset (executor, dispatcher_event, "Public data reset", reset_path,
+                               do_process_service_restart_event);
+      return;
+    }
+  else if (executor->reset_mode == DATA_RESET_MODE_SWAP)
+    {
+      g_info ("Reset public data for service='%s' path='%s'", dispatcher_event->service_name,
+              reset_path);
 
-  command_line = g_strdup_printf ("sh -c \"%s\"", reset_with_name_cmd);
+      /* the service restarts while the old data is removed */
+      executor_swap_data (executor, dispatcher_event, "Public data reset", reset_path,
+                          do_process_service_restart_event);
+      return;
+    }
 
-  g_spawn_command_line_sync (command_line, &standard_output, NULL, &exit_status, &error);
-  if (error != NULL)
-    g_warning ("Fail to spawn process. Error %s", error->message);
-  else
-    g_info ("Public data reset exitcode=%d output='%s'", exit_status, standard_output);
+  g_info ("Reset public data for service='%s' path='%s' command='%s'",
+          dispatcher_event->service_name, reset_path, executor->public_reset_cmd->command_line);
 
-  /* do service restart */
-  do_process_service_restart_event (executor, dispatcher_event);
+  /* do service restart once the data reset completes */
+  executor_run_command (executor, dispatcher_event, "Public data reset", executor->public_reset_cmd,
+                        reset_path, do_process_service_restart_event);
 }
 
 static void
@@ -377,14 +1046,6 @@ do_process_service_reset_private_data_event (RmgExecutor *executor, RmgDEvent *d
 {
   g_autoptr (GError) error = NULL;
   g_autofree gchar *reset_path = NULL;
-  g_autofree gchar *reset_cmd = NULL;
-  g_autofree gchar *reset_with_path_cmd = NULL;
-  g_autofree gchar *reset_with_name_cmd = NULL;
-  g_autofree gchar *standard_output = NULL;
-  g_autofree gchar *command_line = NULL;
-  gchar **path_tokens = NULL;
-  gchar **name_tokens = NULL;
-  gint exit_status;
 
   g_assert (executor);
   g_assert (dispatcher_event);
@@ -398,29 +1059,33 @@ do_process_service_reset_private_data_event (RmgExecutor *executor, RmgDEvent *d
       return;
     }
 
-  reset_cmd = rmg_options_string_for (executor->options, KEY_PRIVATE_DATA_RESET_CMD);
-
-  path_tokens = g_strsplit (reset_cmd, "${path}", 3);
-  reset_with_path_cmd = g_strjoinv (reset_path, path_tokens);
-  g_strfreev (path_tokens);
-
-  name_tokens = g_strsplit (reset_with_path_cmd, "${service_name}", 3);
-  reset_with_name_cmd = g_strjoinv (dispatcher_event->service_name, name_tokens);
-  g_strfreev (name_tokens);
+  if (executor->reset_mode == DATA_RESET_MODE_NATIVE)
+    {
+      g_info ("Reset private data for service='%s' path='%s'", dispatcher_event->service_name,
+              reset_path);
 
-  g_info ("Reset private data for service='%s' command='%s'", dispatcher_event->service_name,
-          reset_with_name_cmd);
+      /* do service restart once the data reset completes */
+      executor_run_data_reset (executor, dispatcher_event, "Private data reset", reset_path,
+                               do_process_service_restart_event);
+      return;
+    }
+  else if (executor->reset_mode == DATA_RESET_MODE_SWAP)
+    {
+      g_info ("Reset private data for service='%s' path='%s'", dispatcher_event->service_name,
+              reset_path);
 
-  command_line = g_strdup_printf ("sh -c \"%s\"", reset_with_name_cmd);
+      /* the service restarts while the old data is removed */
+      executor_swap_data (executor, dispatcher_event, "Private data reset", reset_path,
+                          do_process_service_restart_event);
+      return;
+    }
 
-  g_spawn_command_line_sync (command_line, &standard_output, NULL, &exit_status, &error);
-  if (error != NULL)
-    g_warning ("Fail to spawn process. Error %s", error->message);
-  else
-    g_info ("Private data reset exitcode=%d output='%s'", exit_status, standard_output);
+  g_info ("Reset private data for service='%s' path='%s' command='%s'",
+          dispatcher_event->service_name, reset_path, executor->private_reset_cmd->command_line);
 
-  /* do service restart */
-  do_process_service_restart_event (executor, dispatcher_event);
+  /* do service restart once the data reset completes */
+  executor_run_command (executor, dispatcher_event, "Private data reset",
+                        executor->private_reset_cmd, reset_path, do_process_service_restart_event);
 }
 
 static void
@@ -436,7 +1101,7 @@ do_process_context_restart_event (RmgExecutor *executor, RmgDEvent *dispatcher_e
   if (g_run_mode == RUN_MODE_PRIMARY)
     {
       if (dispatcher_event->context_name == NULL)
-        do_process_platform_restart_event_primary (executor, dispatcher_event);
+        do_process_platform_restart_event_primary (executor, dispatcher_event, NULL);
       else
         do_process_context_restart_event_primary (executor, dispatcher_event);
     }
@@ -508,29 +1173,17 @@ do_process_context_restart_event_replica (RmgExecutor *executor, RmgDEvent *disp
 }
 
 static void
-do_process_platform_restart_event_primary (RmgExecutor *executor, RmgDEvent *dispatcher_event)
+do_process_platform_restart_event_primary (RmgExecutor *executor, RmgDEvent *dispatcher_event,
+                                           ExecutorActionDone done)
 {
-  g_autoptr (GError) error = NULL;
-  g_autofree gchar *reset_cmd = NULL;
-  g_autofree gchar *standard_output = NULL;
-  g_autofree gchar *command_line = NULL;
-  gint exit_status;
-
   g_assert (executor);
   g_assert (dispatcher_event);
 
-  reset_cmd = rmg_options_string_for (executor->options, KEY_PLATFORM_RESTART_CMD);
-
   g_info ("Do platform restart on service='%s' request. Command='%s'",
-          dispatcher_event->service_name, reset_cmd);
-
-  command_line = g_strdup_printf ("sh -c \"%s\"", reset_cmd);
+          dispatcher_event->service_name, executor->platform_restart_cmd->command_line);
 
-  g_spawn_command_line_sync (command_line, &standard_output, NULL, &exit_status, &error);
-  if (error != NULL)
-    g_warning ("Fail to spawn process. Error %s", error->message);
-  else
-    g_info ("Platform restart exitcode=%d output='%s'", exit_status, standard_output);
+  executor_run_command (executor, dispatcher_event, "Platform restart",
+                        executor->platform_restart_cmd, NULL, done);
 }
 
 static void
@@ -555,37 +1208,26 @@ static void
 do_process_platform_restart_event (RmgExecutor *executor, RmgDEvent *dispatcher_event)
 {
   if (g_run_mode == RUN_MODE_PRIMARY)
-    do_process_platform_restart_event_primary (executor, dispatcher_event);
+    do_process_platform_restart_event_primary (executor, dispatcher_event, enter_meditation);
   else
-    do_process_platform_restart_event_replica (executor, dispatcher_event);
-
-  enter_meditation (executor, dispatcher_event);
+    {
+      do_process_platform_restart_event_replica (executor, dispatcher_event);
+      enter_meditation (executor, dispatcher_event);
+    }
 }
 
 static void
-do_process_factory_reset_event_primary (RmgExecutor *executor, RmgDEvent *dispatcher_event)
+do_process_factory_reset_event_primary (RmgExecutor *executor, RmgDEvent *dispatcher_event,
+                                        ExecutorActionDone done)
 {
-  g_autoptr (GError) error = NULL;
-  g_autofree gchar *reset_cmd = NULL;
-  g_autofree gchar *standard_output = NULL;
-  g_autofree gchar *command_line = NULL;
-  gint exit_status;
-
   g_assert (executor);
   g_assert (dispatcher_event);
 
-  reset_cmd = rmg_options_string_for (executor->options, KEY_FACTORY_RESET_CMD);
-
   g_info ("Do factory reset on service='%s' request. Command='%s'", dispatcher_event->service_name,
-          reset_cmd);
-
-  command_line = g_strdup_printf ("sh -c \"%s\"", reset_cmd);
+          executor->factory_reset_cmd->command_line);
 
-  g_spawn_command_line_sync (command_line, &standard_output, NULL, &exit_status, &error);
-  if (error != NULL)
-    g_warning ("Fail to spawn process. Error %s", error->message);
-  else
-    g_info ("Factory reset exitcode=%d output='%s'", exit_status, standard_output);
+  executor_run_command (executor, dispatcher_event, "Factory reset", executor->factory_reset_cmd,
+                        NULL, done);
 }
 
 static void
@@ -610,31 +1252,26 @@ static void
 do_process_factory_reset_event (RmgExecutor *executor, RmgDEvent *dispatcher_event)
 {
   if (g_run_mode == RUN_MODE_PRIMARY)
-    do_process_factory_reset_event_primary (executor, dispatcher_event);
+    do_process_factory_reset_event_primary (executor, dispatcher_event, enter_meditation);
   else
-    do_process_factory_reset_event_replica (executor, dispatcher_event);
-
-  enter_meditation (executor, dispatcher_event);
+    {
+      do_process_factory_reset_event_replica (executor, dispatcher_event);
+      enter_meditation (executor, dispatcher_event);
+    }
 }
 
 static void
 do_process_service_restart_event (RmgExecutor *executor, RmgDEvent *dispatcher_event)
 {
-  g_autoptr (GError) error = NULL;
-  g_autoptr (GVariant) response = NULL;
-
   g_assert (executor);
   g_assert (dispatcher_event);
 
-  response
-      = g_dbus_proxy_call_sync (dispatcher_event->manager_proxy, "RestartUnit",
-                                g_variant_new ("(ss)", dispatcher_event->service_name, "replace"),
-                                G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+  g_info ("Request service restart for unit='%s'", dispatcher_event->service_name);
 
-  if (error != NULL)
-    g_warning ("Fail to call RestartUnit on Manager proxy. Error %s", error->message);
-  else
-    g_info ("Request service restart for unit='%s'", dispatcher_event->service_name);
+  /* the restart outcome is reported once the job is removed */
+  rmg_executor_call_unit (executor, dispatcher_event->manager_proxy, "RestartUnit",
+                          g_variant_new ("(ss)", dispatcher_event->service_name, "replace"),
+                          dispatcher_event->service_name, dispatcher_event);
 }
 
 static void
@@ -649,10 +1286,24 @@ executor_source_destroy_notify (gpointer _executor)
 }
 
 static void
-executor_queue_destroy_notify (gpointer _executor)
+executor_event_free (gpointer _event)
 {
-  RMG_UNUSED (_executor);
-  g_debug ("Executor queue destroy notification");
+  RmgExecutorEvent *event = (RmgExecutorEvent *)_event;
+
+  rmg_devent_unref (event->dispatcher_event);
+
+  if (executor_event_pool != NULL)
+    rmg_pool_free (executor_event_pool, event);
+  else
+    g_free (event);
+}
+
+static RmgCommandTemplate *
+executor_command_template (RmgOptions *options, RmgOptionsKey key)
+{
+  g_autofree gchar *command_line = rmg_options_string_for (options, key);
+
+  return rmg_command_template_new (command_line);
 }
 
 RmgExecutor *
@@ -660,6 +1311,8 @@ rmg_executor_new (RmgOptions *options, RmgJournal *journal)
 {
   RmgExecutor *executor
       = (RmgExecutor *)g_source_new (&executor_source_funcs, sizeof (RmgExecutor));
+  g_autofree gchar *reset_mode_name = rmg_options_string_for (options, KEY_DATA_RESET_MODE);
+  glong capacity = rmg_options_long_for (options, KEY_EVENT_POOL_CAPACITY);
 
   g_assert (executor);
 
@@ -667,12 +1320,34 @@ rmg_executor_new (RmgOptions *options, RmgJournal *journal)
   executor->callback = executor_source_callback;
   executor->options = rmg_options_ref (options);
   executor->journal = rmg_journal_ref (journal);
-  executor->queue = g_async_queue_new_full (executor_queue_destroy_notify);
+  executor->jobs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, executor_job_free);
+  executor->restart_stats = g_hash_table_new_full (
+      g_direct_hash, g_direct_equal, (GDestroyNotify)g_ref_string_release, g_free);
+  executor->reaper = rmg_reaper_new (rmg_options_long_for (options, KEY_DATA_REAPER_RATE));
+  executor->pending = g_queue_new ();
+  executor->busy_lanes = g_hash_table_new (g_direct_hash, g_direct_equal);
+  executor->workers = (guint)CLAMP (rmg_options_long_for (options, KEY_EXECUTOR_WORKERS), 1,
+                                    G_MAXUINT16);
+  executor->reset_mode = rmg_datareset_mode_from (reset_mode_name);
+  executor->public_reset_cmd = executor_command_template (options, KEY_PUBLIC_DATA_RESET_CMD);
+  executor->private_reset_cmd = executor_command_template (options, KEY_PRIVATE_DATA_RESET_CMD);
+  executor->platform_restart_cmd = executor_command_template (options, KEY_PLATFORM_RESTART_CMD);
+  executor->factory_reset_cmd = executor_command_template (options, KEY_FACTORY_RESET_CMD);
+  /* the events outlive a released executor while queued so the pool is kept */
+  if (executor_event_pool == NULL)
+    executor_event_pool = rmg_pool_new ("executor", sizeof (RmgExecutorEvent),
+                                         (guint)CLAMP (capacity, 0, G_MAXUINT16));
+
+  executor->queue = rmg_eventqueue_new_for_options ("executor", options, executor_event_free);
+  g_source_add_unix_fd (RMG_EVENT_SOURCE (executor), rmg_eventqueue_get_fd (executor->queue),
+                        G_IO_IN);
 
   g_source_set_callback (RMG_EVENT_SOURCE (executor), NULL, executor,
                          executor_source_destroy_notify);
   g_source_attach (RMG_EVENT_SOURCE (executor), NULL);
 
+  executor_resume_reaper (executor);
+
   return executor;
 }
 
@@ -703,14 +1378,43 @@ rmg_executor_unref (RmgExecutor *executor)
       if (executor->server != NULL)
         rmg_server_unref (executor->server);
 
+      if (executor->job_subscription != 0)
+        {
+          g_dbus_connection_signal_unsubscribe (
+              g_dbus_proxy_get_connection (executor->sd_manager_proxy), executor->job_subscription);
+        }
+
       if (executor->sd_manager_proxy != NULL)
         g_object_unref (executor->sd_manager_proxy);
 
-      g_async_queue_unref (executor->queue);
+      g_hash_table_destroy (executor->jobs);
+      rmg_reaper_unref (executor->reaper);
+      g_queue_free_full (executor->pending, executor_event_free);
+      g_hash_table_destroy (executor->busy_lanes);
+      g_hash_table_destroy (executor->restart_stats);
+      rmg_command_template_unref (executor->public_reset_cmd);
+      rmg_command_template_unref (executor->private_reset_cmd);
+      rmg_command_template_unref (executor->platform_restart_cmd);
+      rmg_command_template_unref (executor->factory_reset_cmd);
+
+      rmg_eventqueue_unref (executor->queue);
       g_source_unref (RMG_EVENT_SOURCE (executor));
     }
 }
 
+void
+rmg_executor_release_pool (void)
+{
+  if (executor_event_pool == NULL)
+    return;
+
+  if (rmg_pool_report (executor_event_pool) == 0)
+    {
+      rmg_pool_unref (executor_event_pool);
+      executor_event_pool = NULL;
+    }
+}
+
 void
 rmg_executor_set_replica_manager (RmgExecutor *executor, RmgManager *manager)
 {
@@ -742,4 +1446,50 @@ rmg_executor_set_proxy (RmgExecutor *executor, GDBusProxy *dbus_proxy)
 
   g_debug ("Proxy available for executor");
   executor->sd_manager_proxy = g_object_ref (dbus_proxy);
+
+  /* the monitor subscribes to the manager so the job signals are emitted */
+  executor->job_subscription = g_dbus_connection_signal_subscribe (
+      g_dbus_proxy_get_connection (dbus_proxy), sd_dbus_name, sd_dbus_interface_manager,
+      "JobRemoved", sd_dbus_object_path, NULL, G_DBUS_SIGNAL_FLAGS_NONE, on_job_removed, executor,
+      NULL); /* user data free func */
+}
+
+void
+rmg_executor_register_job_callback (RmgExecutor *executor, RmgExecutorJobCallback callback,
+                                    gpointer data)
+{
+  g_assert (executor);
+
+  executor->job_callback = callback;
+  executor->job_data = data;
+}
+
+gboolean
+rmg_executor_tracks_jobs (RmgExecutor *executor)
+{
+  g_assert (executor);
+  return executor->job_subscription != 0 && executor->job_callback != NULL;
+}
+
+void
+rmg_executor_call_unit (RmgExecutor *executor, GDBusProxy *proxy, const gchar *method,
+                        GVariant *parameters, const gchar *service_name,
+                        RmgDEvent *dispatcher_event)
+{
+  ExecutorJob *job = g_new0 (ExecutorJob, 1);
+
+  g_assert (executor);
+  g_assert (proxy);
+  g_assert (method);
+  g_assert (service_name);
+
+  job->executor = rmg_executor_ref (executor);
+  job->method = method;
+  rmg_utils_set_name (&job->service_name, service_name);
+  job->dispatcher_event = dispatcher_event != NULL ? rmg_devent_ref (dispatcher_event) : NULL;
+  job->event = executor_event_hold (executor);
+  job->start_time = g_get_monotonic_time ();
+
+  g_dbus_proxy_call (proxy, method, parameters, G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                     executor_unit_call_cb, job);
 }
@@ -23,10 +23,14 @@
 
 #pragma once
 
+#include "rmg-command.h"
+#include "rmg-datareset.h"
 #include "rmg-devent.h"
+#include "rmg-eventqueue.h"
 #include "rmg-journal.h"
 #include "rmg-manager.h"
 #include "rmg-options.h"
+#include "rmg-reaper.h"
 #include "rmg-server.h"
 #include "rmg-types.h"
 
@@ -52,20 +56,42 @@ typedef enum _ExecutorEventType
   EXECUTOR_EVENT_FACTORY_RESET
 } ExecutorEventType;
 
+/**
+ * @enum ExecutorEventPriority
+ * @brief Executor event priority class derived from the action severity
+ */
+typedef enum _ExecutorEventPriority
+{
+  EXECUTOR_PRIORITY_SERVICE, /**< Actions on a single service and friend notifications */
+  EXECUTOR_PRIORITY_CONTEXT, /**< Container restart */
+  EXECUTOR_PRIORITY_GLOBAL   /**< Platform restart and factory reset */
+} ExecutorEventPriority;
+
 /**
  * @function RmgExecutorCallback
  * @brief Custom callback used internally by RmgExecutor as source callback
  */
 typedef gboolean (*RmgExecutorCallback) (gpointer _executor, gpointer _event);
 
+/**
+ * @function RmgExecutorJobCallback
+ * @brief Receives the event reporting the outcome of a recovery restart job
+ * The callback owns the event reference
+ */
+typedef void (*RmgExecutorJobCallback) (RmgDEvent *event, gpointer user_data);
+
 /**
  * @struct RmgExecutorEvent
  * @brief The file transfer event
  */
 typedef struct _RmgExecutorEvent
 {
-  ExecutorEventType type;      /**< The event type the element holds */
-  RmgDEvent *dispatcher_event; /**< Event object from dispatcher */
+  ExecutorEventType type;         /**< The event type the element holds */
+  RmgDEvent *dispatcher_event;    /**< Event object from dispatcher */
+  gchar *lane;                    /**< Service or context the event is ordered in (atom) */
+  RmgActionType severity;         /**< Severity of the action the event performs */
+  ExecutorEventPriority priority; /**< Priority class of the event */
+  guint holds;                    /**< Operations in progress for the running event */
 } RmgExecutorEvent;
 
 /**
@@ -80,8 +106,28 @@ typedef struct _RmgExecutor
   RmgManager *manager;
   RmgServer *server;
   GDBusProxy *sd_manager_proxy;
-  GAsyncQueue *queue;           /**< Async queue */
-  RmgExecutorCallback callback; /**< Callback function */
+  RmgEventQueue *queue;                     /**< Event queue */
+  RmgExecutorCallback callback;             /**< Callback function */
+  GHashTable *jobs;                         /**< Pending unit jobs by job object path */
+  GHashTable *restart_stats;                /**< Restart to active latency by service name */
+  guint job_subscription;                   /**< JobRemoved signal subscription */
+  RmgExecutorJobCallback job_callback;      /**< Receiver of the restart job outcome */
+  gpointer job_data;                        /**< Job callback user data */
+  RmgReaper *reaper;                        /**< Background removal of swapped out data */
+  GQueue *pending;                          /**< Events waiting for their lane or a worker */
+  GHashTable *busy_lanes;                   /**< Lanes with an event running */
+  RmgExecutorEvent *current;                /**< Event whose action is being started */
+  guint running;                            /**< Events running */
+  guint workers;                            /**< Events allowed to run at the same time */
+  gboolean barrier;                         /**< A global action is running */
+  gboolean scheduling;                      /**< The pending events are being scheduled */
+  gboolean reschedule;                      /**< Schedule again once the current pass ends */
+  guint superseded;                         /**< Pending events dropped for a global action */
+  RmgDataResetMode reset_mode;              /**< How the service data is reset */
+  RmgCommandTemplate *public_reset_cmd;     /**< Public data reset command */
+  RmgCommandTemplate *private_reset_cmd;    /**< Private data reset command */
+  RmgCommandTemplate *platform_restart_cmd; /**< Platform restart command */
+  RmgCommandTemplate *factory_reset_cmd;    /**< Factory reset command */
   grefcount rc;
 } RmgExecutor;
 
@@ -103,6 +149,12 @@ RmgExecutor *rmg_executor_ref (RmgExecutor *executor);
  */
 void rmg_executor_unref (RmgExecutor *executor);
 
+/**
+ * @brief Report the executor event pool counters at shutdown
+ * The pool is freed only when no queued event still holds a slab block
+ */
+void rmg_executor_release_pool (void);
+
 /**
  * @brief Set replica manager
  * @param executor Pointer to the executor object
@@ -128,6 +180,39 @@ void rmg_executor_push_event (RmgExecutor *executor, ExecutorEventType type,
  */
 void rmg_executor_set_proxy (RmgExecutor *executor, GDBusProxy *dbus_proxy);
 
+/**
+ * @brief Register the receiver of the restart job outcome
+ * Restarts of crashed services report DEVENT_SERVICE_RECOVERED once the unit is active or
+ * DEVENT_SERVICE_RECOVERY_FAILED if the job or the restart call failed. The failure reason
+ * is set only if the unit does not enter the failed state.
+ * @param executor Pointer to the executor object
+ * @param callback The callback or NULL to unregister
+ * @param data The callback user data
+ */
+void rmg_executor_register_job_callback (RmgExecutor *executor, RmgExecutorJobCallback callback,
+                                         gpointer data);
+
+/**
+ * @brief Check if the restart jobs report their outcome
+ * @param executor Pointer to the executor object
+ * @return TRUE if JobRemoved is followed and a job callback is registered
+ */
+gboolean rmg_executor_tracks_jobs (RmgExecutor *executor);
+
+/**
+ * @brief Call a unit method on the service manager without blocking
+ * The job returned by the call is tracked until the service manager removes it
+ * @param executor Pointer to the executor object
+ * @param proxy The service manager proxy
+ * @param method The manager method name, a static string
+ * @param parameters The method parameters, floating references are consumed
+ * @param service_name The unit name
+ * @param dispatcher_event The event the call recovers from or NULL
+ */
+void rmg_executor_call_unit (RmgExecutor *executor, GDBusProxy *proxy, const gchar *method,
+                             GVariant *parameters, const gchar *service_name,
+                             RmgDEvent *dispatcher_event);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgExecutor, rmg_executor_unref);
 
 G_END_DECLS
@@ -43,9 +43,6 @@ friendtimer_callback (gpointer _ftimer)
   RmgFriendTimer *ftimer = (RmgFriendTimer *)_ftimer;
   GDBusProxy *sd_manager_proxy = NULL;
 
-  g_autoptr (GVariant) response = NULL;
-  g_autoptr (GError) error = NULL;
-
   g_assert (ftimer);
 
   sd_manager_proxy = ftimer->executor->sd_manager_proxy;
@@ -53,7 +50,8 @@ friendtimer_callback (gpointer _ftimer)
   g_debug ("Friend timer expired for service='%s' action='%s' arg='%ld'", ftimer->service_name,
            rmg_utils_friend_action_name (ftimer->action), ftimer->argument);
 
-  if ((ftimer->action != FRIEND_ACTION_SIGNAL) && (sd_manager_proxy == NULL))
+  /* all friend actions are requested from the service manager */
+  if (sd_manager_proxy == NULL)
     {
       g_warning ("DBUS action needed for friend, but Manager proxy not available");
       return FALSE;
@@ -63,56 +61,40 @@ friendtimer_callback (gpointer _ftimer)
     {
     case FRIEND_ACTION_START:
       {
-        response = g_dbus_proxy_call_sync (sd_manager_proxy, "StartUnit",
-                                           g_variant_new ("(ss)", ftimer->service_name, "replace"),
-                                           G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
-
-        if (error != NULL)
-          g_warning ("Fail to call StartUnit on Manager proxy. Error %s", error->message);
-        else
-          g_info ("Request StartUnit for unit='%s' on friend timer callback", ftimer->service_name);
+        rmg_executor_call_unit (ftimer->executor, sd_manager_proxy, "StartUnit",
+                                g_variant_new ("(ss)", ftimer->service_name, "replace"),
+                                ftimer->service_name, NULL);
+        g_info ("Request StartUnit for unit='%s' on friend timer callback", ftimer->service_name);
       }
       break;
 
     case FRIEND_ACTION_STOP:
       {
-        response = g_dbus_proxy_call_sync (sd_manager_proxy, "StopUnit",
-                                           g_variant_new ("(ss)", ftimer->service_name, "replace"),
-                                           G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
-
-        if (error != NULL)
-          g_warning ("Fail to call StopUnit on Manager proxy. Error %s", error->message);
-        else
-          g_info ("Request StopUnit for unit='%s' on friend timer callback", ftimer->service_name);
+        rmg_executor_call_unit (ftimer->executor, sd_manager_proxy, "StopUnit",
+                                g_variant_new ("(ss)", ftimer->service_name, "replace"),
+                                ftimer->service_name, NULL);
+        g_info ("Request StopUnit for unit='%s' on friend timer callback", ftimer->service_name);
       }
       break;
 
     case FRIEND_ACTION_RESTART:
       {
-        response = g_dbus_proxy_call_sync (sd_manager_proxy, "RestartUnit",
-                                           g_variant_new ("(ss)", ftimer->service_name, "replace"),
-                                           G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
-
-        if (error != NULL)
-          g_warning ("Fail to call RestartUnit on Manager proxy. Error %s", error->message);
-        else
-          g_info ("Request RestartUnit for unit='%s' on friend timer callback",
-                  ftimer->service_name);
+        rmg_executor_call_unit (ftimer->executor, sd_manager_proxy, "RestartUnit",
+                                g_variant_new ("(ss)", ftimer->service_name, "replace"),
+                                ftimer->service_name, NULL);
+        g_info ("Request RestartUnit for unit='%s' on friend timer callback",
+                ftimer->service_name);
       }
       break;
 
     case FRIEND_ACTION_SIGNAL:
       {
-        response = g_dbus_proxy_call_sync (
-            sd_manager_proxy, "KillUnit",
-            g_variant_new ("(ssi)", ftimer->service_name, "main", ftimer->argument),
-            G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
-
-        if (error != NULL)
-          g_warning ("Fail to call RestartUnit on Manager proxy. Error %s", error->message);
-        else
-          g_info ("Request KillUnit for unit='%s' with arg='%ld' on timer callback",
-                  ftimer->service_name, ftimer->argument);
+        rmg_executor_call_unit (
+            ftimer->executor, sd_manager_proxy, "KillUnit",
+            g_variant_new ("(ssi)", ftimer->service_name, "main", (gint32)ftimer->argument),
+            ftimer->service_name, NULL);
+        g_info ("Request KillUnit for unit='%s' with arg='%ld' on timer callback",
+                ftimer->service_name, ftimer->argument);
       }
       break;
 
@@ -132,7 +114,7 @@ friendtimer_destroy_notify (gpointer _ftimer)
   g_assert (ftimer);
 
   rmg_executor_unref ((RmgExecutor *)ftimer->executor);
-  g_free (ftimer->service_name);
+  g_clear_pointer (&ftimer->service_name, g_ref_string_release);
   g_free (ftimer);
 }
 
@@ -145,7 +127,7 @@ rmg_friendtimer_trigger (const gchar *service_name, RmgFriendActionType action,
   g_assert (service_name);
 
   ftimer->executor = rmg_executor_ref ((RmgExecutor *)executor);
-  ftimer->service_name = g_strdup (service_name);
+  rmg_utils_set_name (&ftimer->service_name, service_name);
   ftimer->action = action;
   ftimer->argument = argument;
 
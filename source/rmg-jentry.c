@@ -42,6 +42,17 @@ friend_entry_free (gpointer _entry)
   g_free (entry);
 }
 
+static void
+probe_entry_free (gpointer _entry)
+{
+  RmgPEntry *entry = (RmgPEntry *)_entry;
+
+  g_assert (entry);
+
+  g_free (entry->target);
+  g_free (entry);
+}
+
 RmgJEntry *
 rmg_jentry_new (gulong version)
 {
@@ -88,6 +99,7 @@ rmg_jentry_unref (RmgJEntry *jentry)
 
       g_list_free_full (jentry->actions, action_entry_free);
       g_list_free_full (jentry->friends, friend_entry_free);
+      g_list_free_full (jentry->probes, probe_entry_free);
 
       g_free (jentry);
     }
@@ -151,9 +163,16 @@ rmg_jentry_set_checkstart (RmgJEntry *jentry, gboolean check_start)
   jentry->check_start = check_start;
 }
 
+void
+rmg_jentry_set_critical (RmgJEntry *jentry, gboolean critical)
+{
+  g_assert (jentry);
+  jentry->critical = critical;
+}
+
 void
 rmg_jentry_add_action (RmgJEntry *jentry, RmgActionType type, glong trigger_level_min,
-                       glong trigger_level_max, gboolean reset_after)
+                       glong trigger_level_max, gboolean reset_after, guint skip_mask)
 {
   RmgAEntry *action = g_new0 (RmgAEntry, 1);
 
@@ -165,6 +184,7 @@ rmg_jentry_add_action (RmgJEntry *jentry, RmgActionType type, glong trigger_leve
   action->trigger_level_min = trigger_level_min;
   action->trigger_level_max = trigger_level_max;
   action->reset_after = reset_after;
+  action->skip_mask = skip_mask;
 
   jentry->actions = g_list_append (jentry->actions, RMG_AENTRY_TO_PTR (action));
 }
@@ -190,6 +210,25 @@ rmg_jentry_add_friend (RmgJEntry *jentry, const gchar *friend_name, const gchar
   jentry->friends = g_list_append (jentry->friends, RMG_FENTRY_TO_PTR (friend));
 }
 
+void
+rmg_jentry_add_probe (RmgJEntry *jentry, RmgProbeType type, const gchar *target,
+                      glong interval, glong timeout, glong threshold)
+{
+  RmgPEntry *probe = g_new0 (RmgPEntry, 1);
+
+  g_assert (jentry);
+  g_assert (target);
+
+  probe->hash = (gulong)g_rand_int (jentry->hash_generator);
+  probe->type = type;
+  probe->target = g_strdup (target);
+  probe->interval = interval;
+  probe->timeout = timeout;
+  probe->threshold = threshold;
+
+  jentry->probes = g_list_append (jentry->probes, RMG_PENTRY_TO_PTR (probe));
+}
+
 gulong
 rmg_jentry_get_hash (RmgJEntry *jentry)
 {
@@ -246,6 +285,13 @@ rmg_jentry_get_checkstart (RmgJEntry *jentry)
   return jentry->check_start;
 }
 
+gboolean
+rmg_jentry_get_critical (RmgJEntry *jentry)
+{
+  g_assert (jentry);
+  return jentry->critical;
+}
+
 const GList *
 rmg_jentry_get_actions (RmgJEntry *jentry)
 {
@@ -41,6 +41,7 @@ typedef struct _RmgAEntry
   glong trigger_level_min;
   glong trigger_level_max;
   gboolean reset_after;
+  guint skip_mask;
 } RmgAEntry;
 
 /**
@@ -58,6 +59,20 @@ typedef struct _RmgFEntry
   glong delay;
 } RmgFEntry;
 
+/**
+ * @struct RmgPEntry
+ * @brief The RmgPEntry data structure
+ */
+typedef struct _RmgPEntry
+{
+  gulong hash;
+  RmgProbeType type;
+  gchar *target;
+  glong interval;
+  glong timeout;
+  glong threshold;
+} RmgPEntry;
+
 /**
  * @struct RmgFEntryParserHelper
  * @brief The RmgFEntry data structure
@@ -71,6 +86,18 @@ typedef struct _RmgFEntryParserHelper
   glong delay;
 } RmgFEntryParserHelper;
 
+/**
+ * @struct RmgPEntryParserHelper
+ * @brief The RmgPEntry attributes until the probe target is parsed
+ */
+typedef struct _RmgPEntryParserHelper
+{
+  RmgProbeType type;
+  glong interval;
+  glong timeout;
+  glong threshold;
+} RmgPEntryParserHelper;
+
 /**
  * @struct RmgJEntry
  * @brief The RmgJEntry opaque data structure
@@ -84,13 +111,16 @@ typedef struct _RmgJEntry
   glong rvector;
   gboolean relaxing;
   gboolean check_start;
+  gboolean critical;
   glong timeout;
   GList *actions;
   GList *friends;
+  GList *probes;
 
   GRand *hash_generator;
   const gchar *parser_current_element;
   RmgFEntryParserHelper parser_current_friend;
+  RmgPEntryParserHelper parser_current_probe;
 
   grefcount rc; /**< Reference counter variable  */
 } RmgJEntry;
@@ -98,6 +128,7 @@ typedef struct _RmgJEntry
 #define RMG_JENTRY_TO_PTR(e) ((gpointer)(RmgJEntry *)(e))
 #define RMG_FENTRY_TO_PTR(e) ((gpointer)(RmgFEntry *)(e))
 #define RMG_AENTRY_TO_PTR(a) ((gpointer)(RmgAEntry *)(a))
+#define RMG_PENTRY_TO_PTR(p) ((gpointer)(RmgPEntry *)(p))
 
 /*
  * @brief Create a new jentry object
@@ -152,11 +183,16 @@ void rmg_jentry_set_timeout (RmgJEntry *jentry, glong timeout);
  */
 void rmg_jentry_set_checkstart (RmgJEntry *jentry, gboolean check_start);
 
+/**
+ * @brief Setter
+ */
+void rmg_jentry_set_critical (RmgJEntry *jentry, gboolean critical);
+
 /**
  * @brief Setter
  */
 void rmg_jentry_add_action (RmgJEntry *jentry, RmgActionType type, glong trigger_level_min,
-                            glong trigger_level_max, gboolean reset_after);
+                            glong trigger_level_max, gboolean reset_after, guint skip_mask);
 
 /**
  * @brief Setter
@@ -165,6 +201,12 @@ void rmg_jentry_add_friend (RmgJEntry *jentry, const gchar *friend_name,
                             const gchar *friend_context, RmgFriendType type,
                             RmgFriendActionType action, glong argument, glong delay);
 
+/**
+ * @brief Setter
+ */
+void rmg_jentry_add_probe (RmgJEntry *jentry, RmgProbeType type, const gchar *target,
+                           glong interval, glong timeout, glong threshold);
+
 /**
  * @brief Getter
  */
@@ -205,6 +247,11 @@ glong rmg_jentry_get_timeout (RmgJEntry *jentry);
  */
 gboolean rmg_jentry_get_checkstart (RmgJEntry *jentry);
 
+/**
+ * @brief Getter
+ */
+gboolean rmg_jentry_get_critical (RmgJEntry *jentry);
+
 /**
  * @brief Getter
  */
@@ -26,6 +26,8 @@
 #include "rmg-jentry.h"
 #include "rmg-utils.h"
 
+#include <string.h>
+
 /**
  * @enum Journal query type
  */
@@ -37,6 +39,7 @@ typedef enum _JournalQueryType
   QUERY_REMOVE_SERVICE,
   QUERY_ADD_ACTION,
   QUERY_ADD_FRIEND,
+  QUERY_ADD_PROBE,
   QUERY_GET_PRIVATE_DATA,
   QUERY_GET_PUBLIC_DATA,
   QUERY_GET_TIMEOUT,
@@ -45,9 +48,11 @@ typedef enum _JournalQueryType
   QUERY_SET_RVECTOR,
   QUERY_GET_ACTION,
   QUERY_GET_ACTION_RESET_AFTER,
+  QUERY_GET_ACTION_SKIP,
   QUERY_GET_SERVICES_FOR_FRIEND,
   QUERY_CALL_RELAXING,
-  QUERY_CALL_CHECK_START,
+  QUERY_GET_SERVICE_NAMES,
+  QUERY_GET_PROBES,
 } JournalQueryType;
 
 /**
@@ -61,6 +66,15 @@ typedef struct _JournalQueryData
   RmgJournalCallback callback;
 } JournalQueryData;
 
+/**
+ * @struct Action skip query response
+ */
+typedef struct _JournalActionSkip
+{
+  guint skip_mask;
+  glong trigger_level_max;
+} JournalActionSkip;
+
 /**
  * @struct Add action object helper
  */
@@ -79,9 +93,19 @@ typedef struct _JournalAddFriend
   RmgJEntry *service;
 } JournalAddFriend;
 
+/**
+ * @struct Add probe object helper
+ */
+typedef struct _JournalAddProbe
+{
+  RmgJournal *journal;
+  RmgJEntry *service;
+} JournalAddProbe;
+
 const gchar *rmg_table_services = "Services";
 const gchar *rmg_table_actions = "Actions";
 const gchar *rmg_table_friends = "Friends";
+const gchar *rmg_table_probes = "Probes";
 
 /**
  * @brief SQlite3 callback
@@ -136,6 +160,9 @@ sqlite_callback (void *data, int argc, char **argv, char **colname)
     case QUERY_ADD_FRIEND:
       break;
 
+    case QUERY_ADD_PROBE:
+      break;
+
     case QUERY_GET_PRIVATE_DATA:
       for (gint i = 0; i < argc; i++)
         {
@@ -198,6 +225,18 @@ sqlite_callback (void *data, int argc, char **argv, char **colname)
         }
       break;
 
+    case QUERY_GET_ACTION_SKIP:
+      for (gint i = 0; i < argc; i++)
+        {
+          JournalActionSkip *skip = (JournalActionSkip *)(querydata->response);
+
+          if (g_strcmp0 (colname[i], "SKIP") == 0)
+            skip->skip_mask = (guint)g_ascii_strtoull (argv[i], NULL, 10);
+          else if (g_strcmp0 (colname[i], "TLMAX") == 0)
+            skip->trigger_level_max = (glong)g_ascii_strtoll (argv[i], NULL, 10);
+        }
+      break;
+
     case QUERY_GET_SERVICES_FOR_FRIEND:
       {
         RmgFriendResponseEntry *friend_response = g_new0 (RmgFriendResponseEntry, 1);
@@ -206,7 +245,7 @@ sqlite_callback (void *data, int argc, char **argv, char **colname)
         for (gint i = 0; i < argc; i++)
           {
             if (g_strcmp0 (colname[i], "SERVICE") == 0)
-              friend_response->service_name = g_strdup (argv[i]);
+              friend_response->service_name = g_ref_string_new_intern (argv[i]);
             else if (g_strcmp0 (colname[i], "ACTION") == 0)
               friend_response->action = (RmgFriendActionType)g_ascii_strtoll (argv[i], NULL, 10);
             else if (g_strcmp0 (colname[i], "ARGUMENT") == 0)
@@ -219,8 +258,7 @@ sqlite_callback (void *data, int argc, char **argv, char **colname)
       }
       break;
 
-    case QUERY_CALL_RELAXING: /* fallthrough */
-    case QUERY_CALL_CHECK_START:
+    case QUERY_CALL_RELAXING:
       for (gint i = 0; i < argc; i++)
         {
           if (g_strcmp0 (colname[i], "NAME") == 0)
@@ -231,6 +269,42 @@ sqlite_callback (void *data, int argc, char **argv, char **colname)
         }
       break;
 
+    case QUERY_GET_SERVICE_NAMES:
+      for (gint i = 0; i < argc; i++)
+        {
+          if (g_strcmp0 (colname[i], "NAME") == 0)
+            {
+              GList **names = (GList **)(querydata->response);
+              *names = g_list_prepend (*names, g_ref_string_new_intern (argv[i]));
+            }
+        }
+      break;
+
+    case QUERY_GET_PROBES:
+      {
+        RmgProbeResponseEntry *probe = g_new0 (RmgProbeResponseEntry, 1);
+        GList **probes = (GList **)(querydata->response);
+
+        for (gint i = 0; i < argc; i++)
+          {
+            if (g_strcmp0 (colname[i], "SERVICE") == 0)
+              probe->service_name = g_ref_string_new_intern (argv[i]);
+            else if (g_strcmp0 (colname[i], "TYPE") == 0)
+              probe->type = (RmgProbeType)g_ascii_strtoll (argv[i], NULL, 10);
+            else if (g_strcmp0 (colname[i], "TARGET") == 0)
+              probe->target = g_strdup (argv[i]);
+            else if (g_strcmp0 (colname[i], "INTERVAL") == 0)
+              probe->interval = (glong)g_ascii_strtoll (argv[i], NULL, 10);
+            else if (g_strcmp0 (colname[i], "TIMEOUT") == 0)
+              probe->timeout = (glong)g_ascii_strtoll (argv[i], NULL, 10);
+            else if (g_strcmp0 (colname[i], "THRESHOLD") == 0)
+              probe->threshold = (glong)g_ascii_strtoll (argv[i], NULL, 10);
+          }
+
+        *probes = g_list_prepend (*probes, probe);
+      }
+      break;
+
     default:
       break;
     }
@@ -238,6 +312,26 @@ sqlite_callback (void *data, int argc, char **argv, char **colname)
   return (0);
 }
 
+static void
+journal_add_column (RmgJournal *journal, const gchar *table, const gchar *column,
+                    const gchar *definition)
+{
+  g_autofree gchar *sql = NULL;
+  gchar *query_error = NULL;
+
+  sql = g_strdup_printf ("ALTER TABLE %s ADD COLUMN %s %s;", table, column, definition);
+
+  if (sqlite3_exec (journal->database, sql, NULL, NULL, &query_error) != SQLITE_OK)
+    {
+      if (query_error == NULL || strstr (query_error, "duplicate column") == NULL)
+        g_warning ("Fail to add column %s to table %s. SQL error %s", column, table, query_error);
+
+      sqlite3_free (query_error);
+    }
+  else
+    g_info ("Journal table %s migrated with column %s", table, column);
+}
+
 RmgJournal *
 rmg_journal_new (RmgOptions *options, GError **error)
 {
@@ -275,7 +369,8 @@ rmg_journal_new (RmgOptions *options, GError **error)
                                       " PUBLDATA  TEXT            NOT NULL, "
                                       " RVECTOR   NUMERIC         NOT NULL, "
                                       " CHKSTART  NUMERIC         NOT NULL, "
-                                      " TIMEOUT   NUMERIC         NOT NULL);",
+                                      " TIMEOUT   NUMERIC         NOT NULL, "
+                                      " CRITICAL  NUMERIC         NOT NULL DEFAULT 0);",
                                       rmg_table_services);
 
       if (sqlite3_exec (journal->database, services_sql, sqlite_callback, &data, &query_error)
@@ -289,6 +384,11 @@ rmg_journal_new (RmgOptions *options, GError **error)
         {
           g_autofree gchar *actions_sql = NULL;
           g_autofree gchar *friends_sql = NULL;
+          g_autofree gchar *probes_sql = NULL;
+
+          /* databases created by older versions miss the newer columns */
+          journal_add_column (journal, rmg_table_services, "CRITICAL",
+                              "NUMERIC NOT NULL DEFAULT 0");
 
           actions_sql = g_strdup_printf ("CREATE TABLE IF NOT EXISTS %s        "
                                          "(HASH     UNSIGNED INTEGER PRIMARY KEY NOT NULL, "
@@ -296,7 +396,8 @@ rmg_journal_new (RmgOptions *options, GError **error)
                                          " TYPE     NUMERIC    NOT   NULL, "
                                          " TLMIN    NUMERIC    NOT   NULL, "
                                          " TLMAX    NUMERIC    NOT   NULL, "
-                                         " RESET    NUMERIC    NOT   NULL);",
+                                         " RESET    NUMERIC    NOT   NULL, "
+                                         " SKIP     NUMERIC    NOT   NULL DEFAULT 0);",
                                          rmg_table_actions);
 
           if (sqlite3_exec (journal->database, actions_sql, sqlite_callback, &data, &query_error)
@@ -306,6 +407,8 @@ rmg_journal_new (RmgOptions *options, GError **error)
               g_set_error (error, g_quark_from_static_string ("JournalNew"), 1,
                            "Create actions table fail");
             }
+          else
+            journal_add_column (journal, rmg_table_actions, "SKIP", "NUMERIC NOT NULL DEFAULT 0");
 
           friends_sql = g_strdup_printf ("CREATE TABLE IF NOT EXISTS %s        "
                                          "(HASH     UNSIGNED INTEGER PRIMARY KEY NOT NULL, "
@@ -325,6 +428,24 @@ rmg_journal_new (RmgOptions *options, GError **error)
               g_set_error (error, g_quark_from_static_string ("JournalNew"), 1,
                            "Create friends table fail");
             }
+
+          probes_sql = g_strdup_printf ("CREATE TABLE IF NOT EXISTS %s        "
+                                        "(HASH      UNSIGNED INTEGER PRIMARY KEY NOT NULL, "
+                                        " SERVICE   TEXT       NOT   NULL, "
+                                        " TYPE      NUMERIC    NOT   NULL, "
+                                        " TARGET    TEXT       NOT   NULL, "
+                                        " INTERVAL  NUMERIC    NOT   NULL, "
+                                        " TIMEOUT   NUMERIC    NOT   NULL, "
+                                        " THRESHOLD NUMERIC    NOT   NULL);",
+                                        rmg_table_probes);
+
+          if (sqlite3_exec (journal->database, probes_sql, sqlite_callback, &data, &query_error)
+              != SQLITE_OK)
+            {
+              g_warning ("Fail to create probes table. SQL error %s", query_error);
+              g_set_error (error, g_quark_from_static_string ("JournalNew"), 1,
+                           "Create probes table fail");
+            }
         }
     }
 
@@ -369,6 +490,7 @@ parser_start_element (GMarkupParseContext *context, const gchar *element_name,
     {
       RmgActionType action_type = ACTION_INVALID;
       gboolean reset_after = FALSE;
+      guint skip_mask = 0;
       glong retry = 1;
 
       for (gint i = 0; attribute_names[i] != NULL; i++)
@@ -388,6 +510,10 @@ parser_start_element (GMarkupParseContext *context, const gchar *element_name,
               if (g_strcmp0 (attribute_values[i], "true") == 0)
                 reset_after = TRUE;
             }
+          else if (g_strcmp0 (attribute_names[i], "skip") == 0)
+            {
+              skip_mask = rmg_utils_failure_mask_from (attribute_values[i]);
+            }
         }
 
       if (retry < 1 || action_type == ACTION_INVALID)
@@ -397,7 +523,7 @@ parser_start_element (GMarkupParseContext *context, const gchar *element_name,
           glong g = rmg_jentry_get_rvector (entry) + retry;
 
           rmg_jentry_add_action (entry, action_type, rmg_jentry_get_rvector (entry), g,
-                                 reset_after);
+                                 reset_after, skip_mask);
           rmg_jentry_set_rvector (entry, g);
         }
     }
@@ -436,6 +562,39 @@ parser_start_element (GMarkupParseContext *context, const gchar *element_name,
             }
         }
     }
+  else if (g_strcmp0 (element_name, "probe") == 0)
+    {
+      RmgPEntryParserHelper *probe = &entry->parser_current_probe;
+
+      probe->type = PROBE_INVALID;
+      probe->interval = RMG_PROBE_DEFAULT_INTERVAL;
+      probe->timeout = RMG_PROBE_DEFAULT_TIMEOUT;
+      probe->threshold = RMG_PROBE_DEFAULT_THRESHOLD;
+
+      for (gint i = 0; attribute_names[i] != NULL; i++)
+        {
+          if (g_strcmp0 (attribute_names[i], "type") == 0)
+            {
+              if (attribute_values[i] != NULL)
+                probe->type = rmg_utils_probe_type_from (attribute_values[i]);
+            }
+          else if (g_strcmp0 (attribute_names[i], "interval") == 0)
+            {
+              if (attribute_values[i] != NULL)
+                probe->interval = (glong)g_ascii_strtoll (attribute_values[i], NULL, 10);
+            }
+          else if (g_strcmp0 (attribute_names[i], "timeout") == 0)
+            {
+              if (attribute_values[i] != NULL)
+                probe->timeout = (glong)g_ascii_strtoll (attribute_values[i], NULL, 10);
+            }
+          else if (g_strcmp0 (attribute_names[i], "failures") == 0)
+            {
+              if (attribute_values[i] != NULL)
+                probe->threshold = (glong)g_ascii_strtoll (attribute_values[i], NULL, 10);
+            }
+        }
+    }
   else if (g_strcmp0 (element_name, "service") == 0)
     {
       for (gint i = 0; attribute_names[i] != NULL; i++)
@@ -454,6 +613,10 @@ parser_start_element (GMarkupParseContext *context, const gchar *element_name,
 
               rmg_jentry_set_checkstart (entry, check_start);
             }
+          else if (g_strcmp0 (attribute_names[i], "critical") == 0)
+            {
+              rmg_jentry_set_critical (entry, g_strcmp0 (attribute_values[i], "true") == 0);
+            }
         }
     }
 }
@@ -489,6 +652,21 @@ parser_text_data (GMarkupParseContext *context, const gchar *text, gsize text_le
 
       g_free (entry->parser_current_friend.friend_context);
     }
+  else if (g_strcmp0 (entry->parser_current_element, "probe") == 0)
+    {
+      RmgPEntryParserHelper *probe = &entry->parser_current_probe;
+
+      /* whitespace after the probe element is still reported for it */
+      if (*g_strstrip (buffer) == '\0')
+        return;
+
+      if (probe->type == PROBE_INVALID || probe->type == PROBE_UNKNOWN || probe->interval < 1
+          || probe->timeout < 1 || probe->threshold < 1)
+        g_warning ("Invalid probe settings for target '%s'", buffer);
+      else
+        rmg_jentry_add_probe (entry, probe->type, buffer, probe->interval, probe->timeout,
+                              probe->threshold);
+    }
 }
 
 static void
@@ -504,7 +682,7 @@ add_action_for_service (gpointer _action, gpointer _helper)
 
   if (rmg_journal_add_action (helper->journal, action->hash, helper->service->name, action->type,
                               action->trigger_level_min, action->trigger_level_max,
-                              action->reset_after, &error)
+                              action->reset_after, action->skip_mask, &error)
       != RMG_STATUS_OK)
     {
       g_warning ("Fail to add action type %u for service %s. Error %s", action->type,
@@ -533,6 +711,27 @@ add_friend_for_service (gpointer _friend, gpointer _helper)
     }
 }
 
+static void
+add_probe_for_service (gpointer _probe, gpointer _helper)
+{
+  RmgPEntry *probe = (RmgPEntry *)_probe;
+  JournalAddProbe *helper = (JournalAddProbe *)_helper;
+
+  g_autoptr (GError) error = NULL;
+
+  g_info ("Adding probe='%s' target='%s' for service='%s'", rmg_utils_probe_name (probe->type),
+          probe->target, helper->service->name);
+
+  if (rmg_journal_add_probe (helper->journal, probe->hash, helper->service->name, probe->type,
+                             probe->target, probe->interval, probe->timeout, probe->threshold,
+                             &error)
+      != RMG_STATUS_OK)
+    {
+      g_warning ("Fail to add probe %s for service %s. Error %s", probe->target,
+                 helper->service->name, error->message);
+    }
+}
+
 RmgStatus
 rmg_journal_reload_units (RmgJournal *journal, GError **error)
 {
@@ -592,15 +791,18 @@ rmg_journal_reload_units (RmgJournal *journal, GError **error)
           g_info ("Adding service='%s' as new entry in database", jentry->name);
 
           if (rmg_journal_add_service (journal, hash, jentry->name, jentry->private_data,
-                                       jentry->public_data, jentry->check_start, jentry->timeout,
+                                       jentry->public_data, jentry->check_start, jentry->critical,
+                                       jentry->timeout,
                                        &element_error)
               == RMG_STATUS_OK)
             {
               JournalAddAction add_action_helper = { .journal = journal, .service = jentry };
               JournalAddFriend add_friend_helper = { .journal = journal, .service = jentry };
+              JournalAddProbe add_probe_helper = { .journal = journal, .service = jentry };
 
               g_list_foreach (jentry->actions, add_action_for_service, &add_action_helper);
               g_list_foreach (jentry->friends, add_friend_for_service, &add_friend_helper);
+              g_list_foreach (jentry->probes, add_probe_for_service, &add_probe_helper);
             }
           else
             {
@@ -618,7 +820,7 @@ rmg_journal_reload_units (RmgJournal *journal, GError **error)
 RmgStatus
 rmg_journal_add_service (RmgJournal *journal, gulong hash, const gchar *service_name,
                          const gchar *private_data, const gchar *public_data, gboolean check_start,
-                         glong timeout, GError **error)
+                         gboolean critical, glong timeout, GError **error)
 {
   g_autofree gchar *sql = NULL;
   gchar *query_error = NULL;
@@ -632,10 +834,10 @@ rmg_journal_add_service (RmgJournal *journal, gulong hash, const gchar *service_
   g_assert (public_data);
 
   sql = g_strdup_printf ("INSERT INTO %s                                 "
-                         "(HASH,NAME,PRIVDATA,PUBLDATA,RVECTOR,CHKSTART,TIMEOUT)  "
-                         "VALUES(%ld, '%s', '%s', '%s', %ld, %ld, %ld);       ",
+                         "(HASH,NAME,PRIVDATA,PUBLDATA,RVECTOR,CHKSTART,TIMEOUT,CRITICAL)  "
+                         "VALUES(%ld, '%s', '%s', '%s', %ld, %ld, %ld, %ld);       ",
                          rmg_table_services, (glong)hash, service_name, private_data, public_data,
-                         (glong)0, (glong)check_start, timeout);
+                         (glong)0, (glong)check_start, timeout, (glong)critical);
 
   if (sqlite3_exec (journal->database, sql, sqlite_callback, &data, &query_error) != SQLITE_OK)
     {
@@ -652,7 +854,7 @@ rmg_journal_add_service (RmgJournal *journal, gulong hash, const gchar *service_
 RmgStatus
 rmg_journal_add_action (RmgJournal *journal, gulong hash, const gchar *service_name,
                         RmgActionType action_type, glong trigger_level_min, glong trigger_level_max,
-                        gboolean reset_after, GError **error)
+                        gboolean reset_after, guint skip_mask, GError **error)
 {
   g_autofree gchar *sql = NULL;
   gchar *query_error = NULL;
@@ -664,10 +866,10 @@ rmg_journal_add_action (RmgJournal *journal, gulong hash, const gchar *service_n
   g_assert (service_name);
 
   sql = g_strdup_printf ("INSERT INTO %s                    "
-                         "(HASH,SERVICE,TYPE,TLMIN,TLMAX,RESET)   "
-                         "VALUES(%ld, '%s', %u, %ld, %ld, %d); ",
+                         "(HASH,SERVICE,TYPE,TLMIN,TLMAX,RESET,SKIP)   "
+                         "VALUES(%ld, '%s', %u, %ld, %ld, %d, %u); ",
                          rmg_table_actions, (glong)hash, service_name, action_type,
-                         trigger_level_min, trigger_level_max, reset_after);
+                         trigger_level_min, trigger_level_max, reset_after, skip_mask);
 
   if (sqlite3_exec (journal->database, sql, sqlite_callback, &data, &query_error) != SQLITE_OK)
     {
@@ -716,6 +918,43 @@ rmg_journal_add_friend (RmgJournal *journal, gulong hash, const gchar *service_n
   return RMG_STATUS_OK;
 }
 
+RmgStatus
+rmg_journal_add_probe (RmgJournal *journal, gulong hash, const gchar *service_name,
+                       RmgProbeType probe_type, const gchar *target, glong interval,
+                       glong timeout, glong threshold, GError **error)
+{
+  RmgStatus status = RMG_STATUS_OK;
+  gchar *query_error = NULL;
+  gchar *sql = NULL;
+
+  JournalQueryData data
+      = { .type = QUERY_ADD_PROBE, .journal = journal, .callback = NULL, .response = NULL };
+
+  g_assert (journal);
+  g_assert (service_name);
+  g_assert (target);
+
+  /* exec probe targets are command lines so the strings are quoted by sqlite */
+  sql = sqlite3_mprintf ("INSERT INTO %s                    "
+                         "(HASH,SERVICE,TYPE,TARGET,INTERVAL,TIMEOUT,THRESHOLD)   "
+                         "VALUES(%ld, %Q, %u, %Q, %ld, %ld, %ld); ",
+                         rmg_table_probes, (glong)hash, service_name, probe_type, target,
+                         interval, timeout, threshold);
+
+  if (sqlite3_exec (journal->database, sql, sqlite_callback, &data, &query_error) != SQLITE_OK)
+    {
+      g_set_error (error, g_quark_from_static_string ("JournalAddProbe"), 1, "SQL query error");
+      g_warning ("Fail to add new probe entry. SQL error %s", query_error);
+      sqlite3_free (query_error);
+
+      status = RMG_STATUS_ERROR;
+    }
+
+  sqlite3_free (sql);
+
+  return status;
+}
+
 gchar *
 rmg_journal_get_private_data_path (RmgJournal *journal, const gchar *service_name, GError **error)
 {
@@ -847,28 +1086,59 @@ rmg_journal_call_foreach_relaxing (RmgJournal *journal, RmgJournalCallback callb
     }
 }
 
-void
-rmg_journal_call_foreach_checkstart (RmgJournal *journal, RmgJournalCallback callback,
-                                     GError **error)
+static GList *
+journal_get_names (RmgJournal *journal, const gchar *sql, GError **error)
 {
-  g_autofree gchar *sql = NULL;
   gchar *query_error = NULL;
+  GList *names = NULL;
 
   JournalQueryData data = {
-    .type = QUERY_CALL_CHECK_START, .journal = journal, .callback = callback, .response = NULL
+    .type = QUERY_GET_SERVICE_NAMES, .journal = journal, .callback = NULL, .response = NULL
   };
 
   g_assert (journal);
 
-  sql = g_strdup_printf ("SELECT NAME FROM %s WHERE CHKSTART > 0", rmg_table_services);
+  data.response = (gpointer)&names;
 
   if (sqlite3_exec (journal->database, sql, sqlite_callback, &data, &query_error) != SQLITE_OK)
     {
-      g_set_error (error, g_quark_from_static_string ("JournalCallCheckStart"), 1,
+      g_set_error (error, g_quark_from_static_string ("JournalGetServiceNames"), 1,
                    "SQL query error");
-      g_warning ("Fail to get call check start. SQL error %s", query_error);
+      g_warning ("Fail to get service names. SQL error %s", query_error);
       sqlite3_free (query_error);
     }
+
+  return names;
+}
+
+GList *
+rmg_journal_get_service_names (RmgJournal *journal, GError **error)
+{
+  g_autofree gchar *sql = NULL;
+
+  sql = g_strdup_printf ("SELECT NAME FROM %s", rmg_table_services);
+
+  return journal_get_names (journal, sql, error);
+}
+
+GList *
+rmg_journal_get_critical_service_names (RmgJournal *journal, GError **error)
+{
+  g_autofree gchar *sql = NULL;
+
+  sql = g_strdup_printf ("SELECT NAME FROM %s WHERE CRITICAL > 0", rmg_table_services);
+
+  return journal_get_names (journal, sql, error);
+}
+
+GList *
+rmg_journal_get_checkstart_service_names (RmgJournal *journal, GError **error)
+{
+  g_autofree gchar *sql = NULL;
+
+  sql = g_strdup_printf ("SELECT NAME FROM %s WHERE CHKSTART > 0", rmg_table_services);
+
+  return journal_get_names (journal, sql, error);
 }
 
 glong
@@ -994,6 +1264,42 @@ rmg_journal_get_service_action_reset_after (RmgJournal *journal, const gchar *se
   return reset_after;
 }
 
+guint
+rmg_journal_get_service_action_skip (RmgJournal *journal, const gchar *service_name,
+                                     glong *trigger_level_max, GError **error)
+{
+  g_autofree gchar *sql = NULL;
+  gchar *query_error = NULL;
+  JournalActionSkip skip = { .skip_mask = 0, .trigger_level_max = 0 };
+  glong rvector = 0;
+
+  JournalQueryData data
+      = { .type = QUERY_GET_ACTION_SKIP, .journal = journal, .callback = NULL, .response = NULL };
+
+  g_assert (journal);
+  g_assert (service_name);
+  g_assert (trigger_level_max);
+
+  rvector = rmg_journal_get_rvector (journal, service_name, error);
+  data.response = (gpointer)&skip;
+
+  sql = g_strdup_printf ("SELECT SKIP, TLMAX FROM %s WHERE SERVICE IS '%s' "
+                         "AND %ld BETWEEN TLMIN AND TLMAX",
+                         rmg_table_actions, service_name, rvector);
+
+  if (sqlite3_exec (journal->database, sql, sqlite_callback, &data, &query_error) != SQLITE_OK)
+    {
+      g_set_error (error, g_quark_from_static_string ("JournalGetServiceActionSkip"), 1,
+                   "SQL query error");
+      g_warning ("Fail to get service action skip. SQL error %s", query_error);
+      sqlite3_free (query_error);
+    }
+
+  *trigger_level_max = skip.trigger_level_max;
+
+  return skip.skip_mask;
+}
+
 GList *
 rmg_journal_get_services_for_friend (RmgJournal *journal, const gchar *friend_name,
                                      const gchar *friend_context, RmgFriendType friend_type,
@@ -1028,6 +1334,32 @@ rmg_journal_get_services_for_friend (RmgJournal *journal, const gchar *friend_na
   return services;
 }
 
+GList *
+rmg_journal_get_probes (RmgJournal *journal, GError **error)
+{
+  g_autofree gchar *sql = NULL;
+  gchar *query_error = NULL;
+  GList *probes = NULL;
+
+  JournalQueryData data
+      = { .type = QUERY_GET_PROBES, .journal = journal, .callback = NULL, .response = NULL };
+
+  g_assert (journal);
+
+  data.response = (gpointer)&probes;
+
+  sql = g_strdup_printf ("SELECT * FROM %s", rmg_table_probes);
+
+  if (sqlite3_exec (journal->database, sql, sqlite_callback, &data, &query_error) != SQLITE_OK)
+    {
+      g_set_error (error, g_quark_from_static_string ("JournalGetProbes"), 1, "SQL query error");
+      g_warning ("Fail to get probes. SQL error %s", query_error);
+      sqlite3_free (query_error);
+    }
+
+  return probes;
+}
+
 RmgStatus
 rmg_journal_remove_service (RmgJournal *journal, const gchar *service_name, GError **error)
 {
@@ -1057,6 +1389,7 @@ rmg_journal_remove_service (RmgJournal *journal, const gchar *service_name, GErr
     {
       g_autofree gchar *actions_sql = NULL;
       g_autofree gchar *friends_sql = NULL;
+      g_autofree gchar *probes_sql = NULL;
 
       actions_sql = g_strdup_printf ("DELETE FROM %s WHERE SERVICE IS '%s'", rmg_table_actions,
                                      service_name);
@@ -1083,6 +1416,19 @@ rmg_journal_remove_service (RmgJournal *journal, const gchar *service_name, GErr
           sqlite3_free (query_error);
           status = RMG_STATUS_ERROR;
         }
+
+      probes_sql = g_strdup_printf ("DELETE FROM %s WHERE SERVICE IS '%s'", rmg_table_probes,
+                                    service_name);
+
+      if (sqlite3_exec (journal->database, probes_sql, sqlite_callback, &data, &query_error)
+          != SQLITE_OK)
+        {
+          g_set_error (error, g_quark_from_static_string ("JournalRemoveService"), 1,
+                       "SQL query error");
+          g_warning ("Fail to remove probes. SQL error %s", query_error);
+          sqlite3_free (query_error);
+          status = RMG_STATUS_ERROR;
+        }
     }
 
   return status;
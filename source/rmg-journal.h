@@ -90,13 +90,16 @@ gulong rmg_journal_get_hash (RmgJournal *journal, const gchar *service_name, GEr
  * @param service_name The service name to lookup
  * @param private_data Private data directory path
  * @param public_data Public data directory path
+ * @param check_start Check if service is started at boot
+ * @param critical Service main process is watched directly
  * @param timeput Relaxation timeout
  * @param error The GError object or NULL
  * @return On success return RMG_STATUS_OK
  */
 RmgStatus rmg_journal_add_service (RmgJournal *journal, gulong hash, const gchar *service_name,
                                    const gchar *private_data, const gchar *public_data,
-                                   gboolean check_start, glong timeout, GError **error);
+                                   gboolean check_start, gboolean critical, glong timeout,
+                                   GError **error);
 /**
  * @brief Add new action entry in database
  * @param journal Pointer to the journal object
@@ -104,12 +107,14 @@ RmgStatus rmg_journal_add_service (RmgJournal *journal, gulong hash, const gchar
  * @param service_name The service name to lookup
  * @param trigger_level_min The rvector min trigger level
  * @param trigger_level_max The rvector max trigger level
+ * @param skip_mask The failure reasons mask for which the action is skipped
  * @param error The GError object or NULL
  * @return On success return RMG_STATUS_OK
  */
 RmgStatus rmg_journal_add_action (RmgJournal *journal, gulong hash, const gchar *service_name,
                                   RmgActionType action_type, glong trigger_level_min,
-                                  glong trigger_level_max, gboolean reset_after, GError **error);
+                                  glong trigger_level_max, gboolean reset_after, guint skip_mask,
+                                  GError **error);
 
 /**
  * @brief Add new friend entry in database
@@ -129,6 +134,23 @@ RmgStatus rmg_journal_add_friend (RmgJournal *journal, gulong hash, const gchar
                                   const gchar *friend_name, const gchar *friend_context,
                                   RmgFriendType friend_type, RmgFriendActionType friend_action,
                                   glong friend_argument, glong friend_delay, GError **error);
+
+/**
+ * @brief Add new probe entry in database
+ * @param journal Pointer to the journal object
+ * @param hash The probe hash
+ * @param service_name The service name
+ * @param probe_type The probe type
+ * @param target The probe target
+ * @param interval The probe interval in seconds
+ * @param timeout The probe timeout in seconds
+ * @param threshold Consecutive failures before the service is declared crashed
+ * @param error The GError object or NULL
+ * @return On success return RMG_STATUS_OK
+ */
+RmgStatus rmg_journal_add_probe (RmgJournal *journal, gulong hash, const gchar *service_name,
+                                 RmgProbeType probe_type, const gchar *target, glong interval,
+                                 glong timeout, glong threshold, GError **error);
 /**
  * @brief Get check start value
  * @param journal Pointer to the journal object
@@ -174,13 +196,26 @@ glong rmg_journal_get_relaxing_timeout (RmgJournal *journal, const gchar *servic
 void rmg_journal_call_foreach_relaxing (RmgJournal *journal, RmgJournalCallback callback,
                                         GError **error);
 /**
- * @brief Call funtion for each service with check start flag set
+ * @brief Get the names of all services with a recovery unit
  * @param journal Pointer to the journal object
- * @param callback GSourceFunc callback
  * @param error The GError object or NULL
+ * @return A list of service name atoms released with g_ref_string_release
  */
-void rmg_journal_call_foreach_checkstart (RmgJournal *journal, RmgJournalCallback callback,
-                                          GError **error);
+GList *rmg_journal_get_service_names (RmgJournal *journal, GError **error);
+/**
+ * @brief Get the names of all services marked critical
+ * @param journal Pointer to the journal object
+ * @param error The GError object or NULL
+ * @return A list of service name atoms released with g_ref_string_release
+ */
+GList *rmg_journal_get_critical_service_names (RmgJournal *journal, GError **error);
+/**
+ * @brief Get the names of all services with check start flag set
+ * @param journal Pointer to the journal object
+ * @param error The GError object or NULL
+ * @return A list of service name atoms released with g_ref_string_release
+ */
+GList *rmg_journal_get_checkstart_service_names (RmgJournal *journal, GError **error);
 /**
  * @brief Get rvector value
  * @param journal Pointer to the journal object
@@ -218,6 +253,17 @@ RmgActionType rmg_journal_get_service_action (RmgJournal *journal, const gchar *
 gboolean rmg_journal_get_service_action_reset_after (RmgJournal *journal, const gchar *service_name,
                                                      GError **error);
 
+/**
+ * @brief Get the failure reasons skip mask for current action for service
+ * @param journal Pointer to the journal object
+ * @param service_name The service name to lookup
+ * @param trigger_level_max Set to the rvector max trigger level of the current action
+ * @param error The GError object or NULL
+ * @return The failure reasons mask for which the current action is skipped
+ */
+guint rmg_journal_get_service_action_skip (RmgJournal *journal, const gchar *service_name,
+                                           glong *trigger_level_max, GError **error);
+
 /**
  * @brief Get services for friend
  * @param journal Pointer to the journal object
@@ -230,6 +276,15 @@ gboolean rmg_journal_get_service_action_reset_after (RmgJournal *journal, const
 GList *rmg_journal_get_services_for_friend (RmgJournal *journal, const gchar *friend_name,
                                             const gchar *friend_context, RmgFriendType friend_type,
                                             GError **error);
+
+/**
+ * @brief Get all probes
+ * @param journal Pointer to the journal object
+ * @param error The GError object or NULL
+ * @return A GList with new allocated structures RmgProbeResponseEntry
+ */
+GList *rmg_journal_get_probes (RmgJournal *journal, GError **error);
+
 /**
  * @brief Remove service
  *
@@ -23,129 +23,393 @@
 
 #include "rmg-mentry.h"
 #include "rmg-dispatcher.h"
+#include "rmg-utils.h"
+
+#include <signal.h>
+#include <string.h>
+
+const gchar *active_state_names[]
+    = { "unknown",    "active",       "reloading",   "inactive",   "failed",
+        "activating", "deactivating", "maintenance", "refreshing", NULL };
+
+const gchar *active_substate_names[] = { "unknown",
+                                         "running",
+                                         "dead",
+                                         "stop-sigterm",
+                                         "condition",
+                                         "start-pre",
+                                         "start",
+                                         "start-post",
+                                         "exited",
+                                         "reload",
+                                         "reload-signal",
+                                         "reload-notify",
+                                         "stop",
+                                         "stop-watchdog",
+                                         "stop-sigkill",
+                                         "stop-post",
+                                         "final-watchdog",
+                                         "final-sigterm",
+                                         "final-sigkill",
+                                         "failed",
+                                         "dead-before-auto-restart",
+                                         "failed-before-auto-restart",
+                                         "dead-resources-pinned",
+                                         "auto-restart",
+                                         "auto-restart-queued",
+                                         "cleaning",
+                                         NULL };
+
+/* escalation causes carried by the next crash event */
+static const gchar escalate_flapping[] = "flapping";
+static const gchar escalate_failed_restart[] = "failed restart";
 
-const gchar *active_state_names[] = { "unknown", "active",     "reloading",    "inactive",
-                                      "failed",  "activating", "deactivating", NULL };
+/*
+ * The state names are mapped with a perfect hash over the first and last character and
+ * the name length. Each slot holds the enum value of the only name hashing there (0 for
+ * none) and a single string compare confirms the match. The tables must be regenerated
+ * if a name is added.
+ */
+#define ACTIVE_STATE_SLOTS (9)
+#define ACTIVE_SUBSTATE_SLOTS (40)
+
+static const guint8 active_state_slots[ACTIVE_STATE_SLOTS] = { 1, 2, 3, 0, 4, 6, 7, 8, 5 };
+
+static const guint8 active_substate_slots[ACTIVE_SUBSTATE_SLOTS]
+    = { 0,  0, 16, 5,  2, 24, 21, 0, 0, 14, 0, 0, 10, 3, 0, 0,  18, 12, 9, 8,
+        17, 0, 19, 15, 11, 0, 22, 23, 20, 7, 0, 4, 0,  0, 0, 13, 1,  25, 0, 6 };
+
+static inline guint
+active_state_hash (const gchar *name, gsize len)
+{
+  return ((guint)(guchar)name[0] + (guint)(guchar)name[len - 1] + 6 * (guint)len)
+         % ACTIVE_STATE_SLOTS;
+}
 
-const gchar *active_substate_names[]
-    = { "unknown", "running", "dead", "inactive", "stop-sigterm", NULL };
+static inline guint
+active_substate_hash (const gchar *name, gsize len)
+{
+  return (3 * (guint)(guchar)name[0] + 4 * (guint)(guchar)name[len - 1] + 6 * (guint)len)
+         % ACTIVE_SUBSTATE_SLOTS;
+}
 
-extern const gchar *sd_dbus_name;
-extern const gchar *sd_dbus_object_path;
-extern const gchar *sd_dbus_interface_unit;
-extern const gchar *sd_dbus_interface_manager;
+static RmgFailureReason
+failure_reason (RmgMEntry *mentry)
+{
+  RmgFailureReason reason = mentry->result;
+
+  /* a Result systemd did not map is completed from the main process exit */
+  if (reason == FAILURE_UNKNOWN)
+    {
+      if (mentry->exec_main_code == CLD_KILLED)
+        reason = FAILURE_SIGNAL;
+      else if (mentry->exec_main_code == CLD_DUMPED)
+        reason = FAILURE_CORE_DUMP;
+      else if (mentry->exec_main_code == CLD_EXITED && mentry->exec_main_status != 0)
+        reason = FAILURE_EXIT_CODE;
+    }
+
+  if (reason == FAILURE_SIGNAL && mentry->exec_main_status == SIGKILL)
+    reason = FAILURE_SIGKILL;
+
+  return reason;
+}
 
 static void
-on_properties_changed (GDBusProxy *proxy, GVariant *changed_properties,
-                       const gchar *const *invalidated_properties, gpointer user_data)
+dispatch_service_event (RmgMEntry *mentry, DispatcherEventType type, glong weight)
 {
-  RmgMEntry *mentry = (RmgMEntry *)user_data;
+  RmgDEvent *event = rmg_devent_new (type);
+
+  rmg_devent_set_service_name (event, mentry->service_name);
+  rmg_devent_set_object_path (event, mentry->object_path);
+  rmg_devent_set_manager_proxy (event, mentry->manager_proxy);
+  rmg_devent_set_weight (event, weight);
+
+  if (type == DEVENT_SERVICE_CRASHED)
+    {
+      rmg_devent_set_failure (event, failure_reason (mentry), mentry->exec_main_code,
+                              mentry->exec_main_status);
+
+      /* the first crash event after the threshold or a failed restart escalates the action */
+      rmg_devent_set_escalate (event, mentry->escalate);
+      mentry->escalate = NULL;
+    }
+
+  rmg_dispatcher_push_service_event ((RmgDispatcher *)mentry->dispatcher, event);
+}
+
+static guint
+record_failure (RmgMEntry *mentry, gint64 now)
+{
+  RmgDispatcher *dispatcher = (RmgDispatcher *)mentry->dispatcher;
+  gint64 window = (gint64)dispatcher->flap_window_sec * G_USEC_PER_SEC;
+  guint failures = 0;
+
+  mentry->failure_history[mentry->history_head] = now;
+  mentry->history_head = (mentry->history_head + 1) % RMG_MENTRY_FAILURE_HISTORY;
+
+  for (guint i = 0; i < RMG_MENTRY_FAILURE_HISTORY; i++)
+    {
+      if (mentry->failure_history[i] > 0 && (now - mentry->failure_history[i]) <= window)
+        failures++;
+    }
+
+  return failures;
+}
+
+static gboolean
+debounce_timer_callback (gpointer _mentry)
+{
+  RmgMEntry *mentry = (RmgMEntry *)_mentry;
+
+  if (mentry->pending_crashes == 0)
+    {
+      mentry->debounce_source = 0;
+
+      return G_SOURCE_REMOVE;
+    }
 
-  /* Note that we are guaranteed that changed_properties and
-   * invalidated_properties are never NULL
-   */
+  g_info ("Service '%s' %u failures coalesced into one event (total coalesced %lu)",
+          mentry->service_name, mentry->pending_crashes, (gulong)mentry->coalesced_crashes);
 
-  RMG_UNUSED (proxy);
-  RMG_UNUSED (invalidated_properties);
+  dispatch_service_event (mentry, DEVENT_SERVICE_CRASHED, (glong)mentry->pending_crashes);
+  mentry->pending_crashes = 0;
 
-  if (g_variant_n_children (changed_properties) > 0)
+  /* keep debouncing while the service keeps failing */
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+debounce_timer_destroy_notify (gpointer _mentry)
+{
+  rmg_mentry_unref ((RmgMEntry *)_mentry);
+}
+
+static void
+service_crashed (RmgMEntry *mentry)
+{
+  RmgDispatcher *dispatcher = (RmgDispatcher *)mentry->dispatcher;
+  guint failures = record_failure (mentry, g_get_monotonic_time ());
+
+  if (dispatcher->flap_threshold > 0)
     {
-      const gchar *active_state_str = NULL;
-      const gchar *active_substate_str = NULL;
-      DispatcherEventType dispatcher_event = DEVENT_UNKNOWN;
-      ServiceActiveState active_state = SERVICE_STATE_UNKNOWN;
-      ServiceActiveSubstate active_substate = SERVICE_SUBSTATE_UNKNOWN;
-      GVariantIter *iter;
-      const gchar *key;
-      GVariant *value;
-
-      g_variant_get (changed_properties, "a{sv}", &iter);
-
-      while (g_variant_iter_loop (iter, "{&sv}", &key, &value))
+      gboolean flapping
+          = failures >= MIN ((guint)dispatcher->flap_threshold, RMG_MENTRY_FAILURE_HISTORY);
+
+      if (flapping && !mentry->flapping)
         {
-          if (g_strcmp0 (key, "ActiveState") == 0)
-            active_state_str = g_variant_get_string (value, NULL);
-          else if (g_strcmp0 (key, "SubState") == 0)
-            active_substate_str = g_variant_get_string (value, NULL);
+          g_warning ("Service '%s' is flapping with %u failures in %lds", mentry->service_name,
+                     failures, dispatcher->flap_window_sec);
+          mentry->escalate = escalate_flapping;
         }
+      else if (!flapping && mentry->flapping)
+        g_info ("Service '%s' stopped flapping", mentry->service_name);
 
-      if ((active_state_str == NULL) || (active_substate_str == NULL))
+      mentry->flapping = flapping;
+    }
+
+  if (mentry->debounce_source != 0)
+    {
+      mentry->pending_crashes++;
+      mentry->coalesced_crashes++;
+      return;
+    }
+
+  dispatch_service_event (mentry, DEVENT_SERVICE_CRASHED, 1);
+
+  if (dispatcher->crash_debounce_ms > 0)
+    {
+      mentry->debounce_source = g_timeout_add_full (
+          G_PRIORITY_DEFAULT, (guint)dispatcher->crash_debounce_ms, debounce_timer_callback,
+          rmg_mentry_ref (mentry), debounce_timer_destroy_notify);
+    }
+}
+
+void
+rmg_mentry_provisional_crash (RmgMEntry *mentry, const gchar *reason)
+{
+  g_assert (mentry);
+
+  /* only a running unit can crash and the first detection starts the recovery */
+  if (mentry->provisional_crash || mentry->active_state != SERVICE_STATE_ACTIVE)
+    return;
+
+  /* an exit without a known abnormal status may be a clean exit or a stop in progress */
+  if (failure_reason (mentry) == FAILURE_UNKNOWN)
+    {
+      g_info ("Service '%s' exit detected on %s, wait for systemd state", mentry->service_name,
+              reason);
+      return;
+    }
+
+  mentry->provisional_crash = TRUE;
+  mentry->provisional_time = g_get_monotonic_time ();
+
+  g_info ("Service '%s' crash detected on %s, recovery starts ahead of systemd",
+          mentry->service_name, reason);
+
+  service_crashed (mentry);
+}
+
+void
+rmg_mentry_recovery_outcome (RmgMEntry *mentry, gboolean recovered,
+                             RmgFailureReason failure_reason)
+{
+  g_assert (mentry);
+
+  if (recovered)
+    {
+      /* an earlier failed restart no longer escalates once a restart is verified */
+      if (mentry->escalate == escalate_failed_restart)
+        mentry->escalate = NULL;
+
+      dispatch_service_event (mentry, DEVENT_SERVICE_RECOVERED, 1);
+      return;
+    }
+
+  /* the action did not recover the service so its remaining retries are skipped */
+  g_info ("Service '%s' restart failed, the next crash escalates the action",
+          mentry->service_name);
+  mentry->escalate = escalate_failed_restart;
+
+  /* a unit failed by systemd reports the crash itself */
+  if (failure_reason != FAILURE_UNKNOWN)
+    {
+      mentry->result = failure_reason;
+      service_crashed (mentry);
+    }
+}
+
+void
+rmg_mentry_set_result (RmgMEntry *mentry, const gchar *result)
+{
+  g_assert (mentry);
+  mentry->result = rmg_utils_failure_reason_from (result);
+}
+
+void
+rmg_mentry_set_exec_main_status (RmgMEntry *mentry, gint32 exec_main_code, gint32 exec_main_status)
+{
+  g_assert (mentry);
+
+  mentry->exec_main_code = exec_main_code;
+  mentry->exec_main_status = exec_main_status;
+}
+
+void
+rmg_mentry_update_state (RmgMEntry *mentry, const gchar *active_state_str,
+                         const gchar *active_substate_str)
+{
+  DispatcherEventType dispatcher_event = DEVENT_UNKNOWN;
+  ServiceActiveState active_state = SERVICE_STATE_UNKNOWN;
+  ServiceActiveSubstate active_substate = SERVICE_SUBSTATE_UNKNOWN;
+
+  g_assert (mentry);
+  g_assert (active_state_str);
+  g_assert (active_substate_str);
+
+  active_state = rmg_mentry_active_state_from (active_state_str);
+  active_substate = rmg_mentry_active_substate_from (active_substate_str);
+
+  if ((mentry->active_state == active_state) && (mentry->active_substate == active_substate))
+    return;
+
+  g_info ("Service '%s' state change to ActiveState='%s' SubState='%s'", mentry->service_name,
+          active_state_str, active_substate_str);
+
+  if ((mentry->active_state != SERVICE_STATE_FAILED) && (active_state == SERVICE_STATE_FAILED))
+    {
+      dispatcher_event = DEVENT_SERVICE_CRASHED;
+    }
+  else
+    {
+      if ((mentry->active_state != SERVICE_STATE_ACTIVE) && (active_state == SERVICE_STATE_ACTIVE))
         {
-          g_warning ("Cannot read current active state or substate");
-          return;
+          dispatcher_event = DEVENT_SERVICE_RESTARTED;
         }
+    }
 
-      active_state = rmg_mentry_active_state_from (active_state_str);
-      active_substate = rmg_mentry_active_substate_from (active_substate_str);
-
-      if ((mentry->active_state != active_state) || mentry->active_substate != active_substate)
+  if (mentry->provisional_crash)
+    {
+      if (active_state == SERVICE_STATE_FAILED)
+        {
+          /* the crash event was dispatched on the early detection */
+          g_info ("Service '%s' failure confirmed by systemd %ldus after early detection",
+                  mentry->service_name,
+                  (glong)(g_get_monotonic_time () - mentry->provisional_time));
+          mentry->provisional_crash = FALSE;
+          dispatcher_event = DEVENT_UNKNOWN;
+        }
+      else if (active_state == SERVICE_STATE_INACTIVE || active_state == SERVICE_STATE_ACTIVE)
         {
-          g_info ("Service '%s' state change to ActiveState='%s' SubState='%s'",
-                  mentry->service_name, active_state_str, active_substate_str);
-
-          if ((mentry->active_state != SERVICE_STATE_FAILED)
-              && (active_state == SERVICE_STATE_FAILED))
-            {
-              dispatcher_event = DEVENT_SERVICE_CRASHED;
-            }
-          else
-            {
-              if ((mentry->active_state != SERVICE_STATE_ACTIVE)
-                  && (active_state == SERVICE_STATE_ACTIVE))
-                {
-                  dispatcher_event = DEVENT_SERVICE_RESTARTED;
-                }
-            }
-
-          mentry->active_state = active_state;
-          mentry->active_substate = active_substate;
-
-          if (dispatcher_event != DEVENT_UNKNOWN)
-            {
-              RmgDEvent *event = rmg_devent_new (dispatcher_event);
-
-              rmg_devent_set_service_name (event, mentry->service_name);
-              rmg_devent_set_object_path (event, mentry->object_path);
-              rmg_devent_set_manager_proxy (event, mentry->manager_proxy);
-
-              rmg_dispatcher_push_service_event ((RmgDispatcher *)mentry->dispatcher, event);
-            }
+          g_info ("Service '%s' early crash detection was not followed by a systemd failure",
+                  mentry->service_name);
+          mentry->provisional_crash = FALSE;
         }
+    }
 
-      g_variant_iter_free (iter);
+  /* failure details of an earlier run never carry over to the next crash */
+  if (dispatcher_event == DEVENT_SERVICE_RESTARTED)
+    {
+      mentry->result = FAILURE_UNKNOWN;
+      mentry->exec_main_code = 0;
+      mentry->exec_main_status = 0;
     }
+
+  mentry->active_state = active_state;
+  mentry->active_substate = active_substate;
+
+  if (dispatcher_event == DEVENT_SERVICE_CRASHED)
+    service_crashed (mentry);
+  else if (dispatcher_event != DEVENT_UNKNOWN)
+    dispatch_service_event (mentry, dispatcher_event, 1);
+
+  if (mentry->state_callback != NULL)
+    mentry->state_callback (mentry, mentry->state_object);
+}
+
+void
+rmg_mentry_set_state_callback (RmgMEntry *mentry, RmgMEntryStateChanged state_callback,
+                               gpointer state_object)
+{
+  g_assert (mentry);
+
+  mentry->state_callback = state_callback;
+  mentry->state_object = state_object;
 }
 
 ServiceActiveState
 rmg_mentry_active_state_from (const gchar *state_name)
 {
-  gint i = 0;
+  gsize len = (state_name != NULL) ? strlen (state_name) : 0;
+  guint8 state;
 
-  while (active_state_names[i] != NULL)
-    {
-      if (g_strcmp0 (active_state_names[i], state_name) == 0)
-        return (ServiceActiveState)i;
+  if (len == 0)
+    return SERVICE_STATE_UNKNOWN;
 
-      i++;
-    }
+  state = active_state_slots[active_state_hash (state_name, len)];
 
-  return SERVICE_STATE_UNKNOWN;
+  if (strcmp (active_state_names[state], state_name) != 0)
+    return SERVICE_STATE_UNKNOWN;
+
+  return (ServiceActiveState)state;
 }
 
 ServiceActiveSubstate
 rmg_mentry_active_substate_from (const gchar *substate_name)
 {
-  gint i = 0;
+  gsize len = (substate_name != NULL) ? strlen (substate_name) : 0;
+  guint8 substate;
 
-  while (active_substate_names[i] != NULL)
-    {
-      if (g_strcmp0 (active_substate_names[i], substate_name) == 0)
-        return (ServiceActiveSubstate)i;
+  if (len == 0)
+    return SERVICE_SUBSTATE_UNKNOWN;
 
-      i++;
-    }
+  substate = active_substate_slots[active_substate_hash (substate_name, len)];
+
+  if (strcmp (active_substate_names[substate], substate_name) != 0)
+    return SERVICE_SUBSTATE_UNKNOWN;
 
-  return SERVICE_SUBSTATE_UNKNOWN;
+  return (ServiceActiveSubstate)substate;
 }
 
 const gchar *
@@ -168,8 +432,8 @@ rmg_mentry_new (const gchar *service_name, const gchar *object_path,
 
   g_ref_count_init (&mentry->rc);
 
-  mentry->service_name = g_strdup (service_name);
-  mentry->object_path = g_strdup (object_path);
+  rmg_utils_set_name (&mentry->service_name, service_name);
+  rmg_utils_set_name (&mentry->object_path, object_path);
   mentry->active_state = active_state;
   mentry->active_substate = active_substate;
 
@@ -191,21 +455,14 @@ rmg_mentry_unref (RmgMEntry *mentry)
 
   if (g_ref_count_dec (&mentry->rc) == TRUE)
     {
-      if (mentry->service_name != NULL)
-        g_free (mentry->service_name);
-
-      if (mentry->object_path != NULL)
-        g_free (mentry->object_path);
-
-      if (mentry->proxy != NULL)
-        g_object_unref (mentry->proxy);
-
       if (mentry->manager_proxy != NULL)
         g_object_unref (mentry->manager_proxy);
 
       if (mentry->dispatcher != NULL)
         rmg_dispatcher_unref ((RmgDispatcher *)mentry->dispatcher);
 
+      g_clear_pointer (&mentry->service_name, g_ref_string_release);
+      g_clear_pointer (&mentry->object_path, g_ref_string_release);
       g_free (mentry);
     }
 }
@@ -218,44 +475,9 @@ rmg_mentry_set_manager_proxy (RmgMEntry *mentry, GDBusProxy *manager_proxy)
 }
 
 void
-proxy_ready_async_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
-{
-  g_autoptr (GError) error = NULL;
-  RmgMEntry *mentry = (RmgMEntry *)user_data;
-  RmgStatus status = RMG_STATUS_OK;
-
-  RMG_UNUSED (source_object);
-
-  mentry->proxy = g_dbus_proxy_new_finish (res, &error);
-
-  if (error != NULL)
-    {
-      g_warning ("Fail to build proxy for new service '%s'. Error '%s'", mentry->service_name,
-                 error->message);
-      status = RMG_STATUS_ERROR;
-    }
-  else
-    {
-      g_signal_connect (mentry->proxy, "g-properties-changed", G_CALLBACK (on_properties_changed),
-                        mentry);
-    }
-
-  mentry->monitor_callback (mentry, mentry->monitor_object, status);
-}
-
-void
-rmg_mentry_build_proxy_async (RmgMEntry *mentry, gpointer _dispatcher,
-                              RmgMEntryAsyncStatus monitor_callback, gpointer _monitor)
+rmg_mentry_set_dispatcher (RmgMEntry *mentry, gpointer _dispatcher)
 {
   g_assert (mentry);
   g_assert (_dispatcher);
-
   mentry->dispatcher = rmg_dispatcher_ref ((RmgDispatcher *)_dispatcher);
-  mentry->monitor_callback = monitor_callback;
-  mentry->monitor_object = _monitor;
-
-  g_dbus_proxy_new_for_bus (
-      G_BUS_TYPE_SYSTEM, G_DBUS_PROXY_FLAGS_NONE, NULL,                /* GDBusInterfaceInfo */
-      sd_dbus_name, mentry->object_path, sd_dbus_interface_unit, NULL, /* GCancellable */
-      proxy_ready_async_cb, mentry);
 }
@@ -38,7 +38,9 @@ typedef enum _ServiceActiveState
   SERVICE_STATE_INACTIVE,
   SERVICE_STATE_FAILED,
   SERVICE_STATE_ACTIVATING,
-  SERVICE_STATE_DEACTIVATING
+  SERVICE_STATE_DEACTIVATING,
+  SERVICE_STATE_MAINTENANCE,
+  SERVICE_STATE_REFRESHING
 } ServiceActiveState;
 
 typedef enum _ServiceActiveSubstate
@@ -46,10 +48,34 @@ typedef enum _ServiceActiveSubstate
   SERVICE_SUBSTATE_UNKNOWN,
   SERVICE_SUBSTATE_RUNNING,
   SERVICE_SUBSTATE_DEAD,
-  SERVICE_SUBSTATE_STOP_SIGTERM
+  SERVICE_SUBSTATE_STOP_SIGTERM,
+  SERVICE_SUBSTATE_CONDITION,
+  SERVICE_SUBSTATE_START_PRE,
+  SERVICE_SUBSTATE_START,
+  SERVICE_SUBSTATE_START_POST,
+  SERVICE_SUBSTATE_EXITED,
+  SERVICE_SUBSTATE_RELOAD,
+  SERVICE_SUBSTATE_RELOAD_SIGNAL,
+  SERVICE_SUBSTATE_RELOAD_NOTIFY,
+  SERVICE_SUBSTATE_STOP,
+  SERVICE_SUBSTATE_STOP_WATCHDOG,
+  SERVICE_SUBSTATE_STOP_SIGKILL,
+  SERVICE_SUBSTATE_STOP_POST,
+  SERVICE_SUBSTATE_FINAL_WATCHDOG,
+  SERVICE_SUBSTATE_FINAL_SIGTERM,
+  SERVICE_SUBSTATE_FINAL_SIGKILL,
+  SERVICE_SUBSTATE_FAILED,
+  SERVICE_SUBSTATE_DEAD_BEFORE_AUTO_RESTART,
+  SERVICE_SUBSTATE_FAILED_BEFORE_AUTO_RESTART,
+  SERVICE_SUBSTATE_DEAD_RESOURCES_PINNED,
+  SERVICE_SUBSTATE_AUTO_RESTART,
+  SERVICE_SUBSTATE_AUTO_RESTART_QUEUED,
+  SERVICE_SUBSTATE_CLEANING
 } ServiceActiveSubstate;
 
-typedef void (*RmgMEntryAsyncStatus) (gpointer _mentry, gpointer _monitor, RmgStatus status);
+#define RMG_MENTRY_FAILURE_HISTORY (16)
+
+typedef void (*RmgMEntryStateChanged) (gpointer _mentry, gpointer _monitor);
 
 /**
  * @struct Service monitor entry
@@ -58,15 +84,26 @@ typedef void (*RmgMEntryAsyncStatus) (gpointer _mentry, gpointer _monitor, RmgSt
 typedef struct _RmgMEntry
 {
   grefcount rc;
-  GDBusProxy *proxy;
   GDBusProxy *manager_proxy;
   gpointer dispatcher;
-  gchar *service_name;
-  gchar *object_path;
+  gchar *service_name; /**< Unit name atom */
+  gchar *object_path;  /**< Unit object path atom */
   ServiceActiveState active_state;
   ServiceActiveSubstate active_substate;
-  RmgMEntryAsyncStatus monitor_callback;
-  gpointer monitor_object;
+  RmgMEntryStateChanged state_callback; /**< Optional state change notification */
+  gpointer state_object;                /**< Data passed with the state change notification */
+  gboolean provisional_crash;           /**< Crash dispatched ahead of systemd confirmation */
+  gint64 provisional_time;              /**< Monotonic time of the provisional crash */
+  guint debounce_source;                /**< Crash debounce timer or 0 if not debouncing */
+  guint pending_crashes;                /**< Failures coalesced in the current debounce window */
+  guint64 coalesced_crashes;            /**< Total failures coalesced into earlier events */
+  gboolean flapping;                    /**< Failure rate is above the flap threshold */
+  const gchar *escalate;                /**< Why the next crash escalates or NULL */
+  gint64 failure_history[RMG_MENTRY_FAILURE_HISTORY]; /**< Ring of failure timestamps */
+  guint history_head;                                 /**< Next failure history slot */
+  RmgFailureReason result;                            /**< Last unit Result */
+  gint32 exec_main_code;                              /**< Last main process ExecMainCode */
+  gint32 exec_main_status;                            /**< Last main process ExecMainStatus */
 } RmgMEntry;
 
 #define RMG_MENTRY_TO_PTR(e) ((gpointer)(RmgMEntry *)(e))
@@ -95,6 +132,64 @@ void rmg_mentry_unref (RmgMEntry *mentry);
  */
 void rmg_mentry_set_manager_proxy (RmgMEntry *mentry, GDBusProxy *manager_proxy);
 
+/**
+ * @brief Set the dispatcher receiving the service events
+ */
+void rmg_mentry_set_dispatcher (RmgMEntry *mentry, gpointer _dispatcher);
+
+/**
+ * @brief Set a callback called after each entry state change
+ */
+void rmg_mentry_set_state_callback (RmgMEntry *mentry, RmgMEntryStateChanged state_callback,
+                                    gpointer state_object);
+
+/**
+ * @brief Dispatch a crash detected ahead of systemd reporting the unit failed
+ * The crash event is dispatched at once if the exit status or result set on the entry is
+ * abnormal and the later systemd failure is not dispatched again. An exit with an unknown
+ * status waits for the systemd state
+ * @param mentry Pointer to the mentry object
+ * @param reason Short description of the detection source
+ */
+void rmg_mentry_provisional_crash (RmgMEntry *mentry, const gchar *reason);
+
+/**
+ * @brief Record the outcome of the restart job recovering the service
+ * A verified restart is dispatched as DEVENT_SERVICE_RECOVERED. A failed restart escalates
+ * the next crash event and is dispatched as a crash if the unit never enters the failed state.
+ * @param mentry Pointer to the mentry object
+ * @param recovered TRUE if the unit is active after the restart job
+ * @param failure_reason The job failure if the unit is not failed by systemd, otherwise
+ * FAILURE_UNKNOWN
+ */
+void rmg_mentry_recovery_outcome (RmgMEntry *mentry, gboolean recovered,
+                                  RmgFailureReason failure_reason);
+
+/**
+ * @brief Set the unit Result property value carried by the next crash event
+ * @param mentry Pointer to the mentry object
+ * @param result The Result property value
+ */
+void rmg_mentry_set_result (RmgMEntry *mentry, const gchar *result);
+
+/**
+ * @brief Set the main process exit details carried by the next crash event
+ * @param mentry Pointer to the mentry object
+ * @param exec_main_code The ExecMainCode property value
+ * @param exec_main_status The ExecMainStatus property value
+ */
+void rmg_mentry_set_exec_main_status (RmgMEntry *mentry, gint32 exec_main_code,
+                                      gint32 exec_main_status);
+
+/**
+ * @brief Update the entry state and dispatch crash or restart events on transitions
+ * @param mentry Pointer to the mentry object
+ * @param active_state_str The new ActiveState property value
+ * @param active_substate_str The new SubState property value
+ */
+void rmg_mentry_update_state (RmgMEntry *mentry, const gchar *active_state_str,
+                              const gchar *active_substate_str);
+
 /*
  * @brief Get service active state from string
  * @return Service Active State
@@ -119,10 +214,4 @@ const gchar *rmg_mentry_get_active_state (ServiceActiveState state);
  */
 const gchar *rmg_mentry_get_active_substate (ServiceActiveSubstate state);
 
-/*
- * @brief Build mentry proxy and dispatch events
- */
-void rmg_mentry_build_proxy_async (RmgMEntry *mentry, gpointer _dispatcher,
-                                   RmgMEntryAsyncStatus monitor_callback, gpointer monitor_data);
-
 G_END_DECLS
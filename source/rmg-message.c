@@ -22,6 +22,7 @@
  */
 
 #include "rmg-message.h"
+#include "rmg-utils.h"
 
 #include <memory.h>
 #include <stdint.h>
@@ -64,8 +65,9 @@ rmg_message_unref (RmgMessage *msg)
 
   if (g_ref_count_dec (&msg->rc) == TRUE)
     {
-      g_free (msg->data.service_name);
-      g_free (msg->data.context_name);
+      g_clear_pointer (&msg->data.process_name, g_ref_string_release);
+      g_clear_pointer (&msg->data.service_name, g_ref_string_release);
+      g_clear_pointer (&msg->data.context_name, g_ref_string_release);
       g_free (msg);
     }
 }
@@ -121,7 +123,7 @@ rmg_message_set_process_name (RmgMessage *msg, const gchar *process_name)
 {
   g_assert (msg);
   g_assert (process_name);
-  msg->data.process_name = g_strdup (process_name);
+  rmg_utils_set_name (&msg->data.process_name, process_name);
 }
 
 const gchar *
@@ -136,7 +138,7 @@ rmg_message_set_service_name (RmgMessage *msg, const gchar *service_name)
 {
   g_assert (msg);
   g_assert (service_name);
-  msg->data.service_name = g_strdup (service_name);
+  rmg_utils_set_name (&msg->data.service_name, service_name);
 }
 
 const gchar *
@@ -151,7 +153,7 @@ rmg_message_set_context_name (RmgMessage *msg, const gchar *context_name)
 {
   g_assert (msg);
   g_assert (context_name);
-  msg->data.context_name = g_strdup (context_name);
+  rmg_utils_set_name (&msg->data.context_name, context_name);
 }
 
 const gchar *
@@ -165,6 +167,10 @@ RmgStatus
 rmg_message_read (gint fd, RmgMessage *msg)
 {
   struct iovec iov[RMG_MESSAGE_IOVEC_MAX_ARRAY] = {};
+  gchar arg1_buf[RMG_MESSAGE_MAX_NAME_LEN + 2] = {};
+  gchar arg2_buf[RMG_MESSAGE_MAX_NAME_LEN + 2] = {};
+  gchar **arg1_name = NULL;
+  gchar **arg2_name = NULL;
   gint iov_index = 0;
   gssize sz;
 
@@ -212,46 +218,35 @@ rmg_message_read (gint fd, RmgMessage *msg)
     case RMG_MESSAGE_REQUEST_CONTEXT_RESTART:
     case RMG_MESSAGE_REQUEST_PLATFORM_RESTART:
     case RMG_MESSAGE_REQUEST_FACTORY_RESET:
+    case RMG_MESSAGE_INFORM_CLIENT_SERVICE_FAILED:
+    case RMG_MESSAGE_INFORM_PRIMARY_SERVICE_FAILED:
       /* arg1 */
-      msg->data.service_name = g_new0 (gchar, msg->hdr.size_of_arg1);
-      iov[iov_index].iov_base = msg->data.service_name;
+      arg1_name = &msg->data.service_name;
+      iov[iov_index].iov_base = arg1_buf;
       iov[iov_index++].iov_len = msg->hdr.size_of_arg1;
 
       /* arg2 */
-      msg->data.context_name = g_new0 (gchar, msg->hdr.size_of_arg2);
-      iov[iov_index].iov_base = msg->data.context_name;
+      arg2_name = &msg->data.context_name;
+      iov[iov_index].iov_base = arg2_buf;
       iov[iov_index++].iov_len = msg->hdr.size_of_arg2;
       break;
 
     case RMG_MESSAGE_INFORM_PROCESS_CRASH:
       /* arg1 */
-      msg->data.process_name = g_new0 (gchar, msg->hdr.size_of_arg1);
-      iov[iov_index].iov_base = msg->data.process_name;
-      iov[iov_index++].iov_len = msg->hdr.size_of_arg1;
-
-      /* arg2 */
-      msg->data.context_name = g_new0 (gchar, msg->hdr.size_of_arg2);
-      iov[iov_index].iov_base = msg->data.context_name;
-      iov[iov_index++].iov_len = msg->hdr.size_of_arg2;
-      break;
-
-    case RMG_MESSAGE_INFORM_CLIENT_SERVICE_FAILED:
-    case RMG_MESSAGE_INFORM_PRIMARY_SERVICE_FAILED:
-      /* arg1 */
-      msg->data.service_name = g_new0 (gchar, msg->hdr.size_of_arg1);
-      iov[iov_index].iov_base = msg->data.service_name;
+      arg1_name = &msg->data.process_name;
+      iov[iov_index].iov_base = arg1_buf;
       iov[iov_index++].iov_len = msg->hdr.size_of_arg1;
 
       /* arg2 */
-      msg->data.context_name = g_new0 (gchar, msg->hdr.size_of_arg2);
-      iov[iov_index].iov_base = msg->data.context_name;
+      arg2_name = &msg->data.context_name;
+      iov[iov_index].iov_base = arg2_buf;
       iov[iov_index++].iov_len = msg->hdr.size_of_arg2;
       break;
 
     case RMG_MESSAGE_REPLICA_DESCRIPTOR:
       /* arg1 */
-      msg->data.context_name = g_new0 (gchar, msg->hdr.size_of_arg1);
-      iov[iov_index].iov_base = msg->data.context_name;
+      arg1_name = &msg->data.context_name;
+      iov[iov_index].iov_base = arg1_buf;
       iov[iov_index++].iov_len = msg->hdr.size_of_arg1;
       break;
 
@@ -259,11 +254,22 @@ rmg_message_read (gint fd, RmgMessage *msg)
       break;
     }
 
+  /* name payloads are read into the stack buffers which must keep a terminator */
+  if ((arg1_name != NULL && msg->hdr.size_of_arg1 >= sizeof (arg1_buf))
+      || (arg2_name != NULL && msg->hdr.size_of_arg2 >= sizeof (arg2_buf)))
+    return RMG_STATUS_ERROR;
+
   /* read into the message structure */
   if (iov_index > 0)
     if ((sz = readv (fd, iov, iov_index)) <= 0)
       return RMG_STATUS_ERROR;
 
+  if (arg1_name != NULL)
+    rmg_utils_set_name (arg1_name, arg1_buf);
+
+  if (arg2_name != NULL)
+    rmg_utils_set_name (arg2_name, arg2_buf);
+
   return RMG_STATUS_OK;
 }
 
@@ -71,9 +71,9 @@ typedef struct _RmgMessageData
 {
   uint64_t action_response;
   uint64_t instance_status;
-  gchar *process_name;
-  gchar *service_name;
-  gchar *context_name;
+  gchar *process_name; /**< Process name atom */
+  gchar *service_name; /**< Service name atom */
+  gchar *context_name; /**< Context name atom */
 } RmgMessageData;
 
 /**
@@ -191,7 +191,7 @@ const gchar *rmg_message_get_context_name (RmgMessage *msg);
 
 /*
  * @brief Read data into message object
- * If message read has payload the data has to be released by the caller
+ * Name payloads are held as name atoms released with the message
  * @param msg The message object
  * @param fd File descriptor to read from
  * @return RMG_STATUS_OK on success, RMG_STATUS_ERROR otherwise
@@ -29,6 +29,7 @@
 const gchar *sd_dbus_name = "org.freedesktop.systemd1";
 const gchar *sd_dbus_object_path = "/org/freedesktop/systemd1";
 const gchar *sd_dbus_interface_unit = "org.freedesktop.systemd1.Unit";
+const gchar *sd_dbus_interface_service = "org.freedesktop.systemd1.Service";
 const gchar *sd_dbus_interface_manager = "org.freedesktop.systemd1.Manager";
 
 /**
@@ -38,11 +39,6 @@ const gchar *sd_dbus_interface_manager = "org.freedesktop.systemd1.Manager";
  */
 static void post_monitor_event (RmgMonitor *monitor, MonitorEventType type);
 
-/**
- * @brief GSource prepare function
- */
-static gboolean monitor_source_prepare (GSource *source, gint *timeout);
-
 /**
  * @brief GSource dispatch function
  */
@@ -58,31 +54,26 @@ static gboolean monitor_source_callback (gpointer _monitor, gpointer _event);
  */
 static void monitor_source_destroy_notify (gpointer _monitor);
 
-/**
- * @brief Async queue destroy notification callback function
- */
-static void monitor_queue_destroy_notify (gpointer _monitor);
-
-/**
- * @brief Initialization status callback for a new mentry
- */
-static void mentry_init_status (gpointer _mentry, gpointer _monitor, RmgStatus status);
-
 /**
  * @brief Build proxy local
  */
 static void monitor_build_proxy (RmgMonitor *monitor);
 
 /**
- * @brief Read services local
+ * @brief Request a unit state snapshot adding new units and updating the known ones
  */
-static void monitor_read_services (RmgMonitor *monitor);
+static void monitor_list_units (RmgMonitor *monitor);
 
 /**
  * @brief Start relax timers
  */
 static void monitor_start_relax_timers (RmgMonitor *monitor);
 
+/**
+ * @brief Schedule queued registrations in batches from idle
+ */
+static void monitor_pump_registrations (RmgMonitor *monitor);
+
 /**
  * @brief Add service if not exist
  */
@@ -98,7 +89,7 @@ static void call_notify_proxy_entry (gpointer _notify_object, gpointer _dbus_pro
  * @brief GSourceFuncs vtable
  */
 static GSourceFuncs monitor_source_funcs = {
-  monitor_source_prepare, NULL, monitor_source_dispatch, NULL, NULL, NULL,
+  NULL, NULL, monitor_source_dispatch, NULL, NULL, NULL,
 };
 
 static void
@@ -111,32 +102,21 @@ post_monitor_event (RmgMonitor *monitor, MonitorEventType type)
   e = g_new0 (RmgMonitorEvent, 1);
   e->type = type;
 
-  g_async_queue_push (monitor->queue, e);
-}
-
-static gboolean
-monitor_source_prepare (GSource *source, gint *timeout)
-{
-  RmgMonitor *monitor = (RmgMonitor *)source;
-
-  RMG_UNUSED (timeout);
-
-  return (g_async_queue_length (monitor->queue) > 0);
+  rmg_eventqueue_push (monitor->queue, e);
 }
 
 static gboolean
 monitor_source_dispatch (GSource *source, GSourceFunc callback, gpointer _monitor)
 {
   RmgMonitor *monitor = (RmgMonitor *)source;
-  gpointer event = g_async_queue_try_pop (monitor->queue);
 
   RMG_UNUSED (callback);
   RMG_UNUSED (_monitor);
 
-  if (event == NULL)
-    return G_SOURCE_CONTINUE;
+  if (!rmg_eventqueue_dispatch (monitor->queue, monitor->callback, monitor))
+    return G_SOURCE_REMOVE;
 
-  return monitor->callback (monitor, event) == TRUE ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+  return G_SOURCE_CONTINUE;
 }
 
 static gboolean
@@ -155,7 +135,7 @@ monitor_source_callback (gpointer _monitor, gpointer _event)
       break;
 
     case MONITOR_EVENT_READ_SERVICES:
-      monitor_read_services (monitor);
+      monitor_list_units (monitor);
       monitor_start_relax_timers (monitor);
       break;
 
@@ -179,25 +159,6 @@ monitor_source_destroy_notify (gpointer _monitor)
   rmg_monitor_unref (monitor);
 }
 
-static void
-monitor_queue_destroy_notify (gpointer _monitor)
-{
-  RMG_UNUSED (_monitor);
-  g_debug ("Monitor queue destroy notification");
-}
-
-gint
-find_service_by_name (gconstpointer _entry, gconstpointer _service_name)
-{
-  const RmgMEntry *entry = (const RmgMEntry *)_entry;
-  const gchar *service_name = (const gchar *)_service_name;
-
-  if (g_strcmp0 (entry->service_name, service_name) == 0)
-    return 0;
-
-  return 1;
-}
-
 static void
 on_manager_signal (GDBusProxy *proxy, gchar *sender_name, gchar *signal_name, GVariant *parameters,
                    gpointer user_data)
@@ -222,6 +183,101 @@ on_manager_signal (GDBusProxy *proxy, gchar *sender_name, gchar *signal_name, GV
       else
         g_warning ("Fail to read date on UnitNew signal");
     }
+  else if (g_strcmp0 (signal_name, "Reloading") == 0)
+    {
+      gboolean active = FALSE;
+
+      g_variant_get (parameters, "(b)", &active);
+
+      /* unit states may change during a reload without a PropertiesChanged signal */
+      if (!active && monitor->services_read)
+        {
+          g_info ("Manager reloaded, resync unit states");
+          monitor_list_units (monitor);
+        }
+    }
+}
+
+static void
+on_unit_properties_changed (GDBusConnection *connection, const gchar *sender_name,
+                            const gchar *object_path, const gchar *interface_name,
+                            const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+  RmgMonitor *monitor = (RmgMonitor *)user_data;
+  g_autoptr (GVariant) changed_properties = NULL;
+  const gchar *active_state_str = NULL;
+  const gchar *active_substate_str = NULL;
+  const gchar *properties_interface = NULL;
+  RmgMEntry *mentry = NULL;
+
+  RMG_UNUSED (connection);
+  RMG_UNUSED (sender_name);
+  RMG_UNUSED (interface_name);
+  RMG_UNUSED (signal_name);
+
+  mentry = (RmgMEntry *)g_hash_table_lookup (monitor->units, object_path);
+  if (mentry == NULL)
+    return;
+
+  g_variant_get_child (parameters, 0, "&s", &properties_interface);
+  changed_properties = g_variant_get_child_value (parameters, 1);
+
+  if (g_variant_n_children (changed_properties) == 0)
+    return;
+
+  /* systemd emits the Service interface changes ahead of the Unit ones so the
+   * failure result is known when the unit state changes to failed */
+  if (g_strcmp0 (properties_interface, sd_dbus_interface_service) == 0)
+    {
+      const gchar *result_str = NULL;
+      gint32 exec_main_code = 0;
+      gint32 exec_main_status = 0;
+
+      if (g_variant_lookup (changed_properties, "Result", "&s", &result_str))
+        rmg_mentry_set_result (mentry, result_str);
+
+      if (g_variant_lookup (changed_properties, "ExecMainCode", "i", &exec_main_code)
+          && g_variant_lookup (changed_properties, "ExecMainStatus", "i", &exec_main_status))
+        rmg_mentry_set_exec_main_status (mentry, exec_main_code, exec_main_status);
+
+      return;
+    }
+
+  if (!g_variant_lookup (changed_properties, "ActiveState", "&s", &active_state_str)
+      || !g_variant_lookup (changed_properties, "SubState", "&s", &active_substate_str))
+    g_warning ("Cannot read current active state or substate");
+  else
+    rmg_mentry_update_state (mentry, active_state_str, active_substate_str);
+}
+
+static void
+monitor_subscribe_units (RmgMonitor *monitor)
+{
+  GDBusConnection *connection = g_dbus_proxy_get_connection (monitor->proxy);
+
+#ifdef WITH_SDBUS_MONITOR
+  /* state changes are delivered by sdmonitor */
+  if (monitor->sdmonitor == NULL)
+#endif
+    {
+      /* a single subscription covers the state changes of all units */
+      monitor->unit_subscription = g_dbus_connection_signal_subscribe (
+          connection, sd_dbus_name, "org.freedesktop.DBus.Properties", "PropertiesChanged",
+          NULL, /* object path */
+          sd_dbus_interface_unit, G_DBUS_SIGNAL_FLAGS_NONE, on_unit_properties_changed, monitor,
+          NULL); /* user data free func */
+
+      /* the failure result is read from the same signal stream without extra calls */
+      monitor->service_subscription = g_dbus_connection_signal_subscribe (
+          connection, sd_dbus_name, "org.freedesktop.DBus.Properties", "PropertiesChanged",
+          NULL, /* object path */
+          sd_dbus_interface_service, G_DBUS_SIGNAL_FLAGS_NONE, on_unit_properties_changed,
+          monitor, NULL); /* user data free func */
+    }
+
+  /* systemd only emits unit signals while at least one client is subscribed */
+  g_dbus_proxy_call (monitor->proxy, "Subscribe", NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL,
+                     NULL);
 }
 
 static void
@@ -248,7 +304,7 @@ monitor_build_proxy (RmgMonitor *monitor)
   g_assert (monitor);
 
   monitor->proxy = g_dbus_proxy_new_for_bus_sync (
-      G_BUS_TYPE_SYSTEM, G_DBUS_PROXY_FLAGS_NONE, NULL,                   /* GDBusInterfaceInfo */
+      G_BUS_TYPE_SYSTEM, G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES, NULL, /* GDBusInterfaceInfo */
       sd_dbus_name, sd_dbus_object_path, sd_dbus_interface_manager, NULL, /* GCancellable */
       &error);
 
@@ -257,6 +313,7 @@ monitor_build_proxy (RmgMonitor *monitor)
   else
     {
       g_signal_connect (monitor->proxy, "g-signal", G_CALLBACK (on_manager_signal), monitor);
+      monitor_subscribe_units (monitor);
 
       g_list_foreach (monitor->notify_proxy, call_notify_proxy_entry, monitor->proxy);
     }
@@ -270,28 +327,97 @@ rmg_monitor_get_manager_proxy (RmgMonitor *monitor)
 }
 
 static void
-mentry_init_status (gpointer _mentry, gpointer _monitor, RmgStatus status)
+monitor_entry_state_changed (gpointer _mentry, gpointer _monitor)
 {
   RmgMonitor *monitor = (RmgMonitor *)_monitor;
   RmgMEntry *mentry = (RmgMEntry *)_mentry;
 
-  if (status != RMG_STATUS_OK)
+  if (mentry->active_state != SERVICE_STATE_ACTIVE)
+    return;
+
+  /* a restarted unit gets a new cgroup and main process so the watches are armed again */
+  if (monitor->cgwatch != NULL)
+    rmg_cgwatch_rearm (monitor->cgwatch, mentry);
+
+  rmg_pidwatch_rearm (monitor->pidwatch, mentry);
+}
+
+static void
+monitor_register_entry (RmgMonitor *monitor, RmgMEntry *mentry)
+{
+#ifdef WITH_SDBUS_MONITOR
+  if (monitor->sdmonitor != NULL)
+    rmg_sdmonitor_add_entry (monitor->sdmonitor, mentry);
+#endif
+
+  g_info ("Monitoring unit='%s' path='%s'", mentry->service_name, mentry->object_path);
+  monitor->services = g_list_prepend (monitor->services, mentry);
+
+  if (monitor->cgwatch != NULL
+      && g_hash_table_contains (monitor->recovery_units, mentry->service_name))
     {
-      g_warning ("Fail to initialized mentry for service '%s'", mentry->service_name);
-      rmg_mentry_unref (mentry);
+      rmg_mentry_set_state_callback (mentry, monitor_entry_state_changed, monitor);
+      rmg_cgwatch_add_entry (monitor->cgwatch, mentry);
     }
-  else
+
+  if (g_hash_table_contains (monitor->critical_units, mentry->service_name))
     {
-      g_info ("Monitoring unit='%s' path='%s'", mentry->service_name, mentry->object_path);
-      monitor->services = g_list_prepend (monitor->services, mentry);
+      rmg_mentry_set_state_callback (mentry, monitor_entry_state_changed, monitor);
+      rmg_pidwatch_add_entry (monitor->pidwatch, mentry);
     }
 }
 
+static gboolean
+monitor_pump_idle (gpointer _monitor)
+{
+  RmgMonitor *monitor = (RmgMonitor *)_monitor;
+
+  for (guint i = 0; i < monitor->batch_limit; i++)
+    {
+      RmgMEntry *entry = g_queue_pop_head (monitor->priority_queue);
+
+      if (entry == NULL)
+        entry = g_queue_pop_head (monitor->normal_queue);
+
+      if (entry == NULL)
+        break;
+
+      monitor_register_entry (monitor, entry);
+    }
+
+  if (!g_queue_is_empty (monitor->priority_queue) || !g_queue_is_empty (monitor->normal_queue))
+    return G_SOURCE_CONTINUE;
+
+  if (!monitor->coverage_reached)
+    {
+      monitor->coverage_reached = TRUE;
+      g_info ("Monitoring coverage reached for %u units in %ldms",
+              g_list_length (monitor->services),
+              (glong)((g_get_monotonic_time () - monitor->start_time) / 1000));
+    }
+
+  monitor->pump_source = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+monitor_pump_registrations (RmgMonitor *monitor)
+{
+  g_assert (monitor);
+
+  /* registrations are coalesced until the initial unit list is read */
+  if (!monitor->services_read || monitor->pump_source != 0)
+    return;
+
+  monitor->pump_source = g_idle_add (monitor_pump_idle, monitor);
+}
+
 static void
 add_service (RmgMonitor *monitor, const gchar *service_name, const gchar *object_path,
              ServiceActiveState active_state, ServiceActiveSubstate active_substate)
 {
-  GList *check_existent = NULL;
+  RmgMEntry *entry = NULL;
 
   g_assert (monitor);
   g_assert (service_name);
@@ -300,64 +426,106 @@ add_service (RmgMonitor *monitor, const gchar *service_name, const gchar *object
   if (!g_str_has_suffix (service_name, ".service"))
     return;
 
-  check_existent = g_list_find_custom (monitor->services, service_name, find_service_by_name);
+  if (rmg_monitor_get_entry (monitor, service_name) != NULL)
+    return;
+
+  entry = rmg_mentry_new (service_name, object_path, active_state, active_substate);
+  rmg_mentry_set_manager_proxy (entry, rmg_monitor_get_manager_proxy (monitor));
+  rmg_mentry_set_dispatcher (entry, monitor->dispatcher);
+
+  /* the entry follows state changes from now on even if still queued for registration */
+  g_hash_table_insert (monitor->registered, entry->service_name, entry);
+  g_hash_table_insert (monitor->units, entry->object_path, entry);
 
-  if (check_existent == NULL)
+  if (g_hash_table_contains (monitor->recovery_units, entry->service_name))
+    g_queue_push_tail (monitor->priority_queue, entry);
+  else
+    g_queue_push_tail (monitor->normal_queue, entry);
+
+  monitor_pump_registrations (monitor);
+}
+
+static void
+monitor_apply_unit_list (RmgMonitor *monitor, GVariant *unit_list)
+{
+  const gchar *unitname = NULL;
+  const gchar *description = NULL;
+  const gchar *loadstate = NULL;
+  const gchar *activestate = NULL;
+  const gchar *substate = NULL;
+  const gchar *followedby = NULL;
+  const gchar *objectpath = NULL;
+  const gchar *jobtype = NULL;
+  const gchar *jobobjectpath = NULL;
+  guint32 queuedjobs = 0;
+  g_autoptr (GVariantIter) iter = NULL;
+
+  g_variant_get (unit_list, "(a(ssssssouso))", &iter);
+
+  while (g_variant_iter_next (iter, "(&s&s&s&s&s&s&ou&s&o)", &unitname, &description, &loadstate,
+                              &activestate, &substate, &followedby, &objectpath, &queuedjobs,
+                              &jobtype, &jobobjectpath))
     {
-      RmgMEntry *entry = rmg_mentry_new (service_name, object_path, active_state, active_substate);
+      RmgMEntry *mentry = (RmgMEntry *)g_hash_table_lookup (monitor->units, objectpath);
 
-      rmg_mentry_set_manager_proxy (entry, rmg_monitor_get_manager_proxy (monitor));
-      rmg_mentry_build_proxy_async (entry, monitor->dispatcher, mentry_init_status,
-                                    (gpointer)monitor);
+      if (mentry != NULL)
+        rmg_mentry_update_state (mentry, activestate, substate);
+      else
+        {
+          add_service (monitor, unitname, objectpath, rmg_mentry_active_state_from (activestate),
+                       rmg_mentry_active_substate_from (substate));
+        }
     }
 }
 
 static void
-monitor_read_services (RmgMonitor *monitor)
+list_units_async_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
 {
-  g_autoptr (GVariant) service_list = NULL;
+  RmgMonitor *monitor = (RmgMonitor *)user_data;
+  g_autoptr (GVariant) unit_list = NULL;
   g_autoptr (GError) error = NULL;
 
+  unit_list = g_dbus_proxy_call_finish (G_DBUS_PROXY (source_object), res, &error);
+  if (error != NULL)
+    g_warning ("Fail to call ListUnitsByPatterns on Manager proxy. Error %s", error->message);
+  else
+    monitor_apply_unit_list (monitor, unit_list);
+
+  if (!monitor->services_read)
+    {
+      g_debug ("Unit registration queued priority=%u normal=%u",
+               g_queue_get_length (monitor->priority_queue),
+               g_queue_get_length (monitor->normal_queue));
+
+      monitor->services_read = TRUE;
+      monitor_pump_registrations (monitor);
+    }
+
+  rmg_monitor_unref (monitor);
+}
+
+static void
+monitor_list_units (RmgMonitor *monitor)
+{
+  const gchar *states[] = { NULL };
+  const gchar *patterns[] = { "*.service", NULL };
+
   g_assert (monitor);
 
   if (monitor->proxy == NULL)
     {
       g_warning ("Monitor proxy not available for service units read");
+      monitor->services_read = TRUE;
+      monitor_pump_registrations (monitor);
       return;
     }
 
-  service_list = g_dbus_proxy_call_sync (monitor->proxy, "ListUnits", NULL, G_DBUS_CALL_FLAGS_NONE,
-                                         -1, NULL, &error);
-  if (error != NULL)
-    g_warning ("Fail to call ListUnits on Manager proxy. Error %s", error->message);
-  else
-    {
-      const gchar *unitname = NULL;
-      const gchar *description = NULL;
-      const gchar *loadstate = NULL;
-      const gchar *activestate = NULL;
-      const gchar *substate = NULL;
-      const gchar *followedby = NULL;
-      const gchar *objectpath = NULL;
-      const gchar *jobtype = NULL;
-      const gchar *jobobjectpath = NULL;
-      glong queuedjobs = 0;
-      g_autoptr (GVariantIter) iter = NULL;
-
-      g_variant_get (service_list, "(a(ssssssouso))", &iter);
-
-      while (g_variant_iter_loop (iter, "(ssssssouso)", &unitname, &description, &loadstate,
-                                  &activestate, &substate, &followedby, &objectpath, &queuedjobs,
-                                  &jobtype, &jobobjectpath))
-        {
-          if (unitname != NULL && objectpath != NULL && activestate != NULL && substate != NULL)
-            {
-              add_service (monitor, unitname, objectpath,
-                           rmg_mentry_active_state_from (activestate),
-                           rmg_mentry_active_substate_from (substate));
-            }
-        }
-    }
+  /* one call snapshots all service units and is ordered with the unit signals on the
+   * connection so no state change is lost between the snapshot and the subscription */
+  g_dbus_proxy_call (monitor->proxy, "ListUnitsByPatterns",
+                     g_variant_new ("(^as^as)", states, patterns),
+                     G_DBUS_CALL_FLAGS_NONE, -1, NULL, list_units_async_cb,
+                     rmg_monitor_ref (monitor));
 }
 
 static void
@@ -401,10 +569,35 @@ remove_notify_proxy_entry (gpointer _entry)
   g_free (_entry);
 }
 
+static void
+monitor_job_outcome_cb (RmgDEvent *event, gpointer _monitor)
+{
+  RmgMonitor *monitor = (RmgMonitor *)_monitor;
+  RmgMEntry *mentry = rmg_monitor_get_entry (monitor, event->service_name);
+
+  /* the entry owns the escalation state of its service */
+  if (mentry != NULL)
+    {
+      rmg_mentry_recovery_outcome (mentry, event->type == DEVENT_SERVICE_RECOVERED,
+                                   event->failure_reason);
+      rmg_devent_unref (event);
+    }
+  else if (event->type == DEVENT_SERVICE_RECOVERED)
+    rmg_dispatcher_push_service_event (monitor->dispatcher, event);
+  else
+    {
+      g_warning ("Restart of unmonitored service '%s' failed", event->service_name);
+      rmg_devent_unref (event);
+    }
+}
+
 RmgMonitor *
 rmg_monitor_new (RmgDispatcher *dispatcher)
 {
   RmgMonitor *monitor = (RmgMonitor *)g_source_new (&monitor_source_funcs, sizeof (RmgMonitor));
+  g_autoptr (GError) error = NULL;
+  GList *names = NULL;
+  gint64 batch_limit;
 
   g_assert (monitor);
   g_assert (dispatcher);
@@ -412,8 +605,73 @@ rmg_monitor_new (RmgDispatcher *dispatcher)
   g_ref_count_init (&monitor->rc);
 
   monitor->dispatcher = rmg_dispatcher_ref (dispatcher);
-  monitor->queue = g_async_queue_new_full (monitor_queue_destroy_notify);
+  rmg_executor_register_job_callback (dispatcher->executor, monitor_job_outcome_cb, monitor);
+  /* control events are few and must not be lost */
+  monitor->queue = rmg_eventqueue_new ("monitor", RMG_EVENTQUEUE_CONTROL_SIZE,
+                                       RMG_EVENTQUEUE_CONTROL_SIZE, EVENTQUEUE_OVERFLOW_GROW,
+                                       g_free);
+  g_source_add_unix_fd (RMG_EVENT_SOURCE (monitor), rmg_eventqueue_get_fd (monitor->queue),
+                        G_IO_IN);
   monitor->callback = monitor_source_callback;
+  monitor->start_time = g_get_monotonic_time ();
+
+  /* service names are atoms so the sets hash the pointers, the entries own the registered keys */
+  monitor->registered = g_hash_table_new (g_direct_hash, g_direct_equal);
+  monitor->recovery_units = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                   (GDestroyNotify)g_ref_string_release, NULL);
+  monitor->priority_queue = g_queue_new ();
+  monitor->normal_queue = g_queue_new ();
+
+  monitor->units = g_hash_table_new (g_str_hash, g_str_equal);
+
+  batch_limit = rmg_options_long_for (dispatcher->options, KEY_MONITOR_IDLE_BATCH);
+  monitor->batch_limit = (guint)CLAMP (batch_limit, 1, G_MAXUINT16);
+
+  names = rmg_journal_get_service_names (dispatcher->journal, &error);
+  if (error != NULL)
+    g_warning ("Fail to read recovery units for registration priority. Error %s", error->message);
+
+  for (GList *l = names; l != NULL; l = l->next)
+    g_hash_table_add (monitor->recovery_units, l->data);
+
+  g_list_free (names);
+
+  monitor->critical_units = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                   (GDestroyNotify)g_ref_string_release, NULL);
+  monitor->pidwatch = rmg_pidwatch_new ();
+
+  names = rmg_journal_get_critical_service_names (dispatcher->journal, NULL);
+  for (GList *l = names; l != NULL; l = l->next)
+    g_hash_table_add (monitor->critical_units, l->data);
+
+  g_list_free (names);
+
+  if (rmg_options_long_for (dispatcher->options, KEY_CGROUP_WATCH) > 0)
+    {
+      g_autoptr (GError) cgwatch_error = NULL;
+
+      monitor->cgwatch = rmg_cgwatch_new (&cgwatch_error);
+      if (cgwatch_error != NULL)
+        g_warning ("Fail to create cgroup watcher. Error %s", cgwatch_error->message);
+    }
+
+#ifdef WITH_SDBUS_MONITOR
+  {
+    g_autofree gchar *backend = rmg_options_string_for (dispatcher->options, KEY_MONITOR_BACKEND);
+
+    if (g_strcmp0 (backend, "sdbus") == 0)
+      {
+        g_autoptr (GError) sdbus_error = NULL;
+
+        monitor->sdmonitor = rmg_sdmonitor_new (&sdbus_error);
+        if (sdbus_error != NULL)
+          g_warning ("Fail to create sd-bus monitor, fallback to GDBus. Error %s",
+                     sdbus_error->message);
+        else
+          g_info ("Unit state monitoring using sd-bus backend");
+      }
+  }
+#endif
 
   g_source_set_callback (RMG_EVENT_SOURCE (monitor), NULL, monitor, monitor_source_destroy_notify);
   g_source_attach (RMG_EVENT_SOURCE (monitor), NULL);
@@ -437,12 +695,42 @@ rmg_monitor_unref (RmgMonitor *monitor)
   if (g_ref_count_dec (&monitor->rc) == TRUE)
     {
       if (monitor->dispatcher != NULL)
-        rmg_dispatcher_unref (monitor->dispatcher);
+        {
+          rmg_executor_register_job_callback (monitor->dispatcher->executor, NULL, NULL);
+          rmg_dispatcher_unref (monitor->dispatcher);
+        }
+
+      if (monitor->pump_source != 0)
+        g_source_remove (monitor->pump_source);
+
+      if (monitor->unit_subscription != 0)
+        g_dbus_connection_signal_unsubscribe (g_dbus_proxy_get_connection (monitor->proxy),
+                                              monitor->unit_subscription);
+
+      if (monitor->service_subscription != 0)
+        g_dbus_connection_signal_unsubscribe (g_dbus_proxy_get_connection (monitor->proxy),
+                                              monitor->service_subscription);
 
       if (monitor->proxy != NULL)
         g_object_unref (monitor->proxy);
 
-      g_async_queue_unref (monitor->queue);
+#ifdef WITH_SDBUS_MONITOR
+      if (monitor->sdmonitor != NULL)
+        rmg_sdmonitor_unref (monitor->sdmonitor);
+#endif
+
+      if (monitor->cgwatch != NULL)
+        rmg_cgwatch_unref (monitor->cgwatch);
+
+      rmg_pidwatch_unref (monitor->pidwatch);
+      g_hash_table_destroy (monitor->critical_units);
+
+      rmg_eventqueue_unref (monitor->queue);
+      g_queue_free_full (monitor->priority_queue, remove_service_entry);
+      g_queue_free_full (monitor->normal_queue, remove_service_entry);
+      g_hash_table_destroy (monitor->registered);
+      g_hash_table_destroy (monitor->units);
+      g_hash_table_destroy (monitor->recovery_units);
       g_list_free_full (monitor->services, remove_service_entry);
       g_list_free_full (monitor->notify_proxy, remove_notify_proxy_entry);
       g_source_unref (RMG_EVENT_SOURCE (monitor));
@@ -461,6 +749,23 @@ rmg_monitor_read_services (RmgMonitor *monitor)
   post_monitor_event (monitor, MONITOR_EVENT_READ_SERVICES);
 }
 
+RmgMEntry *
+rmg_monitor_get_entry (RmgMonitor *monitor, const gchar *service_name)
+{
+  RmgMEntry *entry = NULL;
+  gchar *name = NULL;
+
+  g_assert (monitor);
+  g_assert (service_name);
+
+  /* an atom of a registered name is the entry key, other names are not registered */
+  name = g_ref_string_new_intern (service_name);
+  entry = (RmgMEntry *)g_hash_table_lookup (monitor->registered, name);
+  g_ref_string_release (name);
+
+  return entry;
+}
+
 void
 rmg_monitor_register_proxy_available_callback (RmgMonitor *monitor,
                                                RmgMonitorProxyAvailableCallback callback,
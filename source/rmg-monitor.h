@@ -23,8 +23,15 @@
 
 #pragma once
 
+#include "rmg-cgwatch.h"
 #include "rmg-dispatcher.h"
+#include "rmg-eventqueue.h"
+#include "rmg-mentry.h"
+#include "rmg-pidwatch.h"
 #include "rmg-types.h"
+#ifdef WITH_SDBUS_MONITOR
+#include "rmg-sdmonitor.h"
+#endif
 
 #include <gio/gio.h>
 #include <glib.h>
@@ -71,13 +78,31 @@ typedef struct _RmgMonitorNotifyProxy
 typedef struct _RmgMonitor
 {
   GSource source;              /**< Event loop source */
-  GAsyncQueue *queue;          /**< Async queue */
+  RmgEventQueue *queue;        /**< Event queue */
   RmgMonitorCallback callback; /**< Callback function */
   RmgDispatcher *dispatcher;
   grefcount rc; /**< Reference counter variable  */
   GList *notify_proxy;
   GList *services;
   GDBusProxy *proxy;
+  GHashTable *registered;     /**< Entries of queued, pending and monitored units by name */
+  GHashTable *recovery_units; /**< Name atoms of units with a recovery unit */
+  GQueue *priority_queue;     /**< Queued registrations for units with a recovery unit */
+  GQueue *normal_queue;       /**< Queued registrations for all other units */
+  GHashTable *units;          /**< Entries by object path for unit signal routing */
+  guint unit_subscription;    /**< Unit PropertiesChanged subscription id */
+  guint service_subscription; /**< Service PropertiesChanged subscription id */
+  guint pump_source;          /**< Idle source registering queued units or 0 */
+  guint batch_limit;          /**< Units registered per idle batch */
+  gboolean services_read;     /**< Initial unit list read and queued registrations can start */
+  gboolean coverage_reached;  /**< All known units are monitored */
+  gint64 start_time;          /**< Monotonic time of monitor creation */
+  RmgCGWatch *cgwatch;        /**< Optional cgroup events watcher for recovery units */
+  GHashTable *critical_units; /**< Name atoms of units marked critical */
+  RmgPidWatch *pidwatch;      /**< Main process watcher for critical units */
+#ifdef WITH_SDBUS_MONITOR
+  RmgSDMonitor *sdmonitor; /**< sd-bus unit state backend, NULL if GDBus is used */
+#endif
 } RmgMonitor;
 
 /*
@@ -116,6 +141,14 @@ GDBusProxy *rmg_monitor_get_manager_proxy (RmgMonitor *monitor);
  */
 void rmg_monitor_read_services (RmgMonitor *monitor);
 
+/**
+ * @brief Get the entry of a service known to the monitor
+ * @param monitor Pointer to the monitor object
+ * @param service_name The service unit name
+ * @return The service entry or NULL if the service is not known
+ */
+RmgMEntry *rmg_monitor_get_entry (RmgMonitor *monitor, const gchar *service_name);
+
 /**
  * @brief Get existing services
  * @param monitor Pointer to the monitor object
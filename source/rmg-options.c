@@ -176,6 +176,49 @@ rmg_options_string_for (RmgOptions *opts, RmgOptionsKey key)
         }
       return g_strdup (RMG_IPC_SOCK_ADDR);
 
+    case KEY_MONITOR_BACKEND:
+      if (opts->has_conf)
+        {
+          gchar *tmp
+              = g_key_file_get_string (opts->conf, "recoverymanager", "MonitorBackend", NULL);
+
+          if (tmp != NULL)
+            return tmp;
+        }
+      return g_strdup (RMG_MONITOR_BACKEND);
+
+    case KEY_CRASH_SOURCE:
+      if (opts->has_conf)
+        {
+          gchar *tmp = g_key_file_get_string (opts->conf, "recoverymanager", "CrashSource", NULL);
+
+          if (tmp != NULL)
+            return tmp;
+        }
+      return g_strdup (RMG_CRASH_SOURCE);
+
+    case KEY_EVENT_QUEUE_OVERFLOW:
+      if (opts->has_conf)
+        {
+          gchar *tmp
+              = g_key_file_get_string (opts->conf, "recoverymanager", "EventQueueOverflow", NULL);
+
+          if (tmp != NULL)
+            return tmp;
+        }
+      return g_strdup (RMG_EVENT_QUEUE_OVERFLOW);
+
+    case KEY_DATA_RESET_MODE:
+      if (opts->has_conf)
+        {
+          gchar *tmp
+              = g_key_file_get_string (opts->conf, "recoverymanager", "DataResetMode", NULL);
+
+          if (tmp != NULL)
+            return tmp;
+        }
+      return g_strdup (RMG_DATA_RESET_MODE);
+
     default:
       break;
     }
@@ -235,6 +278,114 @@ rmg_options_long_for (RmgOptions *opts, RmgOptionsKey key)
         value = RMG_INTEGRITY_CHECK_SEC;
       break;
 
+    case KEY_INTEGRITY_CHECK_MIN_SEC:
+      value = get_long_option (opts, "recoverymanager", "IntegrityCheckMinInterval", &error);
+      if (error != NULL)
+        value = RMG_INTEGRITY_CHECK_MIN_SEC;
+      break;
+
+    case KEY_INTEGRITY_CHECK_MAX_SEC:
+      value = get_long_option (opts, "recoverymanager", "IntegrityCheckMaxInterval", &error);
+      if (error != NULL)
+        value = RMG_INTEGRITY_CHECK_MAX_SEC;
+      break;
+
+    case KEY_PROBE_CONCURRENCY:
+      value = get_long_option (opts, "recoverymanager", "ProbeConcurrency", &error);
+      if (error != NULL)
+        value = RMG_PROBE_CONCURRENCY;
+      break;
+
+    case KEY_EVENT_QUEUE_CAPACITY:
+      value = get_long_option (opts, "recoverymanager", "EventQueueCapacity", &error);
+      if (error != NULL)
+        value = RMG_EVENT_QUEUE_CAPACITY;
+      break;
+
+    case KEY_EVENT_QUEUE_BATCH:
+      value = get_long_option (opts, "recoverymanager", "EventQueueBatch", &error);
+      if (error != NULL)
+        value = RMG_EVENT_QUEUE_BATCH;
+      break;
+
+    case KEY_EVENT_POOL_CAPACITY:
+      value = get_long_option (opts, "recoverymanager", "EventPoolCapacity", &error);
+      if (error != NULL)
+        value = RMG_EVENT_POOL_CAPACITY;
+      break;
+
+    case KEY_COMMAND_TIMEOUT_SEC:
+      value = get_long_option (opts, "recoverymanager", "CommandTimeout", &error);
+      if (error != NULL)
+        value = RMG_COMMAND_TIMEOUT_SEC;
+      break;
+
+    case KEY_DATA_RESET_WORKERS:
+      value = get_long_option (opts, "recoverymanager", "DataResetWorkers", &error);
+      if (error != NULL)
+        value = RMG_DATA_RESET_WORKERS;
+      break;
+
+    case KEY_DATA_REAPER_RATE:
+      value = get_long_option (opts, "recoverymanager", "DataReaperRate", &error);
+      if (error != NULL)
+        value = RMG_DATA_REAPER_RATE;
+      break;
+
+    case KEY_EXECUTOR_WORKERS:
+      value = get_long_option (opts, "recoverymanager", "ExecutorWorkers", &error);
+      if (error != NULL)
+        value = RMG_EXECUTOR_WORKERS;
+      break;
+
+    case KEY_MONITOR_IDLE_BATCH:
+      value = get_long_option (opts, "recoverymanager", "MonitorIdleBatch", &error);
+      if (error != NULL)
+        value = RMG_MONITOR_IDLE_BATCH;
+      break;
+
+    case KEY_CGROUP_WATCH:
+      value = get_long_option (opts, "recoverymanager", "CgroupEventsWatch", &error);
+      if (error != NULL)
+        value = RMG_CGROUP_WATCH;
+      break;
+
+    case KEY_CRASH_DEBOUNCE_MS:
+      value = get_long_option (opts, "recoverymanager", "CrashDebounceWindow", &error);
+      if (error != NULL)
+        value = RMG_CRASH_DEBOUNCE_MS;
+      break;
+
+    case KEY_FLAP_WINDOW_SEC:
+      value = get_long_option (opts, "recoverymanager", "FlapDetectWindow", &error);
+      if (error != NULL)
+        value = RMG_FLAP_WINDOW_SEC;
+      break;
+
+    case KEY_FLAP_THRESHOLD:
+      value = get_long_option (opts, "recoverymanager", "FlapDetectThreshold", &error);
+      if (error != NULL)
+        value = RMG_FLAP_THRESHOLD;
+      break;
+
+    case KEY_CRASH_DEDUP_WINDOW_MS:
+      value = get_long_option (opts, "recoverymanager", "CrashDedupWindow", &error);
+      if (error != NULL)
+        value = RMG_CRASH_DEDUP_WINDOW_MS;
+      break;
+
+    case KEY_CRASH_DEDUP_CAPACITY:
+      value = get_long_option (opts, "recoverymanager", "CrashDedupCapacity", &error);
+      if (error != NULL)
+        value = RMG_CRASH_DEDUP_CAPACITY;
+      break;
+
+    case KEY_PID_CACHE_CAPACITY:
+      value = get_long_option (opts, "recoverymanager", "PidCacheCapacity", &error);
+      if (error != NULL)
+        value = RMG_PID_CACHE_CAPACITY;
+      break;
+
     default:
       break;
     }
@@ -44,7 +44,29 @@ typedef enum _RmgOptionsKey
   KEY_FACTORY_RESET_CMD,
   KEY_IPC_SOCK_ADDR,
   KEY_IPC_TIMEOUT_SEC,
-  KEY_INTEGRITY_CHECK_SEC
+  KEY_INTEGRITY_CHECK_SEC,
+  KEY_MONITOR_BACKEND,
+  KEY_MONITOR_IDLE_BATCH,
+  KEY_CGROUP_WATCH,
+  KEY_CRASH_DEBOUNCE_MS,
+  KEY_FLAP_WINDOW_SEC,
+  KEY_FLAP_THRESHOLD,
+  KEY_CRASH_SOURCE,
+  KEY_CRASH_DEDUP_WINDOW_MS,
+  KEY_CRASH_DEDUP_CAPACITY,
+  KEY_PID_CACHE_CAPACITY,
+  KEY_INTEGRITY_CHECK_MIN_SEC,
+  KEY_INTEGRITY_CHECK_MAX_SEC,
+  KEY_PROBE_CONCURRENCY,
+  KEY_EVENT_QUEUE_CAPACITY,
+  KEY_EVENT_QUEUE_BATCH,
+  KEY_EVENT_QUEUE_OVERFLOW,
+  KEY_EVENT_POOL_CAPACITY,
+  KEY_COMMAND_TIMEOUT_SEC,
+  KEY_DATA_RESET_MODE,
+  KEY_DATA_RESET_WORKERS,
+  KEY_DATA_REAPER_RATE,
+  KEY_EXECUTOR_WORKERS
 } RmgOptionsKey;
 
 /**
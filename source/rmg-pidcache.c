@@ -0,0 +1,306 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-pidcache.c
+ */
+
+#include "rmg-pidcache.h"
+#include "rmg-batchread.h"
+
+#include <string.h>
+
+/**
+ * @struct RmgPidCacheProcess
+ * @brief Cached process
+ */
+typedef struct _RmgPidCacheProcess
+{
+  pid_t tgid;  /**< Process id */
+  gchar *unit; /**< Owning service atom or NULL until resolved on exec */
+  GList *link; /**< Cache order queue link */
+} RmgPidCacheProcess;
+
+static void
+process_free (gpointer _process)
+{
+  RmgPidCacheProcess *process = (RmgPidCacheProcess *)_process;
+
+  g_clear_pointer (&process->unit, g_ref_string_release);
+  g_free (process);
+}
+
+static gchar *
+unit_from_cgroup_path (const gchar *path)
+{
+  const gchar *unit = NULL;
+  gchar *atom = NULL;
+  gchar **parts = NULL;
+
+  /* services of a container are not known to the host service manager */
+  if (strstr (path, "/machine.slice/") != NULL)
+    return NULL;
+
+  parts = g_strsplit (path, "/", -1);
+
+  /* the innermost service wins for delegated subtrees */
+  for (gint i = 0; parts[i] != NULL; i++)
+    {
+      if (g_str_has_suffix (parts[i], ".service"))
+        unit = parts[i];
+    }
+
+  if (unit != NULL)
+    atom = g_ref_string_new_intern (unit);
+
+  g_strfreev (parts);
+
+  return atom;
+}
+
+static gchar *
+unit_from_cgroup (const gchar *content)
+{
+  gchar *unit = NULL;
+  gchar **lines = g_strsplit (content, "\n", -1);
+
+  /* lines are hierarchy-id:controllers:path, the unified and the named systemd
+   * hierarchies both place the process below its unit */
+  for (gint i = 0; lines[i] != NULL && unit == NULL; i++)
+    {
+      const gchar *path = strchr (lines[i], ':');
+
+      if (path != NULL)
+        path = strchr (path + 1, ':');
+
+      if (path != NULL)
+        unit = unit_from_cgroup_path (path + 1);
+    }
+
+  g_strfreev (lines);
+
+  return unit;
+}
+
+static gchar *
+unit_from_procfs (pid_t tgid)
+{
+  g_autofree gchar *cgroup_file = g_strdup_printf ("/proc/%d/cgroup", tgid);
+  g_autofree gchar *content = NULL;
+
+  if (!g_file_get_contents (cgroup_file, &content, NULL, NULL))
+    return NULL;
+
+  return unit_from_cgroup (content);
+}
+
+static void
+cache_insert (RmgPidCache *cache, pid_t tgid, gchar *unit)
+{
+  RmgPidCacheProcess *process = g_hash_table_lookup (cache->processes, GINT_TO_POINTER (tgid));
+
+  /* pid reuse without an exit event, the kernel drops events on overrun */
+  if (process != NULL)
+    {
+      g_clear_pointer (&process->unit, g_ref_string_release);
+      process->unit = unit;
+      return;
+    }
+
+  if (g_queue_get_length (cache->order) >= cache->capacity)
+    {
+      RmgPidCacheProcess *oldest = g_queue_pop_head (cache->order);
+
+      g_hash_table_remove (cache->processes, GINT_TO_POINTER (oldest->tgid));
+    }
+
+  process = g_new0 (RmgPidCacheProcess, 1);
+  process->tgid = tgid;
+  process->unit = unit;
+
+  g_queue_push_tail (cache->order, process);
+  process->link = cache->order->tail;
+  g_hash_table_insert (cache->processes, GINT_TO_POINTER (tgid), process);
+}
+
+static void
+seed_read_callback (gpointer tag, const gchar *content, gsize length, gint error, gpointer _cache)
+{
+  RmgPidCache *cache = (RmgPidCache *)_cache;
+  pid_t tgid = (pid_t)GPOINTER_TO_INT (tag);
+  gchar *unit = NULL;
+
+  RMG_UNUSED (length);
+
+  /* the process exited since the scan */
+  if (error != 0)
+    return;
+
+  /* processes tracked from events since the scan are more recent */
+  if (g_hash_table_contains (cache->processes, GINT_TO_POINTER (tgid)))
+    return;
+
+  unit = unit_from_cgroup (content);
+  if (unit != NULL)
+    cache_insert (cache, tgid, unit);
+}
+
+static void
+seed_done_callback (gpointer _cache)
+{
+  RmgPidCache *cache = (RmgPidCache *)_cache;
+
+  g_debug ("Pid cache seeded with %u service processes", g_hash_table_size (cache->processes));
+}
+
+RmgPidCache *
+rmg_pidcache_new (guint capacity)
+{
+  RmgPidCache *cache = g_new0 (RmgPidCache, 1);
+
+  g_ref_count_init (&cache->rc);
+
+  cache->capacity = MAX (capacity, 1);
+  cache->processes = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, process_free);
+  cache->order = g_queue_new ();
+
+  return cache;
+}
+
+RmgPidCache *
+rmg_pidcache_ref (RmgPidCache *cache)
+{
+  g_assert (cache);
+  g_ref_count_inc (&cache->rc);
+  return cache;
+}
+
+void
+rmg_pidcache_unref (RmgPidCache *cache)
+{
+  g_assert (cache);
+
+  if (g_ref_count_dec (&cache->rc) == TRUE)
+    {
+      g_queue_free (cache->order);
+      g_hash_table_destroy (cache->processes);
+      g_free (cache);
+    }
+}
+
+void
+rmg_pidcache_seed (RmgPidCache *cache)
+{
+  g_autoptr (GError) error = NULL;
+  RmgBatchRead *batch = NULL;
+  const gchar *nfile = NULL;
+  GDir *gdir = NULL;
+
+  g_assert (cache);
+
+  gdir = g_dir_open ("/proc", 0, &error);
+  if (error != NULL)
+    {
+      g_warning ("Fail to open proc directory. Error %s", error->message);
+      return;
+    }
+
+  batch = rmg_batchread_new (seed_read_callback, seed_done_callback, rmg_pidcache_ref (cache),
+                             (GDestroyNotify)rmg_pidcache_unref);
+
+  while ((nfile = g_dir_read_name (gdir)) != NULL)
+    {
+      gint64 tgid = g_ascii_strtoll (nfile, NULL, 10);
+
+      if (tgid > 1)
+        {
+          g_autofree gchar *cgroup_file = g_strdup_printf ("/proc/%s/cgroup", nfile);
+          rmg_batchread_add (batch, cgroup_file, GINT_TO_POINTER ((gint)tgid));
+        }
+    }
+
+  g_dir_close (gdir);
+
+  rmg_batchread_submit (batch);
+}
+
+void
+rmg_pidcache_fork (RmgPidCache *cache, pid_t parent_tgid, pid_t child_tgid)
+{
+  RmgPidCacheProcess *parent = NULL;
+
+  g_assert (cache);
+
+  /* the unit of a process forked by the service manager is known on exec */
+  if (parent_tgid == 1)
+    {
+      cache_insert (cache, child_tgid, NULL);
+      return;
+    }
+
+  parent = g_hash_table_lookup (cache->processes, GINT_TO_POINTER (parent_tgid));
+  if (parent != NULL && parent->unit != NULL)
+    cache_insert (cache, child_tgid, g_ref_string_acquire (parent->unit));
+}
+
+void
+rmg_pidcache_exec (RmgPidCache *cache, pid_t tgid)
+{
+  RmgPidCacheProcess *process = NULL;
+
+  g_assert (cache);
+
+  process = g_hash_table_lookup (cache->processes, GINT_TO_POINTER (tgid));
+  if (process != NULL && process->unit == NULL)
+    process->unit = unit_from_procfs (tgid);
+}
+
+gchar *
+rmg_pidcache_lookup (RmgPidCache *cache, pid_t tgid)
+{
+  RmgPidCacheProcess *process = NULL;
+
+  g_assert (cache);
+
+  process = g_hash_table_lookup (cache->processes, GINT_TO_POINTER (tgid));
+  if (process != NULL && process->unit != NULL)
+    {
+      cache->hits++;
+      return g_ref_string_acquire (process->unit);
+    }
+
+  cache->misses++;
+
+  return unit_from_procfs (tgid);
+}
+
+void
+rmg_pidcache_remove (RmgPidCache *cache, pid_t tgid)
+{
+  RmgPidCacheProcess *process = NULL;
+
+  g_assert (cache);
+
+  process = g_hash_table_lookup (cache->processes, GINT_TO_POINTER (tgid));
+  if (process == NULL)
+    return;
+
+  g_queue_delete_link (cache->order, process->link);
+  g_hash_table_remove (cache->processes, GINT_TO_POINTER (tgid));
+}
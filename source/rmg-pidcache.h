@@ -0,0 +1,111 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-pidcache.h
+ */
+
+#pragma once
+
+#include "rmg-types.h"
+
+#include <glib.h>
+#include <sys/types.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgPidCache
+ * @brief Bounded map of host processes to the systemd service owning them
+ */
+typedef struct _RmgPidCache
+{
+  GHashTable *processes; /**< Cached processes by pid */
+  GQueue *order;         /**< Cached processes, oldest first */
+  guint capacity;        /**< Maximum number of cached processes */
+  guint64 hits;          /**< Lookups answered from the cache */
+  guint64 misses;        /**< Lookups resolved from procfs */
+  grefcount rc;          /**< Reference counter variable  */
+} RmgPidCache;
+
+/*
+ * @brief Create a new pid cache object
+ * @param capacity Maximum number of cached processes
+ * @return A new RmgPidCache object
+ */
+RmgPidCache *rmg_pidcache_new (guint capacity);
+
+/**
+ * @brief Aquire pid cache object
+ * @param cache Pointer to the pid cache object
+ */
+RmgPidCache *rmg_pidcache_ref (RmgPidCache *cache);
+
+/**
+ * @brief Release pid cache object
+ * @param cache Pointer to the pid cache object
+ */
+void rmg_pidcache_unref (RmgPidCache *cache);
+
+/**
+ * @brief Add the service processes already running
+ * The cgroup of every process is read in batches from the main loop
+ * @param cache Pointer to the pid cache object
+ */
+void rmg_pidcache_seed (RmgPidCache *cache);
+
+/**
+ * @brief Track a new process
+ * Processes started by the service manager and their descendants are cached, the
+ * child of a cached process inherits the parent unit without reading procfs
+ * @param cache Pointer to the pid cache object
+ * @param parent_tgid The parent process id
+ * @param child_tgid The new process id
+ */
+void rmg_pidcache_fork (RmgPidCache *cache, pid_t parent_tgid, pid_t child_tgid);
+
+/**
+ * @brief Resolve the unit of a cached process on exec
+ * The service manager moves a new process in the unit cgroup before exec so the
+ * cgroup is read once at this point
+ * @param cache Pointer to the pid cache object
+ * @param tgid The process id
+ */
+void rmg_pidcache_exec (RmgPidCache *cache, pid_t tgid);
+
+/**
+ * @brief Get the service owning a process
+ * A process not in the cache is resolved from procfs and not added
+ * @param cache Pointer to the pid cache object
+ * @param tgid The process id
+ * @return A reference on the service name atom released with g_ref_string_release, or NULL if
+ * the process is not owned by a host service
+ */
+gchar *rmg_pidcache_lookup (RmgPidCache *cache, pid_t tgid);
+
+/**
+ * @brief Forget an exited process
+ * @param cache Pointer to the pid cache object
+ * @param tgid The process id
+ */
+void rmg_pidcache_remove (RmgPidCache *cache, pid_t tgid);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgPidCache, rmg_pidcache_unref);
+
+G_END_DECLS
@@ -0,0 +1,252 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-pidwatch.c
+ */
+
+#include "rmg-pidwatch.h"
+
+#include <errno.h>
+#include <glib-unix.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+extern const gchar *sd_dbus_name;
+
+/**
+ * @brief Read a Service interface property for the entry unit
+ */
+static void pidwatch_entry_get_property (RmgPidWatchEntry *entry, const gchar *property,
+                                         GAsyncReadyCallback callback);
+
+static void
+pidwatch_entry_disarm (RmgPidWatchEntry *entry)
+{
+  if (entry->source_id > 0)
+    {
+      g_source_remove (entry->source_id);
+      entry->source_id = 0;
+    }
+
+  if (entry->pidfd >= 0)
+    {
+      close (entry->pidfd);
+      entry->pidfd = -1;
+    }
+}
+
+static gboolean
+on_main_pid_exit (gint fd, GIOCondition condition, gpointer user_data)
+{
+  RmgPidWatchEntry *entry = (RmgPidWatchEntry *)user_data;
+  siginfo_t info = { 0 };
+  gboolean abnormal = FALSE;
+
+  RMG_UNUSED (condition);
+
+  /* the exit status is only readable here if we are allowed to reap the process, otherwise
+   * the ExecMainCode and ExecMainStatus values follow with the Service properties signal */
+  if (waitid ((idtype_t)P_PIDFD, (id_t)fd, &info, WEXITED | WNOHANG) == 0 && info.si_pid != 0)
+    {
+      g_info ("Service '%s' main process %u exit code %d status %d", entry->mentry->service_name,
+              entry->main_pid, info.si_code, info.si_status);
+      rmg_mentry_set_exec_main_status (entry->mentry, info.si_code, info.si_status);
+
+      abnormal = info.si_code == CLD_KILLED || info.si_code == CLD_DUMPED
+                 || (info.si_code == CLD_EXITED && info.si_status != 0);
+    }
+
+  /* a clean exit, a stop or an unknown status is left to the state reported by systemd */
+  if (abnormal && entry->mentry->active_state != SERVICE_STATE_DEACTIVATING)
+    rmg_mentry_provisional_crash (entry->mentry, "main process exit");
+  else
+    {
+      g_debug ("Service '%s' main process %u exited, wait for systemd state",
+               entry->mentry->service_name, entry->main_pid);
+    }
+
+  close (entry->pidfd);
+  entry->pidfd = -1;
+  entry->source_id = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+main_pid_ready_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgPidWatchEntry *entry = (RmgPidWatchEntry *)user_data;
+  RmgPidWatch *pidwatch = (RmgPidWatch *)entry->pidwatch;
+  g_autoptr (GVariant) response = NULL;
+  g_autoptr (GVariant) value = NULL;
+  g_autoptr (GError) error = NULL;
+
+  entry->resolving = FALSE;
+
+  response = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &error);
+  if (error != NULL)
+    {
+      g_warning ("Fail to read MainPID for service '%s'. Error %s", entry->mentry->service_name,
+                 error->message);
+    }
+  else
+    {
+      gint pidfd;
+
+      g_variant_get (response, "(v)", &value);
+      entry->main_pid = g_variant_get_uint32 (value);
+
+      if (entry->main_pid > 0 && entry->source_id == 0)
+        {
+          pidfd = (gint)syscall (SYS_pidfd_open, (pid_t)entry->main_pid, 0);
+          if (pidfd < 0)
+            {
+              g_warning ("Fail to open pidfd for service '%s' pid %u. Error %s",
+                         entry->mentry->service_name, entry->main_pid, g_strerror (errno));
+            }
+          else
+            {
+              entry->pidfd = pidfd;
+              entry->source_id = g_unix_fd_add (pidfd, G_IO_IN, on_main_pid_exit, entry);
+
+              g_debug ("Watching main process %u for service '%s'", entry->main_pid,
+                       entry->mentry->service_name);
+            }
+        }
+    }
+
+  rmg_pidwatch_unref (pidwatch);
+}
+
+static void
+pidwatch_entry_get_property (RmgPidWatchEntry *entry, const gchar *property,
+                             GAsyncReadyCallback callback)
+{
+  /* the owner is kept alive until the reply callback releases it */
+  rmg_pidwatch_ref ((RmgPidWatch *)entry->pidwatch);
+
+  g_dbus_connection_call (g_dbus_proxy_get_connection (entry->mentry->manager_proxy), sd_dbus_name,
+                          entry->mentry->object_path, "org.freedesktop.DBus.Properties", "Get",
+                          g_variant_new ("(ss)", "org.freedesktop.systemd1.Service", property),
+                          G_VARIANT_TYPE ("(v)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, callback,
+                          (gpointer)entry);
+}
+
+static void
+pidwatch_entry_arm (RmgPidWatchEntry *entry)
+{
+  if (entry->source_id > 0 || entry->resolving || entry->mentry->manager_proxy == NULL)
+    return;
+
+  entry->resolving = TRUE;
+  pidwatch_entry_get_property (entry, "MainPID", main_pid_ready_cb);
+}
+
+static void
+remove_watch_entry (gpointer _entry)
+{
+  RmgPidWatchEntry *entry = (RmgPidWatchEntry *)_entry;
+
+  pidwatch_entry_disarm (entry);
+  rmg_mentry_unref (entry->mentry);
+  g_free (entry);
+}
+
+RmgPidWatch *
+rmg_pidwatch_new (void)
+{
+  RmgPidWatch *pidwatch = g_new0 (RmgPidWatch, 1);
+
+  g_assert (pidwatch);
+
+  g_ref_count_init (&pidwatch->rc);
+
+  pidwatch->entries
+      = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, remove_watch_entry);
+
+  return pidwatch;
+}
+
+RmgPidWatch *
+rmg_pidwatch_ref (RmgPidWatch *pidwatch)
+{
+  g_assert (pidwatch);
+  g_ref_count_inc (&pidwatch->rc);
+  return pidwatch;
+}
+
+void
+rmg_pidwatch_unref (RmgPidWatch *pidwatch)
+{
+  g_assert (pidwatch);
+
+  if (g_ref_count_dec (&pidwatch->rc) == TRUE)
+    {
+      g_hash_table_destroy (pidwatch->entries);
+      g_free (pidwatch);
+    }
+}
+
+void
+rmg_pidwatch_add_entry (RmgPidWatch *pidwatch, RmgMEntry *mentry)
+{
+  RmgPidWatchEntry *entry = NULL;
+
+  g_assert (pidwatch);
+  g_assert (mentry);
+
+  if (g_hash_table_contains (pidwatch->entries, mentry->service_name))
+    return;
+
+  entry = g_new0 (RmgPidWatchEntry, 1);
+
+  entry->mentry = rmg_mentry_ref (mentry);
+  entry->pidwatch = pidwatch;
+  entry->pidfd = -1;
+
+  g_hash_table_insert (pidwatch->entries, mentry->service_name, entry);
+
+  if (mentry->active_state == SERVICE_STATE_ACTIVE)
+    pidwatch_entry_arm (entry);
+}
+
+void
+rmg_pidwatch_rearm (RmgPidWatch *pidwatch, RmgMEntry *mentry)
+{
+  RmgPidWatchEntry *entry = NULL;
+
+  g_assert (pidwatch);
+  g_assert (mentry);
+
+  entry = g_hash_table_lookup (pidwatch->entries, mentry->service_name);
+  if (entry != NULL)
+    pidwatch_entry_arm (entry);
+}
@@ -0,0 +1,91 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-pidwatch.h
+ */
+
+#pragma once
+
+#include "rmg-mentry.h"
+#include "rmg-types.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgPidWatchEntry
+ * @brief Main process watch for one critical unit
+ */
+typedef struct _RmgPidWatchEntry
+{
+  RmgMEntry *mentry;  /**< The monitored unit entry */
+  gpointer pidwatch;  /**< Back reference to the owner */
+  gint pidfd;         /**< Process descriptor for the unit main process or -1 */
+  guint source_id;    /**< Main loop source watching pidfd or 0 */
+  guint32 main_pid;   /**< The watched main process id */
+  gboolean resolving; /**< MainPID property read in progress */
+} RmgPidWatchEntry;
+
+/**
+ * @struct RmgPidWatch
+ * @brief The RmgPidWatch opaque data structure
+ */
+typedef struct _RmgPidWatch
+{
+  GHashTable *entries; /**< Watch entries indexed by service name atom */
+  grefcount rc;        /**< Reference counter variable  */
+} RmgPidWatch;
+
+/*
+ * @brief Create a new pid watch object
+ * @return On success return a new RmgPidWatch object
+ */
+RmgPidWatch *rmg_pidwatch_new (void);
+
+/**
+ * @brief Aquire pidwatch object
+ * @param pidwatch Pointer to the pidwatch object
+ */
+RmgPidWatch *rmg_pidwatch_ref (RmgPidWatch *pidwatch);
+
+/**
+ * @brief Release pidwatch object
+ * @param pidwatch Pointer to the pidwatch object
+ */
+void rmg_pidwatch_unref (RmgPidWatch *pidwatch);
+
+/**
+ * @brief Watch the main process of a critical unit
+ * @param pidwatch Pointer to the pidwatch object
+ * @param mentry The monitor entry, a reference is kept by pidwatch
+ */
+void rmg_pidwatch_add_entry (RmgPidWatch *pidwatch, RmgMEntry *mentry);
+
+/**
+ * @brief Re-arm the main process watch after the unit started again
+ * @param pidwatch Pointer to the pidwatch object
+ * @param mentry The monitor entry
+ */
+void rmg_pidwatch_rearm (RmgPidWatch *pidwatch, RmgMEntry *mentry);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgPidWatch, rmg_pidwatch_unref);
+
+G_END_DECLS
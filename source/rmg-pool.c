@@ -0,0 +1,166 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-pool.c
+ */
+
+#include "rmg-pool.h"
+
+#include <string.h>
+
+/* blocks keep the alignment of a heap allocation */
+#define POOL_BLOCK_ALIGN (2 * sizeof (gpointer))
+
+static gboolean
+pool_owns (RmgPool *pool, gpointer block)
+{
+  return (guint8 *)block >= pool->slab
+         && (guint8 *)block < pool->slab + pool->block_size * pool->capacity;
+}
+
+RmgPool *
+rmg_pool_new (const gchar *name, gsize block_size, guint capacity)
+{
+  RmgPool *pool = g_new0 (RmgPool, 1);
+
+  g_assert (name);
+  g_assert (block_size > 0);
+
+  g_ref_count_init (&pool->rc);
+  g_mutex_init (&pool->lock);
+
+  pool->name = g_intern_string (name);
+  pool->block_size = (block_size + POOL_BLOCK_ALIGN - 1) & ~(POOL_BLOCK_ALIGN - 1);
+  pool->capacity = capacity;
+  pool->slab = g_malloc (pool->block_size * capacity);
+
+  /* the free list is built so the first blocks are handed out first */
+  for (guint i = capacity; i > 0; i--)
+    {
+      gpointer block = pool->slab + pool->block_size * (i - 1);
+
+      *(gpointer *)block = pool->free_blocks;
+      pool->free_blocks = block;
+    }
+
+  return pool;
+}
+
+RmgPool *
+rmg_pool_ref (RmgPool *pool)
+{
+  g_assert (pool);
+  g_ref_count_inc (&pool->rc);
+  return pool;
+}
+
+void
+rmg_pool_unref (RmgPool *pool)
+{
+  g_assert (pool);
+
+  if (g_ref_count_dec (&pool->rc) == TRUE)
+    {
+      g_mutex_clear (&pool->lock);
+      g_free (pool->slab);
+      g_free (pool);
+    }
+}
+
+gpointer
+rmg_pool_alloc0 (RmgPool *pool)
+{
+  gpointer block = NULL;
+  guint64 heap_allocs = 0;
+
+  g_assert (pool);
+
+  g_mutex_lock (&pool->lock);
+
+  if (pool->free_blocks != NULL)
+    {
+      block = pool->free_blocks;
+      pool->free_blocks = *(gpointer *)block;
+      pool->slab_allocs++;
+      pool->in_use++;
+      pool->max_in_use = MAX (pool->max_in_use, pool->in_use);
+    }
+  else
+    heap_allocs = ++pool->heap_allocs;
+
+  g_mutex_unlock (&pool->lock);
+
+  if (block == NULL)
+    {
+      if (heap_allocs == 1)
+        g_info ("Pool %s exhausted at %u blocks, falling back to the heap", pool->name,
+                pool->capacity);
+
+      return g_malloc0 (pool->block_size);
+    }
+
+  memset (block, 0, pool->block_size);
+
+  return block;
+}
+
+guint
+rmg_pool_report (RmgPool *pool)
+{
+  guint in_use;
+
+  g_assert (pool);
+
+  g_mutex_lock (&pool->lock);
+
+  in_use = pool->in_use;
+  g_info ("Pool %s served %lu allocations from the slab and %lu from the heap, "
+          "max in use %u of %u, %u still in use",
+          pool->name, (gulong)pool->slab_allocs, (gulong)pool->heap_allocs, pool->max_in_use,
+          pool->capacity, in_use);
+
+  g_mutex_unlock (&pool->lock);
+
+  return in_use;
+}
+
+void
+rmg_pool_free (RmgPool *pool, gpointer block)
+{
+  g_assert (pool);
+
+  if (block == NULL)
+    return;
+
+  /* blocks from the heap fallback are returned to the heap */
+  if (!pool_owns (pool, block))
+    {
+      g_free (block);
+      return;
+    }
+
+  g_mutex_lock (&pool->lock);
+
+  *(gpointer *)block = pool->free_blocks;
+  pool->free_blocks = block;
+  pool->in_use--;
+
+  g_mutex_unlock (&pool->lock);
+}
@@ -0,0 +1,96 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-pool.h
+ */
+
+#pragma once
+
+#include "rmg-types.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgPool
+ * @brief Fixed capacity pool of equally sized blocks with a heap fallback
+ */
+typedef struct _RmgPool
+{
+  GMutex lock;          /**< Protects the free list and the counters */
+  const gchar *name;    /**< Interned pool name used in logs */
+  gsize block_size;     /**< Aligned block size */
+  guint capacity;       /**< Blocks in the slab */
+  guint8 *slab;         /**< Preallocated blocks */
+  gpointer free_blocks; /**< Free slab blocks linked through their first word */
+  guint in_use;         /**< Slab blocks allocated */
+  guint max_in_use;     /**< Highest slab blocks allocated */
+  guint64 slab_allocs;  /**< Allocations served from the slab */
+  guint64 heap_allocs;  /**< Allocations falling back to the heap */
+  grefcount rc;         /**< Reference counter variable  */
+} RmgPool;
+
+/*
+ * @brief Create a new pool object
+ * @param name The pool name used in logs
+ * @param block_size The size of the pooled objects
+ * @param capacity The number of objects preallocated
+ * @return A new RmgPool object
+ */
+RmgPool *rmg_pool_new (const gchar *name, gsize block_size, guint capacity);
+
+/**
+ * @brief Aquire pool object
+ * @param pool Pointer to the pool object
+ */
+RmgPool *rmg_pool_ref (RmgPool *pool);
+
+/**
+ * @brief Release pool object
+ * Blocks still allocated from the slab must not be used afterwards
+ * @param pool Pointer to the pool object
+ */
+void rmg_pool_unref (RmgPool *pool);
+
+/**
+ * @brief Allocate a zeroed block, safe to call from any thread
+ * @param pool Pointer to the pool object
+ * @return The new block
+ */
+gpointer rmg_pool_alloc0 (RmgPool *pool);
+
+/**
+ * @brief Log the pool counters
+ * @param pool Pointer to the pool object
+ * @return The number of slab blocks still allocated
+ */
+guint rmg_pool_report (RmgPool *pool);
+
+/**
+ * @brief Release a block allocated from the pool
+ * @param pool Pointer to the pool object
+ * @param block The block to release
+ */
+void rmg_pool_free (RmgPool *pool, gpointer block);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgPool, rmg_pool_unref);
+
+G_END_DECLS
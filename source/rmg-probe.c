@@ -0,0 +1,357 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-probe.c
+ */
+
+#include "rmg-probe.h"
+#include "rmg-utils.h"
+
+#include <errno.h>
+#include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+static void
+probe_finish (RmgProbe *probe)
+{
+  probe->running = FALSE;
+  probe->callback = NULL;
+  probe->user_data = NULL;
+
+  if (probe->timeout_source != 0)
+    {
+      g_source_remove (probe->timeout_source);
+      probe->timeout_source = 0;
+    }
+
+  g_clear_object (&probe->cancellable);
+  g_clear_object (&probe->subprocess);
+}
+
+static void
+probe_complete (RmgProbe *probe, gboolean healthy, const gchar *detail)
+{
+  RmgProbeCallback callback = probe->callback;
+  gpointer user_data = probe->user_data;
+
+  if (!probe->running)
+    return;
+
+  if (!healthy)
+    {
+      g_debug ("Probe %s '%s' of service '%s' failed: %s", rmg_utils_probe_name (probe->type),
+               probe->target, probe->service_name, detail != NULL ? detail : "unhealthy");
+    }
+
+  probe_finish (probe);
+  callback (probe, healthy, user_data);
+}
+
+static gboolean
+probe_timeout_cb (gpointer _probe)
+{
+  RmgProbe *probe = (RmgProbe *)_probe;
+
+  probe->timeout_source = 0;
+
+  if (probe->subprocess != NULL)
+    g_subprocess_force_exit (probe->subprocess);
+
+  /* the pending operation completes as cancelled and is dropped */
+  g_cancellable_cancel (probe->cancellable);
+  probe_complete (probe, FALSE, "timed out");
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+probe_result_cb (gpointer _probe)
+{
+  RmgProbe *probe = (RmgProbe *)_probe;
+
+  probe->timeout_source = 0;
+  probe_complete (probe, probe->healthy, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+probe_complete_later (RmgProbe *probe, gboolean healthy, const gchar *detail)
+{
+  if (!healthy)
+    {
+      g_debug ("Probe %s '%s' of service '%s' failed: %s", rmg_utils_probe_name (probe->type),
+               probe->target, probe->service_name, detail);
+    }
+
+  /* the result is reported from the main context so the caller is never reentered */
+  if (probe->timeout_source != 0)
+    g_source_remove (probe->timeout_source);
+
+  probe->healthy = healthy;
+  probe->timeout_source = g_idle_add (probe_result_cb, probe);
+}
+
+static void
+probe_connect_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgProbe *probe = (RmgProbe *)user_data;
+  g_autoptr (GSocketConnection) connection = NULL;
+  g_autoptr (GError) error = NULL;
+
+  /* the connection is closed when released */
+  connection = g_socket_client_connect_finish (G_SOCKET_CLIENT (source_object), res, &error);
+  if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    probe_complete (probe, connection != NULL, error != NULL ? error->message : NULL);
+
+  rmg_probe_unref (probe);
+}
+
+static void
+probe_run_connect (RmgProbe *probe)
+{
+  g_autoptr (GSocketClient) client = g_socket_client_new ();
+  g_autoptr (GSocketConnectable) connectable = NULL;
+  g_autoptr (GError) error = NULL;
+
+  if (g_str_has_prefix (probe->target, "unix:"))
+    {
+      connectable = G_SOCKET_CONNECTABLE (
+          g_unix_socket_address_new (probe->target + strlen ("unix:")));
+    }
+  else
+    {
+      const gchar *address = probe->target;
+
+      if (g_str_has_prefix (address, "tcp:"))
+        address += strlen ("tcp:");
+
+      connectable = g_network_address_parse (address, 0, &error);
+    }
+
+  if (connectable == NULL)
+    {
+      probe_complete_later (probe, FALSE, error != NULL ? error->message : "invalid address");
+      return;
+    }
+
+  g_socket_client_connect_async (client, connectable, probe->cancellable, probe_connect_cb,
+                                 rmg_probe_ref (probe));
+}
+
+static void
+probe_dbus_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgProbe *probe = (RmgProbe *)user_data;
+  g_autoptr (GVariant) response = NULL;
+  g_autoptr (GError) error = NULL;
+
+  response = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &error);
+  if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    probe_complete (probe, response != NULL, error != NULL ? error->message : NULL);
+
+  rmg_probe_unref (probe);
+}
+
+static void
+probe_run_dbus (RmgProbe *probe, GDBusConnection *connection)
+{
+  if (connection == NULL)
+    {
+      probe_complete_later (probe, FALSE, "no bus connection");
+      return;
+    }
+
+  /* every bus peer implements Ping so the service main loop is probed */
+  g_dbus_connection_call (connection, probe->target, "/", "org.freedesktop.DBus.Peer", "Ping",
+                          NULL, NULL, G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                          (gint)probe->timeout * 1000, probe->cancellable, probe_dbus_cb,
+                          rmg_probe_ref (probe));
+}
+
+static void
+probe_exec_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+  RmgProbe *probe = (RmgProbe *)user_data;
+  g_autoptr (GError) error = NULL;
+  gboolean success;
+
+  success = g_subprocess_wait_check_finish (G_SUBPROCESS (source_object), res, &error);
+  if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    probe_complete (probe, success, error != NULL ? error->message : NULL);
+
+  rmg_probe_unref (probe);
+}
+
+static void
+probe_run_exec (RmgProbe *probe)
+{
+  g_autoptr (GError) error = NULL;
+
+  if (probe->argv == NULL)
+    {
+      probe_complete_later (probe, FALSE, "invalid command");
+      return;
+    }
+
+  probe->subprocess = g_subprocess_newv ((const gchar *const *)probe->argv,
+                                         G_SUBPROCESS_FLAGS_STDOUT_SILENCE
+                                             | G_SUBPROCESS_FLAGS_STDERR_SILENCE,
+                                         &error);
+  if (probe->subprocess == NULL)
+    {
+      probe_complete_later (probe, FALSE, error->message);
+      return;
+    }
+
+  g_subprocess_wait_check_async (probe->subprocess, probe->cancellable, probe_exec_cb,
+                                 rmg_probe_ref (probe));
+}
+
+static void
+probe_run_heartbeat (RmgProbe *probe)
+{
+  GStatBuf file_stat;
+  gint64 age;
+
+  if (g_stat (probe->target, &file_stat) != 0)
+    {
+      probe_complete_later (probe, FALSE, g_strerror (errno));
+      return;
+    }
+
+  /* the service touches the file while its main loop is running */
+  age = g_get_real_time () / G_USEC_PER_SEC - (gint64)file_stat.st_mtime;
+
+  probe_complete_later (probe, age <= (gint64)probe->timeout, "heartbeat file too old");
+}
+
+RmgProbe *
+rmg_probe_new (const gchar *service_name, RmgProbeType type, const gchar *target,
+               glong interval, glong timeout, glong threshold)
+{
+  RmgProbe *probe = g_new0 (RmgProbe, 1);
+
+  g_assert (service_name);
+  g_assert (target);
+
+  g_ref_count_init (&probe->rc);
+
+  rmg_utils_set_name (&probe->service_name, service_name);
+  probe->type = type;
+  probe->target = g_strdup (target);
+  probe->interval = (guint)CLAMP (interval, 1, G_MAXINT / 1000);
+  probe->timeout = (guint)CLAMP (timeout, 1, G_MAXINT / 1000);
+  probe->threshold = (guint)CLAMP (threshold, 1, G_MAXINT);
+
+  if (type == PROBE_EXEC)
+    {
+      g_autoptr (GError) error = NULL;
+
+      /* the command is parsed once and run without a shell */
+      if (!g_shell_parse_argv (target, NULL, &probe->argv, &error))
+        {
+          g_warning ("Invalid exec probe command '%s' for service '%s'. Error %s", target,
+                     service_name, error->message);
+        }
+    }
+
+  return probe;
+}
+
+RmgProbe *
+rmg_probe_ref (RmgProbe *probe)
+{
+  g_assert (probe);
+  g_ref_count_inc (&probe->rc);
+  return probe;
+}
+
+void
+rmg_probe_unref (RmgProbe *probe)
+{
+  g_assert (probe);
+
+  if (g_ref_count_dec (&probe->rc) == TRUE)
+    {
+      rmg_probe_cancel (probe);
+
+      g_strfreev (probe->argv);
+      g_free (probe->target);
+      g_clear_pointer (&probe->service_name, g_ref_string_release);
+      g_free (probe);
+    }
+}
+
+void
+rmg_probe_run (RmgProbe *probe, GDBusConnection *connection, RmgProbeCallback callback,
+               gpointer user_data)
+{
+  g_assert (probe);
+  g_assert (callback);
+
+  if (probe->running)
+    return;
+
+  probe->running = TRUE;
+  probe->callback = callback;
+  probe->user_data = user_data;
+  probe->cancellable = g_cancellable_new ();
+  probe->timeout_source = g_timeout_add_seconds (probe->timeout, probe_timeout_cb, probe);
+
+  switch (probe->type)
+    {
+    case PROBE_CONNECT:
+      probe_run_connect (probe);
+      break;
+
+    case PROBE_DBUS:
+      probe_run_dbus (probe, connection);
+      break;
+
+    case PROBE_EXEC:
+      probe_run_exec (probe);
+      break;
+
+    case PROBE_HEARTBEAT:
+      probe_run_heartbeat (probe);
+      break;
+
+    default:
+      probe_complete_later (probe, FALSE, "invalid probe type");
+      break;
+    }
+}
+
+void
+rmg_probe_cancel (RmgProbe *probe)
+{
+  g_assert (probe);
+
+  if (!probe->running)
+    return;
+
+  if (probe->subprocess != NULL)
+    g_subprocess_force_exit (probe->subprocess);
+
+  g_cancellable_cancel (probe->cancellable);
+  probe_finish (probe);
+}
@@ -0,0 +1,108 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-probe.h
+ */
+
+#pragma once
+
+#include "rmg-types.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @function RmgProbeCallback
+ * @brief Probe completion callback, not called for cancelled probes
+ */
+typedef void (*RmgProbeCallback) (gpointer _probe, gboolean healthy, gpointer user_data);
+
+/**
+ * @struct RmgProbe
+ * @brief A liveness probe of a service
+ */
+typedef struct _RmgProbe
+{
+  gchar *service_name;       /**< Probed service name atom */
+  RmgProbeType type;         /**< The probe type */
+  gchar *target;             /**< Socket address, bus name, command or heartbeat file */
+  gchar **argv;              /**< Command argv parsed once for exec probes */
+  guint interval;            /**< Seconds between probe runs */
+  guint timeout;             /**< Seconds before a run fails, heartbeat file age limit */
+  guint threshold;           /**< Consecutive failures declaring the service crashed */
+  guint failures;            /**< Current consecutive failures */
+  gint64 due_time;           /**< Monotonic time of the next run */
+  gboolean running;          /**< A run is in progress */
+  gboolean healthy;          /**< Result of a run completed without async operation */
+  GCancellable *cancellable; /**< Cancellable of the run in progress */
+  GSubprocess *subprocess;   /**< Process of the exec run in progress */
+  guint timeout_source;      /**< Timeout of the run in progress */
+  RmgProbeCallback callback; /**< Completion callback of the run in progress */
+  gpointer user_data;        /**< Completion callback user data */
+  grefcount rc;              /**< Reference counter variable  */
+} RmgProbe;
+
+/*
+ * @brief Create a new probe object
+ * @param service_name The probed service name
+ * @param type The probe type
+ * @param target The probe target
+ * @param interval Seconds between probe runs
+ * @param timeout Seconds before a run fails
+ * @param threshold Consecutive failures declaring the service crashed
+ * @return A new RmgProbe object
+ */
+RmgProbe *rmg_probe_new (const gchar *service_name, RmgProbeType type, const gchar *target,
+                         glong interval, glong timeout, glong threshold);
+
+/**
+ * @brief Aquire probe object
+ * @param probe Pointer to the probe object
+ */
+RmgProbe *rmg_probe_ref (RmgProbe *probe);
+
+/**
+ * @brief Release probe object
+ * @param probe Pointer to the probe object
+ */
+void rmg_probe_unref (RmgProbe *probe);
+
+/**
+ * @brief Start a probe run
+ * The callback is called once from the main context when the run completes or times out
+ * @param probe Pointer to the probe object
+ * @param connection The bus used by dbus probes
+ * @param callback The completion callback
+ * @param user_data The completion callback user data
+ */
+void rmg_probe_run (RmgProbe *probe, GDBusConnection *connection, RmgProbeCallback callback,
+                    gpointer user_data);
+
+/**
+ * @brief Cancel the run in progress without calling its callback
+ * @param probe Pointer to the probe object
+ */
+void rmg_probe_cancel (RmgProbe *probe);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgProbe, rmg_probe_unref);
+
+G_END_DECLS
@@ -0,0 +1,451 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-proccon.c
+ */
+
+#include "rmg-proccon.h"
+
+#include <errno.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define RMG_PROCCON_BUFFER_SIZE (4096)
+
+/**
+ * @struct RmgProcConRequest
+ * @brief Proc connector multicast subscription message
+ */
+typedef struct _RmgProcConRequest
+{
+  struct nlmsghdr header;
+  struct cn_msg message;
+  enum proc_cn_mcast_op op;
+} __attribute__ ((packed)) RmgProcConRequest;
+
+/**
+ * @brief GSource prepare function
+ */
+static gboolean proccon_source_prepare (GSource *source, gint *timeout);
+
+/**
+ * @brief GSource dispatch function
+ */
+static gboolean proccon_source_dispatch (GSource *source, GSourceFunc callback, gpointer _proccon);
+
+/**
+ * @brief GSource destroy notification callback function
+ */
+static void proccon_source_destroy_notify (gpointer _proccon);
+
+/**
+ * @brief GSourceFuncs vtable
+ */
+static GSourceFuncs proccon_source_funcs = {
+  proccon_source_prepare, NULL, proccon_source_dispatch, NULL, NULL, NULL,
+};
+
+static gboolean
+is_core_signal (gint sig)
+{
+  switch (sig)
+    {
+    case SIGQUIT:
+    case SIGILL:
+    case SIGTRAP:
+    case SIGABRT:
+    case SIGBUS:
+    case SIGFPE:
+    case SIGSEGV:
+    case SIGXCPU:
+    case SIGXFSZ:
+    case SIGSYS:
+      return TRUE;
+
+    default:
+      break;
+    }
+
+  return FALSE;
+}
+
+static gchar *
+context_for_pid (pid_t pid)
+{
+  g_autofree gchar *cgroup_file = g_strdup_printf ("/proc/%d/cgroup", pid);
+  g_autofree gchar *content = NULL;
+  const gchar *scope = NULL;
+
+  /* processes in a container run below machine.slice/machine-<name>.scope */
+  if (g_file_get_contents (cgroup_file, &content, NULL, NULL)
+      && (scope = strstr (content, "/machine.slice/machine-")) != NULL)
+    {
+      const gchar *name = scope + strlen ("/machine.slice/machine-");
+      const gchar *end = strstr (name, ".scope");
+
+      if (end != NULL && end > name)
+        {
+          g_autofree gchar *escaped = g_strndup (name, (gsize)(end - name));
+          gchar *context = NULL;
+          gchar **parts = NULL;
+
+          /* unit names escape the dash as \x2d */
+          parts = g_strsplit (escaped, "\\x2d", -1);
+          context = g_strjoinv ("-", parts);
+          g_strfreev (parts);
+
+          return context;
+        }
+    }
+
+  return g_strdup (g_get_host_name ());
+}
+
+static pid_t
+parent_for_pid (pid_t pid)
+{
+  g_autofree gchar *stat_file = g_strdup_printf ("/proc/%d/stat", pid);
+  g_autofree gchar *content = NULL;
+  const gchar *fields = NULL;
+  gint ppid = 0;
+
+  /* the command name may contain spaces, the fields after it are state and ppid */
+  if (g_file_get_contents (stat_file, &content, NULL, NULL)
+      && (fields = strrchr (content, ')')) != NULL)
+    {
+      if (sscanf (fields, ") %*c %d", &ppid) != 1)
+        ppid = 0;
+    }
+
+  return (pid_t)ppid;
+}
+
+static void
+proccon_service_crash (RmgProcCon *proccon, pid_t pid, gint status, RmgDEvent *event)
+{
+  gchar *service_name = rmg_pidcache_lookup (proccon->pidcache, pid);
+  RmgMEntry *mentry = NULL;
+
+  if (service_name == NULL)
+    return;
+
+  /* the event holds the name from now on */
+  rmg_devent_set_service_name (event, service_name);
+  g_ref_string_release (service_name);
+
+  /* only the main process is spawned by the service manager or reparented to it
+   * when a forking service daemonizes */
+  if (proccon->monitor == NULL || parent_for_pid (pid) != 1)
+    return;
+
+  mentry = rmg_monitor_get_entry (proccon->monitor, event->service_name);
+  if (mentry != NULL)
+    {
+      rmg_mentry_set_exec_main_status (mentry, WCOREDUMP (status) ? CLD_DUMPED : CLD_KILLED,
+                                       WTERMSIG (status));
+      rmg_mentry_provisional_crash (mentry, "main process crash");
+    }
+}
+
+static void
+proccon_process_exit (RmgProcCon *proccon, const struct proc_event *ev)
+{
+  pid_t pid = ev->event_data.exit.process_pid;
+  gint status = (gint)ev->event_data.exit.exit_code;
+  g_autofree gchar *context_name = NULL;
+  g_autoptr (RmgDEvent) event = NULL;
+  gchar *proc_name = NULL;
+
+  /* threads report their own exit, only the thread group leader ends the process */
+  if (pid != ev->event_data.exit.process_tgid)
+    return;
+
+  if (!WIFSIGNALED (status) || !(WCOREDUMP (status) || is_core_signal (WTERMSIG (status))))
+    {
+      rmg_pidcache_remove (proccon->pidcache, pid);
+      rmg_proctable_exit (proccon->proctable, pid);
+      return;
+    }
+
+  /* the process is a zombie until reaped so its proc entries are still readable */
+  proc_name = rmg_proctable_get_name (proccon->proctable, pid);
+  rmg_proctable_exit (proccon->proctable, pid);
+
+  if (proc_name == NULL)
+    {
+      g_debug ("Process %d crashed with signal %d but exited before resolve", pid,
+               WTERMSIG (status));
+      rmg_pidcache_remove (proccon->pidcache, pid);
+      return;
+    }
+
+  context_name = context_for_pid (pid);
+  event = rmg_devent_new (DEVENT_INFORM_PROCESS_CRASH);
+
+  /* the owning service recovery starts before systemd marks the unit failed */
+  proccon_service_crash (proccon, pid, status, event);
+  rmg_pidcache_remove (proccon->pidcache, pid);
+
+  /* the proc connector has no crash id so only the process window applies */
+  if (rmg_crashfilter_accept (proccon->dispatcher->crashfilter, NULL, proc_name, context_name))
+    {
+      rmg_devent_set_process_name (event, proc_name);
+      rmg_devent_set_context_name (event, context_name);
+
+      g_debug ("Dispatch process crash information for %s in context %s, signal %d", proc_name,
+               event->context_name, WTERMSIG (status));
+      rmg_dispatcher_push_service_event (proccon->dispatcher, g_steal_pointer (&event));
+    }
+
+  g_ref_string_release (proc_name);
+}
+
+static gboolean
+proccon_source_prepare (GSource *source, gint *timeout)
+{
+  RMG_UNUSED (source);
+  *timeout = -1;
+  return FALSE;
+}
+
+static gboolean
+proccon_source_dispatch (GSource *source, GSourceFunc callback, gpointer _proccon)
+{
+  RmgProcCon *proccon = (RmgProcCon *)source;
+  gchar buf[RMG_PROCCON_BUFFER_SIZE] __attribute__ ((aligned (NLMSG_ALIGNTO)));
+  gssize len;
+
+  RMG_UNUSED (callback);
+  RMG_UNUSED (_proccon);
+
+  while ((len = recv (proccon->sock_fd, buf, sizeof (buf), 0)) > 0)
+    {
+      /* unsigned like nlmsg_len so NLMSG_OK and NLMSG_NEXT convert nothing */
+      guint remaining = (guint)len;
+
+      for (struct nlmsghdr *header = (struct nlmsghdr *)(gpointer)buf;
+           NLMSG_OK (header, remaining); header = NLMSG_NEXT (header, remaining))
+        {
+          const struct cn_msg *message = NULL;
+          const struct proc_event *ev = NULL;
+
+          if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP)
+            continue;
+
+          message = (const struct cn_msg *)NLMSG_DATA (header);
+          if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC)
+            continue;
+
+          ev = (const struct proc_event *)(gconstpointer)message->data;
+          switch (ev->what)
+            {
+            case PROC_EVENT_FORK:
+              /* new threads are reported as forks of their own process */
+              if (ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid)
+                {
+                  rmg_proctable_fork (proccon->proctable, ev->event_data.fork.parent_tgid,
+                                      ev->event_data.fork.child_tgid);
+                  rmg_pidcache_fork (proccon->pidcache, ev->event_data.fork.parent_tgid,
+                                     ev->event_data.fork.child_tgid);
+                }
+              break;
+
+            case PROC_EVENT_EXEC:
+              rmg_proctable_exec (proccon->proctable, ev->event_data.exec.process_tgid);
+              rmg_pidcache_exec (proccon->pidcache, ev->event_data.exec.process_tgid);
+              break;
+
+            case PROC_EVENT_COMM:
+              /* the process name is the name of its main thread */
+              if (ev->event_data.comm.process_pid == ev->event_data.comm.process_tgid)
+                {
+                  gchar comm[sizeof (ev->event_data.comm.comm) + 1] = { 0 };
+
+                  memcpy (comm, ev->event_data.comm.comm, sizeof (ev->event_data.comm.comm));
+                  rmg_proctable_comm (proccon->proctable, ev->event_data.comm.process_tgid, comm);
+                }
+              break;
+
+            case PROC_EVENT_EXIT:
+              proccon_process_exit (proccon, ev);
+              break;
+
+            default:
+              break;
+            }
+        }
+    }
+
+  if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+      /* the kernel drops events on overrun, the following ones are still valid */
+      if (errno == ENOBUFS)
+        g_warning ("Proc connector overrun, process exit events lost");
+      else
+        g_warning ("Fail to read proc connector events. Error %s", g_strerror (errno));
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+proccon_source_destroy_notify (gpointer _proccon)
+{
+  RmgProcCon *proccon = (RmgProcCon *)_proccon;
+
+  g_assert (proccon);
+  g_debug ("ProcCon destroy notification");
+
+  rmg_proccon_unref (proccon);
+}
+
+static gint
+proccon_subscribe (gint sock_fd)
+{
+  struct sockaddr_nl addr = { 0 };
+  RmgProcConRequest request;
+
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = CN_IDX_PROC;
+  addr.nl_pid = (__u32)getpid ();
+
+  if (bind (sock_fd, (struct sockaddr *)&addr, sizeof (addr)) < 0)
+    return -errno;
+
+  memset (&request, 0, sizeof (request));
+
+  request.header.nlmsg_len = sizeof (request);
+  request.header.nlmsg_type = NLMSG_DONE;
+  request.header.nlmsg_pid = (__u32)getpid ();
+  request.message.id.idx = CN_IDX_PROC;
+  request.message.id.val = CN_VAL_PROC;
+  request.message.len = sizeof (enum proc_cn_mcast_op);
+  request.op = PROC_CN_MCAST_LISTEN;
+
+  if (send (sock_fd, &request, sizeof (request), 0) < 0)
+    return -errno;
+
+  return 0;
+}
+
+RmgProcCon *
+rmg_proccon_new (RmgDispatcher *dispatcher, GError **error)
+{
+  RmgProcCon *proccon = NULL;
+  glong capacity;
+  gint sock_fd;
+  gint r;
+
+  g_assert (dispatcher);
+
+  capacity = rmg_options_long_for (dispatcher->options, KEY_PID_CACHE_CAPACITY);
+
+  sock_fd = socket (PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+  if (sock_fd < 0)
+    {
+      g_set_error (error, g_quark_from_static_string ("ProcConNew"), 1,
+                   "Fail to create proc connector socket. Error %s", g_strerror (errno));
+      return NULL;
+    }
+
+  r = proccon_subscribe (sock_fd);
+  if (r < 0)
+    {
+      g_set_error (error, g_quark_from_static_string ("ProcConNew"), 1,
+                   "Fail to subscribe to proc connector. Error %s", g_strerror (-r));
+      close (sock_fd);
+      return NULL;
+    }
+
+  proccon = (RmgProcCon *)g_source_new (&proccon_source_funcs, sizeof (RmgProcCon));
+
+  g_assert (proccon);
+
+  g_ref_count_init (&proccon->rc);
+
+  proccon->sock_fd = sock_fd;
+  proccon->dispatcher = rmg_dispatcher_ref (dispatcher);
+  proccon->pidcache = rmg_pidcache_new ((guint)CLAMP (capacity, 1, G_MAXINT));
+  proccon->proctable = rmg_proctable_new ();
+
+  /* events are queued on the subscribed socket while the tables are seeded */
+  rmg_proctable_set_live (proccon->proctable);
+  rmg_pidcache_seed (proccon->pidcache);
+
+  g_source_set_callback (RMG_EVENT_SOURCE (proccon), NULL, proccon, proccon_source_destroy_notify);
+  g_source_attach (RMG_EVENT_SOURCE (proccon), NULL);
+
+  proccon->tag = g_source_add_unix_fd (RMG_EVENT_SOURCE (proccon), proccon->sock_fd, G_IO_IN);
+
+  return proccon;
+}
+
+RmgProcCon *
+rmg_proccon_ref (RmgProcCon *proccon)
+{
+  g_assert (proccon);
+  g_ref_count_inc (&proccon->rc);
+  return proccon;
+}
+
+void
+rmg_proccon_unref (RmgProcCon *proccon)
+{
+  g_assert (proccon);
+
+  if (g_ref_count_dec (&proccon->rc) == TRUE)
+    {
+      if (proccon->dispatcher != NULL)
+        rmg_dispatcher_unref (proccon->dispatcher);
+
+      if (proccon->monitor != NULL)
+        rmg_monitor_unref (proccon->monitor);
+
+      if (proccon->pidcache != NULL)
+        rmg_pidcache_unref (proccon->pidcache);
+
+      if (proccon->proctable != NULL)
+        rmg_proctable_unref (proccon->proctable);
+
+      if (proccon->sock_fd >= 0)
+        close (proccon->sock_fd);
+
+      g_source_unref (RMG_EVENT_SOURCE (proccon));
+    }
+}
+
+void
+rmg_proccon_set_monitor (RmgProcCon *proccon, RmgMonitor *monitor)
+{
+  g_assert (proccon);
+  g_assert (monitor);
+
+  if (proccon->monitor != NULL)
+    rmg_monitor_unref (proccon->monitor);
+
+  proccon->monitor = rmg_monitor_ref (monitor);
+}
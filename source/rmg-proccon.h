@@ -0,0 +1,81 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-proccon.h
+ */
+
+#pragma once
+
+#include "rmg-dispatcher.h"
+#include "rmg-monitor.h"
+#include "rmg-pidcache.h"
+#include "rmg-proctable.h"
+#include "rmg-types.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgProcCon
+ * @brief The RmgProcCon opaque data structure
+ */
+typedef struct _RmgProcCon
+{
+  GSource source;            /**< Event loop source */
+  gpointer tag;              /**< The netlink socket tag */
+  gint sock_fd;              /**< Proc connector netlink socket */
+  RmgDispatcher *dispatcher; /**< Dispatcher receiving the process crash events */
+  RmgMonitor *monitor;       /**< Optional monitor owning the service entries */
+  RmgPidCache *pidcache;     /**< Service processes by pid */
+  RmgProcTable *proctable;   /**< Process names kept up to date by the proc connector */
+  grefcount rc;              /**< Reference counter variable  */
+} RmgProcCon;
+
+/*
+ * @brief Create a new proc connector crash source
+ * @param dispatcher The dispatcher receiving process crash events
+ * @param error The error object set if the proc connector is not available
+ * @return On success return a new RmgProcCon object otherwise return NULL
+ */
+RmgProcCon *rmg_proccon_new (RmgDispatcher *dispatcher, GError **error);
+
+/**
+ * @brief Aquire proccon object
+ * @param proccon Pointer to the proccon object
+ */
+RmgProcCon *rmg_proccon_ref (RmgProcCon *proccon);
+
+/**
+ * @brief Release proccon object
+ * @param proccon Pointer to the proccon object
+ */
+void rmg_proccon_unref (RmgProcCon *proccon);
+
+/**
+ * @brief Set the monitor used to start the recovery of a service whose main process crashed
+ * @param proccon Pointer to the proccon object
+ * @param monitor Pointer to the monitor object
+ */
+void rmg_proccon_set_monitor (RmgProcCon *proccon, RmgMonitor *monitor);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgProcCon, rmg_proccon_unref);
+
+G_END_DECLS
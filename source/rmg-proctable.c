@@ -0,0 +1,175 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-proctable.c
+ */
+
+#include "rmg-proctable.h"
+
+/**
+ * @struct RmgProcTableEntry
+ * @brief Process table entry
+ */
+typedef struct _RmgProcTableEntry
+{
+  pid_t tgid;  /**< Process id */
+  gchar *name; /**< Process name atom or NULL until read */
+} RmgProcTableEntry;
+
+static gchar *
+read_name (pid_t tgid)
+{
+  g_autofree gchar *comm_file = g_strdup_printf ("/proc/%d/comm", tgid);
+  g_autofree gchar *comm = NULL;
+
+  if (!g_file_get_contents (comm_file, &comm, NULL, NULL))
+    return NULL;
+
+  return g_ref_string_new_intern (g_strchomp (comm));
+}
+
+static void
+table_entry_free (gpointer _entry)
+{
+  RmgProcTableEntry *entry = (RmgProcTableEntry *)_entry;
+
+  g_clear_pointer (&entry->name, g_ref_string_release);
+  g_free (entry);
+}
+
+static void
+table_set (RmgProcTable *table, pid_t tgid, gchar *name)
+{
+  RmgProcTableEntry *entry = g_hash_table_lookup (table->processes, GINT_TO_POINTER (tgid));
+
+  if (entry == NULL)
+    {
+      entry = g_new0 (RmgProcTableEntry, 1);
+      entry->tgid = tgid;
+      g_hash_table_insert (table->processes, GINT_TO_POINTER (tgid), entry);
+    }
+
+  /* the entry takes over the name atom */
+  g_clear_pointer (&entry->name, g_ref_string_release);
+  entry->name = name;
+}
+
+RmgProcTable *
+rmg_proctable_new (void)
+{
+  RmgProcTable *table = g_new0 (RmgProcTable, 1);
+
+  g_ref_count_init (&table->rc);
+
+  table->processes = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, table_entry_free);
+
+  return table;
+}
+
+RmgProcTable *
+rmg_proctable_ref (RmgProcTable *table)
+{
+  g_assert (table);
+  g_ref_count_inc (&table->rc);
+  return table;
+}
+
+void
+rmg_proctable_unref (RmgProcTable *table)
+{
+  g_assert (table);
+
+  if (g_ref_count_dec (&table->rc) == TRUE)
+    {
+      g_hash_table_destroy (table->processes);
+      g_free (table);
+    }
+}
+
+void
+rmg_proctable_set_live (RmgProcTable *table)
+{
+  g_assert (table);
+
+  /* processes running before are not listed and have their name read on lookup */
+  table->live = TRUE;
+}
+
+void
+rmg_proctable_fork (RmgProcTable *table, pid_t parent_tgid, pid_t child_tgid)
+{
+  RmgProcTableEntry *parent = NULL;
+
+  g_assert (table);
+
+  if (!table->live)
+    return;
+
+  /* the child runs the parent image until exec */
+  parent = g_hash_table_lookup (table->processes, GINT_TO_POINTER (parent_tgid));
+  if (parent != NULL && parent->name != NULL)
+    table_set (table, child_tgid, g_ref_string_acquire (parent->name));
+  else
+    table_set (table, child_tgid, NULL);
+}
+
+void
+rmg_proctable_exec (RmgProcTable *table, pid_t tgid)
+{
+  g_assert (table);
+
+  /* the new name is read only if the process name is looked up */
+  if (table->live)
+    table_set (table, tgid, NULL);
+}
+
+void
+rmg_proctable_comm (RmgProcTable *table, pid_t tgid, const gchar *name)
+{
+  g_assert (table);
+  g_assert (name);
+
+  if (table->live)
+    table_set (table, tgid, g_ref_string_new_intern (name));
+}
+
+void
+rmg_proctable_exit (RmgProcTable *table, pid_t tgid)
+{
+  g_assert (table);
+  g_hash_table_remove (table->processes, GINT_TO_POINTER (tgid));
+}
+
+gchar *
+rmg_proctable_get_name (RmgProcTable *table, pid_t tgid)
+{
+  RmgProcTableEntry *entry = NULL;
+
+  g_assert (table);
+
+  entry = g_hash_table_lookup (table->processes, GINT_TO_POINTER (tgid));
+  if (entry == NULL)
+    return read_name (tgid);
+
+  if (entry->name == NULL)
+    entry->name = read_name (tgid);
+
+  return entry->name != NULL ? g_ref_string_acquire (entry->name) : NULL;
+}
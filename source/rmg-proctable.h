@@ -0,0 +1,111 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-proctable.h
+ */
+
+#pragma once
+
+#include "rmg-types.h"
+
+#include <glib.h>
+#include <sys/types.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgProcTable
+ * @brief Names of running processes by pid
+ */
+typedef struct _RmgProcTable
+{
+  GHashTable *processes; /**< Processes by pid */
+  gboolean live;         /**< Kept up to date by process events */
+  grefcount rc;          /**< Reference counter variable  */
+} RmgProcTable;
+
+/*
+ * @brief Create a new process table object
+ * @return A new RmgProcTable object
+ */
+RmgProcTable *rmg_proctable_new (void);
+
+/**
+ * @brief Aquire process table object
+ * @param table Pointer to the process table object
+ */
+RmgProcTable *rmg_proctable_ref (RmgProcTable *table);
+
+/**
+ * @brief Release process table object
+ * @param table Pointer to the process table object
+ */
+void rmg_proctable_unref (RmgProcTable *table);
+
+/**
+ * @brief Keep the table up to date from process events
+ * Must be called once the event source is subscribed so no event is missed
+ * @param table Pointer to the process table object
+ */
+void rmg_proctable_set_live (RmgProcTable *table);
+
+/**
+ * @brief Add a forked process sharing the parent name
+ * @param table Pointer to the process table object
+ * @param parent_tgid The parent process id
+ * @param child_tgid The new process id
+ */
+void rmg_proctable_fork (RmgProcTable *table, pid_t parent_tgid, pid_t child_tgid);
+
+/**
+ * @brief Forget the name of a process after exec
+ * @param table Pointer to the process table object
+ * @param tgid The process id
+ */
+void rmg_proctable_exec (RmgProcTable *table, pid_t tgid);
+
+/**
+ * @brief Update the name of a process
+ * @param table Pointer to the process table object
+ * @param tgid The process id
+ * @param name The new process name
+ */
+void rmg_proctable_comm (RmgProcTable *table, pid_t tgid, const gchar *name);
+
+/**
+ * @brief Remove an exited process
+ * @param table Pointer to the process table object
+ * @param tgid The process id
+ */
+void rmg_proctable_exit (RmgProcTable *table, pid_t tgid);
+
+/**
+ * @brief Get the process name for pid
+ * The name is read from procfs on the first lookup after exec
+ * @param table Pointer to the process table object
+ * @param tgid The process id
+ * @return A reference on the process name atom released with g_ref_string_release, or NULL if
+ * the process is not running
+ */
+gchar *rmg_proctable_get_name (RmgProcTable *table, pid_t tgid);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgProcTable, rmg_proctable_unref);
+
+G_END_DECLS
@@ -0,0 +1,126 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-reaper.c
+ */
+
+#include "rmg-reaper.h"
+
+static void reaper_next (RmgReaper *reaper);
+
+static void
+reaper_reset_cb (gpointer _reset, gpointer user_data)
+{
+  RmgReaper *reaper = (RmgReaper *)user_data;
+
+  RMG_UNUSED (_reset);
+
+  g_clear_pointer (&reaper->running, rmg_datareset_unref);
+  reaper_next (reaper);
+
+  /* release the reference taken for the run */
+  rmg_reaper_unref (reaper);
+}
+
+static void
+reaper_next (RmgReaper *reaper)
+{
+  GHashTableIter iter;
+  gpointer trash_path = NULL;
+
+  if (reaper->running != NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, reaper->pending);
+  if (!g_hash_table_iter_next (&iter, &trash_path, NULL))
+    return;
+
+  reaper->running = rmg_datareset_new ("trash reaper", (const gchar *)trash_path, 1, NULL);
+  rmg_datareset_set_background (reaper->running, reaper->rate);
+
+  g_hash_table_iter_remove (&iter);
+
+  rmg_datareset_run (reaper->running, reaper_reset_cb, rmg_reaper_ref (reaper));
+}
+
+RmgReaper *
+rmg_reaper_new (glong rate)
+{
+  RmgReaper *reaper = g_new0 (RmgReaper, 1);
+
+  g_ref_count_init (&reaper->rc);
+
+  reaper->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  reaper->rate = rate;
+
+  return reaper;
+}
+
+RmgReaper *
+rmg_reaper_ref (RmgReaper *reaper)
+{
+  g_assert (reaper);
+  g_ref_count_inc (&reaper->rc);
+  return reaper;
+}
+
+void
+rmg_reaper_unref (RmgReaper *reaper)
+{
+  g_assert (reaper);
+
+  if (g_ref_count_dec (&reaper->rc) == TRUE)
+    {
+      g_hash_table_destroy (reaper->pending);
+      g_free (reaper);
+    }
+}
+
+void
+rmg_reaper_add (RmgReaper *reaper, const gchar *trash_path)
+{
+  g_assert (reaper);
+  g_assert (trash_path);
+
+  g_hash_table_add (reaper->pending, g_strdup (trash_path));
+  reaper_next (reaper);
+}
+
+void
+rmg_reaper_resume (RmgReaper *reaper, const gchar *data_path)
+{
+  g_autofree gchar *parent = NULL;
+  g_autofree gchar *trash_path = NULL;
+
+  g_assert (reaper);
+
+  if (data_path == NULL || !g_path_is_absolute (data_path))
+    return;
+
+  parent = g_path_get_dirname (data_path);
+  trash_path = g_build_filename (parent, RMG_DATARESET_TRASH, NULL);
+
+  if (g_file_test (trash_path, G_FILE_TEST_IS_DIR)
+      && !g_file_test (trash_path, G_FILE_TEST_IS_SYMLINK))
+    {
+      g_info ("Resume reaping trash directory '%s'", trash_path);
+      rmg_reaper_add (reaper, trash_path);
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-reaper.h
+ */
+
+#pragma once
+
+#include "rmg-datareset.h"
+#include "rmg-types.h"
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgReaper
+ * @brief Removes the swapped out service data in the background
+ */
+typedef struct _RmgReaper
+{
+  GHashTable *pending;   /**< Trash directories waiting to be reaped */
+  RmgDataReset *running; /**< Reset of the trash directory being reaped */
+  glong rate;            /**< Entries removed per second, 0 for no limit */
+  grefcount rc;          /**< Reference counter variable  */
+} RmgReaper;
+
+/*
+ * @brief Create a new reaper object
+ * @param rate Entries removed per second, 0 for no limit
+ * @return A new RmgReaper object
+ */
+RmgReaper *rmg_reaper_new (glong rate);
+
+/**
+ * @brief Aquire reaper object
+ * @param reaper Pointer to the reaper object
+ */
+RmgReaper *rmg_reaper_ref (RmgReaper *reaper);
+
+/**
+ * @brief Release reaper object
+ * @param reaper Pointer to the reaper object
+ */
+void rmg_reaper_unref (RmgReaper *reaper);
+
+/**
+ * @brief Clear a trash directory in the background
+ * A trash directory added while it is reaped is cleared again once the run completes
+ * @param reaper Pointer to the reaper object
+ * @param trash_path The trash directory path
+ */
+void rmg_reaper_add (RmgReaper *reaper, const gchar *trash_path);
+
+/**
+ * @brief Resume reaping the trash left next to a data directory by a previous run
+ * @param reaper Pointer to the reaper object
+ * @param data_path The data directory path
+ */
+void rmg_reaper_resume (RmgReaper *reaper, const gchar *data_path);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgReaper, rmg_reaper_unref);
+
+G_END_DECLS
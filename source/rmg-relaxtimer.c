@@ -22,6 +22,7 @@
  */
 
 #include "rmg-relaxtimer.h"
+#include "rmg-utils.h"
 
 static gboolean
 relaxtimer_callback (gpointer user_data)
@@ -68,7 +69,7 @@ relaxtimer_destroy_notify (gpointer data)
   g_assert (relaxtimer);
 
   rmg_journal_unref (relaxtimer->journal);
-  g_free (relaxtimer->service_name);
+  g_clear_pointer (&relaxtimer->service_name, g_ref_string_release);
   g_free (relaxtimer);
 }
 
@@ -81,7 +82,6 @@ rmg_relaxtimer_trigger (RmgJournal *journal, const gchar *service_name, GError *
   g_ref_count_init (&relaxtimer->rc);
 
   relaxtimer->journal = rmg_journal_ref (journal);
-  relaxtimer->service_name = g_strdup (service_name);
 
   relaxtimer->rvector = rmg_journal_get_rvector (journal, service_name, error);
   if (relaxtimer->rvector <= 0)
@@ -97,6 +97,8 @@ rmg_relaxtimer_trigger (RmgJournal *journal, const gchar *service_name, GError *
       g_return_val_if_reached (source);
     }
 
+  rmg_utils_set_name (&relaxtimer->service_name, service_name);
+
   source = g_timeout_add_seconds_full (G_PRIORITY_DEFAULT,
                                        (guint)(relaxtimer->rvector * relaxtimer->timeout),
                                        relaxtimer_callback, relaxtimer, relaxtimer_destroy_notify);
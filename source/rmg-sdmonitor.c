@@ -0,0 +1,413 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-sdmonitor.c
+ */
+
+#include "rmg-sdmonitor.h"
+
+#include <string.h>
+
+extern const gchar *sd_dbus_name;
+extern const gchar *sd_dbus_object_path;
+extern const gchar *sd_dbus_interface_unit;
+extern const gchar *sd_dbus_interface_service;
+extern const gchar *sd_dbus_interface_manager;
+
+#define SDMONITOR_RECONNECT_SEC (1)
+
+/**
+ * @brief GSource prepare function
+ */
+static gboolean sdmonitor_source_prepare (GSource *source, gint *timeout);
+
+/**
+ * @brief GSource check function
+ */
+static gboolean sdmonitor_source_check (GSource *source);
+
+/**
+ * @brief GSource dispatch function
+ */
+static gboolean sdmonitor_source_dispatch (GSource *source, GSourceFunc callback,
+                                           gpointer _sdmonitor);
+
+/**
+ * @brief GSource destroy notification callback function
+ */
+static void sdmonitor_source_destroy_notify (gpointer _sdmonitor);
+
+/**
+ * @brief Unit and Service PropertiesChanged signal handler
+ */
+static int on_unit_properties_changed (sd_bus_message *m, void *userdata, sd_bus_error *ret_error);
+
+/**
+ * @brief Open the system bus and subscribe to unit state changes
+ */
+static gboolean sdmonitor_connect (RmgSDMonitor *sdmonitor, GError **error);
+
+/**
+ * @brief Release the system bus connection and its matches
+ */
+static void sdmonitor_disconnect (RmgSDMonitor *sdmonitor);
+
+/**
+ * @brief Reconnect timer callback
+ */
+static gboolean sdmonitor_reconnect_cb (gpointer _sdmonitor);
+
+/**
+ * @brief GSourceFuncs vtable
+ */
+static GSourceFuncs sdmonitor_source_funcs = {
+  sdmonitor_source_prepare, sdmonitor_source_check, sdmonitor_source_dispatch, NULL, NULL, NULL,
+};
+
+static gboolean
+sdmonitor_source_prepare (GSource *source, gint *timeout)
+{
+  RmgSDMonitor *sdmonitor = (RmgSDMonitor *)source;
+  guint64 usec = G_MAXUINT64;
+  gint events;
+
+  *timeout = -1;
+
+  /* nothing is polled while waiting to reconnect */
+  if (sdmonitor->bus == NULL)
+    return FALSE;
+
+  events = sd_bus_get_events (sdmonitor->bus);
+  if (events >= 0 && sdmonitor->fd_tag != NULL)
+    g_source_modify_unix_fd (source, sdmonitor->fd_tag, (GIOCondition)events);
+
+  /* sd-bus reports an absolute CLOCK_MONOTONIC deadline */
+  if (sd_bus_get_timeout (sdmonitor->bus, &usec) >= 0 && usec != G_MAXUINT64)
+    {
+      gint64 now = g_get_monotonic_time ();
+
+      if ((gint64)usec <= now)
+        return TRUE;
+
+      *timeout = (gint)MIN ((((gint64)usec - now) + 999) / 1000, G_MAXINT);
+    }
+
+  return FALSE;
+}
+
+static gboolean
+sdmonitor_source_check (GSource *source)
+{
+  RmgSDMonitor *sdmonitor = (RmgSDMonitor *)source;
+  guint64 usec = G_MAXUINT64;
+
+  if (sdmonitor->bus == NULL)
+    return FALSE;
+
+  if (sdmonitor->fd_tag != NULL && g_source_query_unix_fd (source, sdmonitor->fd_tag) != 0)
+    return TRUE;
+
+  if (sd_bus_get_timeout (sdmonitor->bus, &usec) >= 0 && usec != G_MAXUINT64)
+    return (gint64)usec <= g_get_monotonic_time ();
+
+  return FALSE;
+}
+
+static gboolean
+sdmonitor_source_dispatch (GSource *source, GSourceFunc callback, gpointer _sdmonitor)
+{
+  RmgSDMonitor *sdmonitor = (RmgSDMonitor *)source;
+  gint r;
+
+  RMG_UNUSED (callback);
+  RMG_UNUSED (_sdmonitor);
+
+  /* drain all pending messages, handlers run from sd_bus_process */
+  while ((r = sd_bus_process (sdmonitor->bus, NULL)) > 0)
+    ;
+
+  if (r < 0)
+    {
+      g_warning ("Fail to process sd-bus messages. Error %s", g_strerror (-r));
+
+      /*
+       * The source stays attached since the monitor holds the only reference.
+       * A closed connection is dropped and reopened from a timer so the hangup does not spin.
+       */
+      if (sd_bus_is_open (sdmonitor->bus) <= 0)
+        {
+          g_critical ("sd-bus connection closed, reconnecting to receive unit state changes");
+          sdmonitor_disconnect (sdmonitor);
+
+          if (sdmonitor->reconnect_source == 0)
+            sdmonitor->reconnect_source = g_timeout_add_seconds (SDMONITOR_RECONNECT_SEC,
+                                                                 sdmonitor_reconnect_cb, sdmonitor);
+        }
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+sdmonitor_reconnect_cb (gpointer _sdmonitor)
+{
+  RmgSDMonitor *sdmonitor = (RmgSDMonitor *)_sdmonitor;
+  g_autoptr (GError) error = NULL;
+
+  if (!sdmonitor_connect (sdmonitor, &error))
+    {
+      g_warning ("Fail to reconnect sd-bus monitor. Error %s", error->message);
+      return G_SOURCE_CONTINUE;
+    }
+
+  /* state changes sent while disconnected are lost, the next ones are delivered again */
+  g_warning ("sd-bus monitor reconnected, state changes during the outage were missed");
+  sdmonitor->reconnect_source = 0;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+sdmonitor_source_destroy_notify (gpointer _sdmonitor)
+{
+  RmgSDMonitor *sdmonitor = (RmgSDMonitor *)_sdmonitor;
+
+  g_assert (sdmonitor);
+  g_debug ("SDMonitor destroy notification");
+
+  rmg_sdmonitor_unref (sdmonitor);
+}
+
+static int
+on_unit_properties_changed (sd_bus_message *m, void *userdata, sd_bus_error *ret_error)
+{
+  RmgSDMonitor *sdmonitor = (RmgSDMonitor *)userdata;
+  const gchar *active_state_str = NULL;
+  const gchar *active_substate_str = NULL;
+  const gchar *result_str = NULL;
+  const gchar *interface = NULL;
+  const gchar *key = NULL;
+  gint32 exec_main_code = -1;
+  gint32 exec_main_status = -1;
+  RmgMEntry *mentry = NULL;
+  gint r;
+
+  RMG_UNUSED (ret_error);
+
+  mentry = g_hash_table_lookup (sdmonitor->entries, sd_bus_message_get_path (m));
+  if (mentry == NULL)
+    return 0;
+
+  /* signature is (sa{sv}as) and the interface name is matched by arg0 to Unit or Service */
+  if ((r = sd_bus_message_read_basic (m, SD_BUS_TYPE_STRING, &interface)) < 0)
+    goto parse_error;
+
+  if ((r = sd_bus_message_enter_container (m, SD_BUS_TYPE_ARRAY, "{sv}")) < 0)
+    goto parse_error;
+
+  while ((r = sd_bus_message_enter_container (m, SD_BUS_TYPE_DICT_ENTRY, "sv")) > 0)
+    {
+      if ((r = sd_bus_message_read_basic (m, SD_BUS_TYPE_STRING, &key)) < 0)
+        goto parse_error;
+
+      if (strcmp (key, "ActiveState") == 0)
+        r = sd_bus_message_read (m, "v", "s", &active_state_str);
+      else if (strcmp (key, "SubState") == 0)
+        r = sd_bus_message_read (m, "v", "s", &active_substate_str);
+      else if (strcmp (key, "Result") == 0)
+        r = sd_bus_message_read (m, "v", "s", &result_str);
+      else if (strcmp (key, "ExecMainCode") == 0)
+        r = sd_bus_message_read (m, "v", "i", &exec_main_code);
+      else if (strcmp (key, "ExecMainStatus") == 0)
+        r = sd_bus_message_read (m, "v", "i", &exec_main_status);
+      else
+        r = sd_bus_message_skip (m, "v");
+
+      if (r < 0)
+        goto parse_error;
+
+      if ((r = sd_bus_message_exit_container (m)) < 0)
+        goto parse_error;
+    }
+
+  if (r < 0)
+    goto parse_error;
+
+  /* systemd emits the Service interface changes ahead of the Unit ones */
+  if (strcmp (interface, sd_dbus_interface_service) == 0)
+    {
+      if (result_str != NULL)
+        rmg_mentry_set_result (mentry, result_str);
+
+      if (exec_main_code >= 0 && exec_main_status >= 0)
+        rmg_mentry_set_exec_main_status (mentry, exec_main_code, exec_main_status);
+
+      return 0;
+    }
+
+  if ((active_state_str == NULL) || (active_substate_str == NULL))
+    {
+      g_warning ("Cannot read current active state or substate");
+      return 0;
+    }
+
+  rmg_mentry_update_state (mentry, active_state_str, active_substate_str);
+
+  return 0;
+
+parse_error:
+  g_warning ("Fail to parse PropertiesChanged for unit '%s'. Error %s", mentry->service_name,
+             g_strerror (-r));
+
+  return 0;
+}
+
+static void
+remove_mentry_entry (gpointer _entry)
+{
+  rmg_mentry_unref ((RmgMEntry *)_entry);
+}
+
+static gboolean
+sdmonitor_connect (RmgSDMonitor *sdmonitor, GError **error)
+{
+  sd_bus *bus = NULL;
+  gint r;
+
+  r = sd_bus_open_system (&bus);
+  if (r < 0)
+    {
+      g_set_error (error, g_quark_from_static_string ("SDMonitorNew"), 1,
+                   "Fail to open system bus. Error %s", g_strerror (-r));
+      return FALSE;
+    }
+
+  sdmonitor->bus = bus;
+
+  /* a single match covers the state changes of all units */
+  r = sd_bus_add_match (sdmonitor->bus, &sdmonitor->match_slot,
+                        "type='signal',"
+                        "sender='org.freedesktop.systemd1',"
+                        "interface='org.freedesktop.DBus.Properties',"
+                        "member='PropertiesChanged',"
+                        "arg0='org.freedesktop.systemd1.Unit'",
+                        on_unit_properties_changed, sdmonitor);
+  if (r < 0)
+    g_warning ("Fail to add PropertiesChanged match. Error %s", g_strerror (-r));
+
+  /* the failure result is read from the same signal stream without extra calls */
+  r = sd_bus_add_match (sdmonitor->bus, &sdmonitor->service_match_slot,
+                        "type='signal',"
+                        "sender='org.freedesktop.systemd1',"
+                        "interface='org.freedesktop.DBus.Properties',"
+                        "member='PropertiesChanged',"
+                        "arg0='org.freedesktop.systemd1.Service'",
+                        on_unit_properties_changed, sdmonitor);
+  if (r < 0)
+    g_warning ("Fail to add Service PropertiesChanged match. Error %s", g_strerror (-r));
+
+  r = sd_bus_call_method_async (sdmonitor->bus, NULL, sd_dbus_name, sd_dbus_object_path,
+                                sd_dbus_interface_manager, "Subscribe", NULL, NULL, "");
+  if (r < 0)
+    g_warning ("Fail to subscribe to systemd manager. Error %s", g_strerror (-r));
+
+  sdmonitor->fd_tag = g_source_add_unix_fd (RMG_EVENT_SOURCE (sdmonitor),
+                                            sd_bus_get_fd (sdmonitor->bus), G_IO_IN);
+
+  return TRUE;
+}
+
+static void
+sdmonitor_disconnect (RmgSDMonitor *sdmonitor)
+{
+  if (sdmonitor->fd_tag != NULL)
+    {
+      g_source_remove_unix_fd (RMG_EVENT_SOURCE (sdmonitor), sdmonitor->fd_tag);
+      sdmonitor->fd_tag = NULL;
+    }
+
+  if (sdmonitor->match_slot != NULL)
+    sdmonitor->match_slot = sd_bus_slot_unref (sdmonitor->match_slot);
+
+  if (sdmonitor->service_match_slot != NULL)
+    sdmonitor->service_match_slot = sd_bus_slot_unref (sdmonitor->service_match_slot);
+
+  if (sdmonitor->bus != NULL)
+    sdmonitor->bus = sd_bus_flush_close_unref (sdmonitor->bus);
+}
+
+RmgSDMonitor *
+rmg_sdmonitor_new (GError **error)
+{
+  RmgSDMonitor *sdmonitor
+      = (RmgSDMonitor *)g_source_new (&sdmonitor_source_funcs, sizeof (RmgSDMonitor));
+
+  g_assert (sdmonitor);
+
+  g_ref_count_init (&sdmonitor->rc);
+
+  sdmonitor->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, remove_mentry_entry);
+
+  if (!sdmonitor_connect (sdmonitor, error))
+    {
+      rmg_sdmonitor_unref (sdmonitor);
+      return NULL;
+    }
+
+  g_source_set_callback (RMG_EVENT_SOURCE (sdmonitor), NULL, sdmonitor,
+                         sdmonitor_source_destroy_notify);
+  g_source_attach (RMG_EVENT_SOURCE (sdmonitor), NULL);
+
+  return sdmonitor;
+}
+
+RmgSDMonitor *
+rmg_sdmonitor_ref (RmgSDMonitor *sdmonitor)
+{
+  g_assert (sdmonitor);
+  g_ref_count_inc (&sdmonitor->rc);
+  return sdmonitor;
+}
+
+void
+rmg_sdmonitor_unref (RmgSDMonitor *sdmonitor)
+{
+  g_assert (sdmonitor);
+
+  if (g_ref_count_dec (&sdmonitor->rc) == TRUE)
+    {
+      if (sdmonitor->reconnect_source != 0)
+        g_source_remove (sdmonitor->reconnect_source);
+
+      sdmonitor_disconnect (sdmonitor);
+
+      g_hash_table_destroy (sdmonitor->entries);
+      g_source_unref (RMG_EVENT_SOURCE (sdmonitor));
+    }
+}
+
+void
+rmg_sdmonitor_add_entry (RmgSDMonitor *sdmonitor, RmgMEntry *mentry)
+{
+  g_assert (sdmonitor);
+  g_assert (mentry);
+
+  g_hash_table_replace (sdmonitor->entries, mentry->object_path, rmg_mentry_ref (mentry));
+}
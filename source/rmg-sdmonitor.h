@@ -0,0 +1,78 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-sdmonitor.h
+ */
+
+#pragma once
+
+#include "rmg-mentry.h"
+#include "rmg-types.h"
+
+#include <glib.h>
+#include <systemd/sd-bus.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgSDMonitor
+ * @brief The RmgSDMonitor opaque data structure
+ */
+typedef struct _RmgSDMonitor
+{
+  GSource source;                  /**< Event loop source */
+  gpointer fd_tag;                 /**< The sd-bus file descriptor tag */
+  sd_bus *bus;                     /**< Private system bus connection */
+  sd_bus_slot *match_slot;         /**< Unit PropertiesChanged match */
+  sd_bus_slot *service_match_slot; /**< Service PropertiesChanged match */
+  GHashTable *entries;             /**< Monitored entries indexed by unit object path */
+  guint reconnect_source;          /**< Reconnect timer while the connection is closed */
+  grefcount rc;                    /**< Reference counter variable  */
+} RmgSDMonitor;
+
+/*
+ * @brief Create a new sd-bus monitor object
+ * @param error The error object set on connection failure
+ * @return On success return a new RmgSDMonitor object otherwise return NULL
+ */
+RmgSDMonitor *rmg_sdmonitor_new (GError **error);
+
+/**
+ * @brief Aquire sdmonitor object
+ * @param sdmonitor Pointer to the sdmonitor object
+ */
+RmgSDMonitor *rmg_sdmonitor_ref (RmgSDMonitor *sdmonitor);
+
+/**
+ * @brief Release sdmonitor object
+ * @param sdmonitor Pointer to the sdmonitor object
+ */
+void rmg_sdmonitor_unref (RmgSDMonitor *sdmonitor);
+
+/**
+ * @brief Add a monitor entry to receive unit state changes
+ * @param sdmonitor Pointer to the sdmonitor object
+ * @param mentry The monitor entry, a reference is kept by sdmonitor
+ */
+void rmg_sdmonitor_add_entry (RmgSDMonitor *sdmonitor, RmgMEntry *mentry);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (RmgSDMonitor, rmg_sdmonitor_unref);
+
+G_END_DECLS
@@ -34,6 +34,8 @@ G_BEGIN_DECLS
 
 #define RMG_EVENT_SOURCE(x) (GSource *)(x)
 
+#define RMG_FAILURE_MASK(r) (1U << (guint)(r))
+
 typedef enum _RmgStatus
 {
   RMG_STATUS_ERROR = -1,
@@ -92,20 +94,75 @@ typedef enum _RmgFriendActionType
   FRIEND_ACTION_INVALID
 } RmgFriendActionType;
 
+/**
+ * @enum Failure reason
+ * @brief The reason a service failed as reported by the service manager
+ *   The names match the unit Result property except sigkill which is a
+ *   signal failure with SIGKILL as main process status, probe which is
+ *   a liveness probe failure of an active service and dependency which is
+ *   a restart job failed on a unit dependency.
+ */
+typedef enum _RmgFailureReason
+{
+  FAILURE_UNKNOWN,
+  FAILURE_EXIT_CODE,
+  FAILURE_SIGNAL,
+  FAILURE_SIGKILL,
+  FAILURE_CORE_DUMP,
+  FAILURE_OOM_KILL,
+  FAILURE_WATCHDOG,
+  FAILURE_TIMEOUT,
+  FAILURE_START_LIMIT_HIT,
+  FAILURE_RESOURCES,
+  FAILURE_PROBE,
+  FAILURE_DEPENDENCY,
+  FAILURE_INVALID
+} RmgFailureReason;
+
+/**
+ * @enum Probe type
+ * @brief The type of liveness probe
+ */
+typedef enum _RmgProbeType
+{
+  PROBE_UNKNOWN,
+  PROBE_CONNECT,
+  PROBE_DBUS,
+  PROBE_EXEC,
+  PROBE_HEARTBEAT,
+  PROBE_INVALID
+} RmgProbeType;
+
 /**
  * @struct RmgFriendResponseEntry
  * @brief The RmgFriendResponseEntry data structure
  */
 typedef struct _RmgFriendResponseEntry
 {
-  gchar *service_name;
+  gchar *service_name; /**< Friend service name atom */
   RmgFriendActionType action;
   glong argument;
   glong delay;
 } RmgFriendResponseEntry;
 
+/**
+ * @struct RmgProbeResponseEntry
+ * @brief The RmgProbeResponseEntry data structure
+ */
+typedef struct _RmgProbeResponseEntry
+{
+  gchar *service_name; /**< Probed service name atom */
+  RmgProbeType type;
+  gchar *target;
+  glong interval;
+  glong timeout;
+  glong threshold;
+} RmgProbeResponseEntry;
+
 /* Preserve the size and order from RmgActionType */
 extern const gchar *g_action_name[];
+/* Preserve the size and order from RmgFailureReason */
+extern const gchar *g_failure_name[];
 extern RmgRunMode g_run_mode;
 
 G_END_DECLS
@@ -51,6 +51,15 @@ const gchar *g_friend_name[] = { "unknown", "process", "service", "invalid" };
 const gchar *g_friend_action_name[]
     = { "unknown", "start", "stop", "restart", "signal", "invalid" };
 
+/* Preserve the size and order from RmgFailureReason */
+const gchar *g_failure_name[]
+    = { "unknown",  "exit-code", "signal",          "sigkill",   "core-dump",  "oom-kill",
+        "watchdog", "timeout",   "start-limit-hit", "resources", "probe",      "dependency",
+        "invalid" };
+
+/* Preserve the size and order from RmgProbeType */
+const gchar *g_probe_name[] = { "unknown", "connect", "dbus", "exec", "heartbeat", "invalid" };
+
 static gchar *os_version = NULL;
 
 RmgActionType
@@ -107,40 +116,66 @@ rmg_utils_friend_action_name (RmgFriendActionType type)
   return g_friend_action_name[type];
 }
 
-gchar *
-rmg_utils_get_procname (pid_t pid)
+RmgProbeType
+rmg_utils_probe_type_from (const gchar *name)
 {
-  g_autofree gchar *statfile = NULL;
-  gboolean done = FALSE;
-  gchar *retval = NULL;
-  gchar tmpbuf[TMP_BUFFER_SIZE];
-  FILE *fstm;
+  for (gint i = 0; i < PROBE_INVALID; i++)
+    {
+      if (g_strcmp0 (g_probe_name[i], name) == 0)
+        return (RmgProbeType)i;
+    }
 
-  statfile = g_strdup_printf ("/proc/%d/status", pid);
+  return PROBE_UNKNOWN;
+}
+
+const gchar *
+rmg_utils_probe_name (RmgProbeType type)
+{
+  return g_probe_name[type];
+}
 
-  if ((fstm = fopen (statfile, "r")) == NULL)
+RmgFailureReason
+rmg_utils_failure_reason_from (const gchar *name)
+{
+  for (gint i = 0; i < FAILURE_INVALID; i++)
     {
-      g_warning ("Open status file '%s' for dumping %s", statfile, strerror (errno));
-      return NULL;
+      if (g_strcmp0 (g_failure_name[i], name) == 0)
+        return (RmgFailureReason)i;
     }
 
-  while (fgets (tmpbuf, sizeof (tmpbuf), fstm) && !done)
-    {
-      gchar *name = g_strrstr (tmpbuf, "Name:");
+  return FAILURE_UNKNOWN;
+}
 
-      if (name != NULL)
-        {
-          retval = g_strdup (name + strlen ("Name:") + 1);
-          if (retval != NULL)
-            g_strstrip (retval);
+const gchar *
+rmg_utils_failure_name (RmgFailureReason reason)
+{
+  return g_failure_name[reason];
+}
 
-          done = TRUE;
-        }
+guint
+rmg_utils_failure_mask_from (const gchar *names)
+{
+  gchar **tokens = NULL;
+  guint mask = 0;
+
+  if (names == NULL)
+    return 0;
+
+  tokens = g_strsplit (names, ",", -1);
+
+  for (gint i = 0; tokens[i] != NULL; i++)
+    {
+      RmgFailureReason reason = rmg_utils_failure_reason_from (g_strstrip (tokens[i]));
+
+      if (reason == FAILURE_UNKNOWN)
+        g_warning ("Unknown failure reason '%s'", tokens[i]);
+      else
+        mask |= RMG_FAILURE_MASK (reason);
     }
 
-  fclose (fstm);
+  g_strfreev (tokens);
 
-  return retval;
+  return mask;
 }
 
 gchar *
@@ -262,46 +297,17 @@ rmg_utils_chown (const gchar *file_path, const gchar *user_name, const gchar *gr
   return status;
 }
 
-pid_t
-rmg_utils_first_pid_for_process (const gchar *exepath)
+void
+rmg_utils_set_name (gchar **name, const gchar *value)
 {
-  g_autoptr (GError) error = NULL;
-  const gchar *nfile = NULL;
-  GDir *gdir = NULL;
-  pid_t pid = -1;
+  gchar *atom = NULL;
 
-  g_assert (exepath);
-
-  gdir = g_dir_open ("/proc", 0, &error);
-  if (error != NULL)
-    {
-      g_warning ("Fail to open proc directory. Error %s", error->message);
-      return -1;
-    }
-
-  while ((nfile = g_dir_read_name (gdir)) != NULL)
-    {
-      g_autofree gchar *fpath = NULL;
-      g_autofree gchar *lnexe = NULL;
-      gint64 pent = 0;
-
-      pent = g_ascii_strtoll (nfile, NULL, 10);
-      if (pent == 0)
-        continue;
-
-      fpath = g_strdup_printf ("/proc/%s/exe", nfile);
-      if (fpath == NULL)
-        continue;
-
-      lnexe = g_file_read_link (fpath, NULL);
-      if (g_strcmp0 (lnexe, exepath) == 0)
-        {
-          pid = (pid_t)pent;
-          break;
-        }
-    }
+  g_assert (name);
 
-  g_dir_close (gdir);
+  /* acquired before the release in case the value is the current atom */
+  if (value != NULL)
+    atom = g_ref_string_new_intern (value);
 
-  return pid;
+  g_clear_pointer (name, g_ref_string_release);
+  *name = atom;
 }
@@ -29,13 +29,6 @@
 
 G_BEGIN_DECLS
 
-/**
- * @brief Get process name for pid
- * @param pid Process ID to lookup for
- * @return new allocated string with proc name or NULL if not found
- */
-gchar *rmg_utils_get_procname (pid_t pid);
-
 /**
  * @brief Get process exe path for pid
  * @param pid Process ID to lookup for
@@ -63,20 +56,6 @@ guint64 rmg_utils_jenkins_hash (const gchar *key);
  */
 gint64 rmg_utils_get_filesize (const gchar *file_path);
 
-/**
- * @brief Get pid for process by name
- *
- * Note that this function only looks for pid by name once
- * Will not provide the information if multiple instances are running
- * Should be used only as info to check if a particular process has at least an
- * instance running
- *
- * @param exepath Path to process executable
- *
- * @return Pid value if found, -1 ottherwise
- */
-pid_t rmg_utils_first_pid_for_process (const gchar *exepath);
-
 /**
  * @brief Change owner for a filesystem entry
  *
@@ -103,6 +82,27 @@ RmgActionType rmg_utils_action_type_from (const gchar *name);
  */
 const gchar *rmg_utils_action_name (RmgActionType type);
 
+/**
+ * @brief Get failure reason from the unit Result name
+ * @param name Failure reason name
+ * @return The failure reason or FAILURE_UNKNOWN
+ */
+RmgFailureReason rmg_utils_failure_reason_from (const gchar *name);
+
+/**
+ * @brief Get failure reason as string name
+ * @param reason Failure reason
+ * @return Const failure reason name
+ */
+const gchar *rmg_utils_failure_name (RmgFailureReason reason);
+
+/**
+ * @brief Get failure reason mask from a comma separated list of names
+ * @param names Failure reason names
+ * @return The mask with RMG_FAILURE_MASK bits set for each known reason
+ */
+guint rmg_utils_failure_mask_from (const gchar *names);
+
 /**
  * @brief Get friend type from string name
  * @param name Friend name
@@ -131,4 +131,27 @@ RmgFriendActionType rmg_utils_friend_action_type_from (const gchar *name);
  */
 const gchar *rmg_utils_friend_action_name (RmgFriendActionType type);
 
+/**
+ * @brief Get probe type from string name
+ * @param name Probe type name
+ * @return The probe type
+ */
+RmgProbeType rmg_utils_probe_type_from (const gchar *name);
+
+/**
+ * @brief Get probe type as string name
+ * @param type Probe type
+ * @return Const probe type name
+ */
+const gchar *rmg_utils_probe_name (RmgProbeType type);
+
+/**
+ * @brief Replace a name atom
+ * Names are refcounted interned strings so equal names share one pointer and the
+ * string is freed with the last object holding it.
+ * @param name Location of the name atom, the previous atom is released
+ * @param value The new name or NULL
+ */
+void rmg_utils_set_name (gchar **name, const gchar *value);
+
 G_END_DECLS
@@ -0,0 +1,176 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file bench-batchread.c
+ */
+
+#include "rmg-batchread.h"
+#include "rmg-bench.h"
+
+#include <glib/gstdio.h>
+#include <stdlib.h>
+
+/**
+ * @struct BenchBatch
+ * @brief State of a batched read run
+ */
+typedef struct _BenchBatch
+{
+  GMainLoop *loop; /**< Loop quit once the batch is done */
+  gsize bytes;     /**< Content bytes read */
+  guint failed;    /**< Files not read */
+} BenchBatch;
+
+static GPtrArray *
+create_files (const gchar *dir, guint count)
+{
+  GPtrArray *paths = g_ptr_array_new_with_free_func (g_free);
+
+  /* one cgroup file per process, as the pid cache seed reads them */
+  for (guint i = 0; i < count; i++)
+    {
+      g_autofree gchar *content = NULL;
+      gchar *path = g_strdup_printf ("%s/%u.cgroup", dir, i);
+
+      content = g_strdup_printf ("0::/system.slice/bench%u.service\n", i);
+      if (!g_file_set_contents (path, content, -1, NULL))
+        g_error ("Cannot create %s", path);
+
+      g_ptr_array_add (paths, path);
+    }
+
+  return paths;
+}
+
+static void
+remove_files (const gchar *dir, GPtrArray *paths)
+{
+  for (guint i = 0; i < paths->len; i++)
+    g_unlink ((const gchar *)g_ptr_array_index (paths, i));
+
+  g_rmdir (dir);
+  g_ptr_array_unref (paths);
+}
+
+static void
+batch_read_callback (gpointer tag, const gchar *content, gsize length, gint error,
+                     gpointer user_data)
+{
+  BenchBatch *run = (BenchBatch *)user_data;
+
+  RMG_UNUSED (tag);
+
+  if (content == NULL || error != 0)
+    run->failed++;
+  else
+    run->bytes += length;
+}
+
+static void
+batch_done_callback (gpointer user_data)
+{
+  g_main_loop_quit (((BenchBatch *)user_data)->loop);
+}
+
+static gsize
+run_batched (GPtrArray *paths)
+{
+  BenchBatch run = { .loop = g_main_loop_new (NULL, FALSE) };
+  RmgBatchRead *batch = rmg_batchread_new (batch_read_callback, batch_done_callback, &run, NULL);
+
+  for (guint i = 0; i < paths->len; i++)
+    rmg_batchread_add (batch, (const gchar *)g_ptr_array_index (paths, i), NULL);
+
+  rmg_batchread_submit (batch);
+  g_main_loop_run (run.loop);
+  g_main_loop_unref (run.loop);
+
+  if (run.failed > 0)
+    g_error ("Batched read failed for %u files", run.failed);
+
+  return run.bytes;
+}
+
+static gsize
+run_sequential (GPtrArray *paths)
+{
+  gsize bytes = 0;
+
+  /* the blocking open, read and close per file the batch replaces */
+  for (guint i = 0; i < paths->len; i++)
+    {
+      g_autofree gchar *content = NULL;
+      gsize length = 0;
+
+      if (!g_file_get_contents ((const gchar *)g_ptr_array_index (paths, i), &content, &length,
+                                NULL))
+        g_error ("Sequential read failed");
+
+      bytes += length;
+    }
+
+  return bytes;
+}
+
+static void
+run_case (guint count, guint64 rounds)
+{
+  g_autofree gchar *dir = g_dir_make_tmp ("rmg-bench-XXXXXX", NULL);
+  g_autofree gchar *batched_name = NULL;
+  g_autofree gchar *sequential_name = NULL;
+  GPtrArray *paths = NULL;
+  RmgBench bench;
+
+  if (dir == NULL)
+    g_error ("Cannot create the benchmark directory");
+
+  paths = create_files (dir, count);
+  batched_name = g_strdup_printf ("batched read, %u files", count);
+  sequential_name = g_strdup_printf ("sequential read, %u files", count);
+
+  rmg_bench_start (&bench, sequential_name, rounds * count);
+  for (guint64 i = 0; i < rounds; i++)
+    run_sequential (paths);
+  rmg_bench_stop (&bench);
+
+  rmg_bench_start (&bench, batched_name, rounds * count);
+  for (guint64 i = 0; i < rounds; i++)
+    run_batched (paths);
+  rmg_bench_stop (&bench);
+
+  remove_files (dir, paths);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  guint64 rounds = rmg_bench_ops_from (argc, argv, 20);
+
+#ifdef WITH_IO_URING
+  g_print ("batched reads use io_uring when the kernel allows it\n");
+#else
+  g_print ("batched reads use the sequential fallback, build with IO_URING for the ring\n");
+#endif
+
+  run_case (1000, rounds);
+  run_case (10000, rounds);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file bench-devent-pool.c
+ */
+
+#include "rmg-bench.h"
+#include "rmg-devent.h"
+#include "rmg-eventqueue.h"
+#include "rmg-pool.h"
+
+#include <stdlib.h>
+
+/* failures detected at once when a shared dependency goes down */
+#define BENCH_BURST (64)
+
+static const gchar *service_names[]
+    = { "audio.service", "navigation.service", "telephony.service", "media.service" };
+
+static RmgDEvent *
+crash_event (guint64 index)
+{
+  RmgDEvent *event = rmg_devent_new (DEVENT_SERVICE_CRASHED);
+
+  /* the names a crash event carries from the monitor to the executor */
+  rmg_devent_set_service_name (event, service_names[index % G_N_ELEMENTS (service_names)]);
+  rmg_devent_set_object_path (event, "/org/freedesktop/systemd1/unit/audio_2eservice");
+  rmg_devent_set_context_name (event, "host");
+
+  return event;
+}
+
+static gboolean
+consume_event (gpointer _owner, gpointer _event)
+{
+  guint64 *consumed = (guint64 *)_owner;
+
+  rmg_devent_unref ((RmgDEvent *)_event);
+  (*consumed)++;
+
+  return TRUE;
+}
+
+static void
+run_lifecycle (const gchar *name, guint64 ops)
+{
+  RmgBench bench;
+
+  rmg_bench_start (&bench, name, ops);
+  for (guint64 i = 0; i < ops; i++)
+    rmg_devent_unref (crash_event (i));
+  rmg_bench_stop (&bench);
+}
+
+static void
+run_queue_burst (const gchar *name, guint64 ops)
+{
+  g_autoptr (RmgEventQueue) queue = NULL;
+  guint64 consumed = 0;
+  RmgBench bench;
+
+  queue = rmg_eventqueue_new ("bench", BENCH_BURST, BENCH_BURST, EVENTQUEUE_OVERFLOW_GROW,
+                              (GDestroyNotify)rmg_devent_unref);
+
+  rmg_bench_start (&bench, name, ops);
+  for (guint64 i = 0; i < ops; i += BENCH_BURST)
+    {
+      for (guint j = 0; j < BENCH_BURST; j++)
+        rmg_eventqueue_push (queue, crash_event (i + j));
+
+      while (consumed < i + BENCH_BURST)
+        rmg_eventqueue_dispatch (queue, consume_event, &consumed);
+    }
+  rmg_bench_stop (&bench);
+}
+
+static void
+run_pool_burst (guint capacity, guint burst, guint64 ops)
+{
+  g_autoptr (RmgPool) pool = rmg_pool_new ("bench", sizeof (RmgDEvent), capacity);
+  gpointer *blocks = g_new0 (gpointer, burst);
+  g_autofree gchar *name = NULL;
+  guint64 events = 0;
+
+  /* allocator calls per event are the blocks the pool could not serve from the slab */
+  for (guint64 i = 0; i < ops; i += burst)
+    {
+      for (guint j = 0; j < burst; j++)
+        blocks[j] = rmg_pool_alloc0 (pool);
+
+      for (guint j = 0; j < burst; j++)
+        rmg_pool_free (pool, blocks[j]);
+
+      events += burst;
+    }
+
+  name = g_strdup_printf ("pool burst %u, capacity %u", burst, capacity);
+  g_print ("%-40s %12" G_GUINT64_FORMAT " ops %10.3f heap allocs/op\n", name, events,
+           (gdouble)pool->heap_allocs / (gdouble)events);
+
+  g_free (blocks);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  guint64 ops = rmg_bench_ops_from (argc, argv, 1000000);
+
+  /* warm up the name atoms so neither case pays for the first intern */
+  rmg_devent_unref (crash_event (0));
+
+  run_lifecycle ("devent lifecycle, heap", ops);
+  run_queue_burst ("devent queue burst, heap", ops);
+
+  rmg_devent_init_pool (BENCH_BURST * 2);
+
+  run_lifecycle ("devent lifecycle, pool", ops);
+  run_queue_burst ("devent queue burst, pool", ops);
+
+  rmg_devent_release_pool ();
+
+  run_pool_burst (BENCH_BURST * 2, BENCH_BURST, ops);
+  run_pool_burst (BENCH_BURST * 2, BENCH_BURST * 4, ops);
+
+  return EXIT_SUCCESS;
+}
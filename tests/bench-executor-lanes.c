@@ -0,0 +1,294 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file bench-executor-lanes.c
+ */
+
+#include "rmg-bench.h"
+#include "rmg-defaults.h"
+#include "rmg-executor.h"
+
+#include <glib/gstdio.h>
+#include <stdlib.h>
+
+/* one in this many failed services also has its public data reset */
+#define BENCH_RESET_RATIO (4)
+
+/* the executor worker counts compared */
+static const guint bench_workers[] = { 1, 4, 16 };
+
+static const gchar manager_xml[]
+    = "<node>"
+      "  <interface name='org.freedesktop.systemd1.Manager'>"
+      "    <method name='RestartUnit'>"
+      "      <arg type='s' name='name' direction='in'/>"
+      "      <arg type='s' name='mode' direction='in'/>"
+      "      <arg type='o' name='job' direction='out'/>"
+      "    </method>"
+      "  </interface>"
+      "</node>";
+
+/**
+ * @struct BenchManager
+ * @brief In-process stand-in for the systemd manager on a peer connection
+ */
+typedef struct _BenchManager
+{
+  GDBusServer *server;         /**< Peer server the executor connects to */
+  GDBusNodeInfo *node;         /**< Manager introspection data */
+  GDBusConnection *connection; /**< Server side of the peer connection */
+  GDBusProxy *proxy;           /**< Manager proxy passed with the events */
+  guint jobs;                  /**< Jobs queued */
+} BenchManager;
+
+static void
+manager_method_call (GDBusConnection *connection, const gchar *sender, const gchar *object_path,
+                     const gchar *interface_name, const gchar *method_name, GVariant *parameters,
+                     GDBusMethodInvocation *invocation, gpointer user_data)
+{
+  BenchManager *manager = (BenchManager *)user_data;
+  g_autofree gchar *job_path = NULL;
+
+  RMG_UNUSED (connection);
+  RMG_UNUSED (sender);
+  RMG_UNUSED (object_path);
+  RMG_UNUSED (interface_name);
+  RMG_UNUSED (method_name);
+  RMG_UNUSED (parameters);
+
+  /* systemd replies once the job is queued, before the unit restarts */
+  job_path = g_strdup_printf ("/org/freedesktop/systemd1/job/%u", ++manager->jobs);
+  g_dbus_method_invocation_return_value (invocation, g_variant_new ("(o)", job_path));
+}
+
+static const GDBusInterfaceVTable manager_vtable = { manager_method_call, NULL, NULL, { NULL } };
+
+static gboolean
+manager_new_connection (GDBusServer *server, GDBusConnection *connection, gpointer user_data)
+{
+  BenchManager *manager = (BenchManager *)user_data;
+
+  RMG_UNUSED (server);
+
+  if (g_dbus_connection_register_object (connection, "/org/freedesktop/systemd1",
+                                         manager->node->interfaces[0], &manager_vtable, manager,
+                                         NULL, NULL)
+      == 0)
+    g_error ("Cannot register the manager object");
+
+  g_atomic_pointer_set (&manager->connection, g_object_ref (connection));
+
+  return TRUE;
+}
+
+static void
+manager_start (BenchManager *manager, const gchar *dir)
+{
+  g_autofree gchar *guid = g_dbus_generate_guid ();
+  g_autofree gchar *address = g_strdup_printf ("unix:tmpdir=%s", dir);
+  g_autoptr (GDBusConnection) connection = NULL;
+  g_autoptr (GError) error = NULL;
+
+  manager->node = g_dbus_node_info_new_for_xml (manager_xml, &error);
+  manager->server = g_dbus_server_new_sync (address,
+                                            G_DBUS_SERVER_FLAGS_AUTHENTICATION_ALLOW_ANONYMOUS,
+                                            guid, NULL, NULL, &error);
+  if (manager->server == NULL)
+    g_error ("Cannot create the manager server. Error %s", error->message);
+
+  g_signal_connect (manager->server, "new-connection", G_CALLBACK (manager_new_connection),
+                    manager);
+  g_dbus_server_start (manager->server);
+
+  connection = g_dbus_connection_new_for_address_sync (
+      g_dbus_server_get_client_address (manager->server),
+      G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, NULL, NULL, &error);
+  if (connection == NULL)
+    g_error ("Cannot connect to the manager server. Error %s", error->message);
+
+  /* the object is registered from the server thread, events are pushed once it is there */
+  while (g_atomic_pointer_get (&manager->connection) == NULL)
+    g_main_context_iteration (NULL, FALSE);
+
+  manager->proxy = g_dbus_proxy_new_sync (
+      connection,
+      G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES | G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS, NULL,
+      NULL, "/org/freedesktop/systemd1", "org.freedesktop.systemd1.Manager", NULL, &error);
+  if (manager->proxy == NULL)
+    g_error ("Cannot create the manager proxy. Error %s", error->message);
+}
+
+static void
+manager_stop (BenchManager *manager)
+{
+  g_clear_object (&manager->proxy);
+  g_clear_object (&manager->connection);
+  g_dbus_server_stop (manager->server);
+  g_clear_object (&manager->server);
+  g_clear_pointer (&manager->node, g_dbus_node_info_unref);
+}
+
+static RmgOptions *
+bench_options (const gchar *dir, guint workers)
+{
+  g_autofree gchar *conf_path = g_build_filename (dir, "recoverymanager.conf", NULL);
+  g_autofree gchar *conf = NULL;
+
+  /* the data reset command stands in for a slow reset of a large data directory */
+  conf = g_strdup_printf ("[recoverymanager]\n"
+                          "DatabaseDirectory = %s\n"
+                          "DataResetMode = command\n"
+                          "PublicDataResetCommand = sleep 0.05\n"
+                          "ExecutorWorkers = %u\n",
+                          dir, workers);
+
+  if (!g_file_set_contents (conf_path, conf, -1, NULL))
+    g_error ("Cannot write %s", conf_path);
+
+  return rmg_options_new (conf_path);
+}
+
+/**
+ * @struct BenchRun
+ * @brief A storm of failures handled by one executor
+ */
+typedef struct _BenchRun
+{
+  RmgExecutor *executor; /**< Executor under test */
+  GMainLoop *loop;       /**< Loop quit once the executor is idle */
+} BenchRun;
+
+static gboolean
+executor_idle_check (gpointer user_data)
+{
+  BenchRun *run = (BenchRun *)user_data;
+  RmgExecutor *executor = run->executor;
+
+  if (executor->running > 0 || !g_queue_is_empty (executor->pending)
+      || executor->queue->depth > 0)
+    return G_SOURCE_CONTINUE;
+
+  g_main_loop_quit (run->loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+add_services (RmgJournal *journal, const gchar *dir, guint services)
+{
+  for (guint i = 0; i < services; i++)
+    {
+      g_autofree gchar *service_name = g_strdup_printf ("bench%u.service", i);
+
+      if (rmg_journal_add_service (journal, i, service_name, dir, dir, FALSE, FALSE, 0, NULL)
+          != RMG_STATUS_OK)
+        g_error ("Cannot add %s to the journal", service_name);
+    }
+}
+
+static void
+run_storm (BenchManager *manager, guint workers, guint services)
+{
+  g_autofree gchar *dir = g_dir_make_tmp ("rmg-bench-XXXXXX", NULL);
+  g_autofree gchar *database = NULL;
+  g_autofree gchar *conf = NULL;
+  g_autofree gchar *name = NULL;
+  RmgOptions *options = NULL;
+  RmgJournal *journal = NULL;
+  g_autoptr (GError) error = NULL;
+  BenchRun run = { 0 };
+  guint jobs = manager->jobs;
+  RmgBench bench;
+
+  if (dir == NULL)
+    g_error ("Cannot create the benchmark directory");
+
+  options = bench_options (dir, workers);
+  journal = rmg_journal_new (options, &error);
+  if (journal == NULL || error != NULL)
+    g_error ("Cannot create the journal");
+
+  add_services (journal, dir, services);
+
+  run.executor = rmg_executor_new (options, journal);
+  run.loop = g_main_loop_new (NULL, FALSE);
+  name = g_strdup_printf ("%u failed services, %u workers", services, workers);
+
+  rmg_bench_start (&bench, name, services);
+
+  /* every service fails at once, some need their data reset before the restart */
+  for (guint i = 0; i < services; i++)
+    {
+      g_autofree gchar *service_name = g_strdup_printf ("bench%u.service", i);
+      RmgDEvent *event = rmg_devent_new (DEVENT_SERVICE_CRASHED);
+
+      rmg_devent_set_service_name (event, service_name);
+      rmg_devent_set_context_name (event, g_get_host_name ());
+      rmg_devent_set_manager_proxy (event, manager->proxy);
+
+      rmg_executor_push_event (run.executor,
+                               i % BENCH_RESET_RATIO == 0 ? EXECUTOR_EVENT_SERVICE_RESET_PUBLIC_DATA
+                                                          : EXECUTOR_EVENT_SERVICE_RESTART,
+                               event);
+      rmg_devent_unref (event);
+    }
+
+  g_timeout_add (1, executor_idle_check, &run);
+  g_main_loop_run (run.loop);
+
+  rmg_bench_stop (&bench);
+
+  if (manager->jobs - jobs != services)
+    g_error ("Expected %u restarts, the manager queued %u", services, manager->jobs - jobs);
+
+  /* the executor source holds the executor reference */
+  g_source_destroy (RMG_EVENT_SOURCE (run.executor));
+  g_main_loop_unref (run.loop);
+  rmg_journal_unref (journal);
+  rmg_options_unref (options);
+
+  database = g_build_filename (dir, RMG_DATABASE_FILE_NAME, NULL);
+  conf = g_build_filename (dir, "recoverymanager.conf", NULL);
+  g_unlink (database);
+  g_unlink (conf);
+  g_rmdir (dir);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  guint services = (guint)rmg_bench_ops_from (argc, argv, 256);
+  g_autofree gchar *dir = g_dir_make_tmp ("rmg-bench-XXXXXX", NULL);
+  BenchManager manager = { 0 };
+
+  if (dir == NULL)
+    g_error ("Cannot create the benchmark directory");
+
+  manager_start (&manager, dir);
+
+  for (guint i = 0; i < G_N_ELEMENTS (bench_workers); i++)
+    run_storm (&manager, bench_workers[i], services);
+
+  manager_stop (&manager);
+  rmg_executor_release_pool ();
+  g_rmdir (dir);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file bench-mentry-state.c
+ */
+
+#include "rmg-bench.h"
+#include "rmg-mentry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the name tables the perfect hash maps from, scanned linearly as the reference */
+extern const gchar *active_state_names[];
+extern const gchar *active_substate_names[];
+
+/**
+ * @struct BenchUnitState
+ * @brief A recorded unit state change
+ */
+typedef struct _BenchUnitState
+{
+  const gchar *active_state; /**< Recorded ActiveState */
+  const gchar *substate;     /**< Recorded SubState */
+} BenchUnitState;
+
+/* the Unit interface changes of a Restart=on-failure service crash and restart */
+static const BenchUnitState recorded_states[] = {
+  { "active", "running" },        { "deactivating", "stop-sigterm" },
+  { "failed", "failed" },         { "activating", "auto-restart" },
+  { "activating", "start-pre" },  { "activating", "start" },
+  { "active", "running" },        { "deactivating", "stop-post" },
+  { "inactive", "dead" },         { "activating", "auto-restart-queued" },
+  { "active", "exited" },         { "reloading", "reload-notify" },
+};
+
+static guint
+linear_index (const gchar **names, const gchar *name)
+{
+  for (guint i = 0; names[i] != NULL; i++)
+    {
+      if (strcmp (names[i], name) == 0)
+        return i;
+    }
+
+  return 0;
+}
+
+static GVariant *
+recorded_payload (const BenchUnitState *state)
+{
+  GVariantBuilder changed;
+
+  /* systemd sends the timestamps and the job along with the state of the Unit interface */
+  g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&changed, "{sv}", "ActiveState",
+                         g_variant_new_string (state->active_state));
+  g_variant_builder_add (&changed, "{sv}", "SubState", g_variant_new_string (state->substate));
+  g_variant_builder_add (&changed, "{sv}", "StateChangeTimestamp", g_variant_new_uint64 (1));
+  g_variant_builder_add (&changed, "{sv}", "StateChangeTimestampMonotonic",
+                         g_variant_new_uint64 (1));
+  g_variant_builder_add (&changed, "{sv}", "InactiveExitTimestamp", g_variant_new_uint64 (1));
+  g_variant_builder_add (&changed, "{sv}", "ActiveEnterTimestamp", g_variant_new_uint64 (1));
+  g_variant_builder_add (&changed, "{sv}", "ActiveExitTimestamp", g_variant_new_uint64 (1));
+  g_variant_builder_add (&changed, "{sv}", "InactiveEnterTimestamp", g_variant_new_uint64 (1));
+  g_variant_builder_add (&changed, "{sv}", "Job",
+                         g_variant_new ("(uo)", 0, "/org/freedesktop/systemd1/job/1"));
+
+  return g_variant_ref_sink (g_variant_new ("(sa{sv}as)", "org.freedesktop.systemd1.Unit",
+                                            &changed, NULL));
+}
+
+static guint
+decode_payload (GVariant *parameters, gboolean perfect_hash)
+{
+  g_autoptr (GVariant) changed_properties = NULL;
+  const gchar *properties_interface = NULL;
+  const gchar *active_state_str = NULL;
+  const gchar *active_substate_str = NULL;
+
+  /* the same steps as the monitor PropertiesChanged handler */
+  g_variant_get_child (parameters, 0, "&s", &properties_interface);
+  changed_properties = g_variant_get_child_value (parameters, 1);
+
+  if (!g_variant_lookup (changed_properties, "ActiveState", "&s", &active_state_str)
+      || !g_variant_lookup (changed_properties, "SubState", "&s", &active_substate_str))
+    return 0;
+
+  if (perfect_hash)
+    return (guint)rmg_mentry_active_state_from (active_state_str)
+           + (guint)rmg_mentry_active_substate_from (active_substate_str);
+
+  return linear_index (active_state_names, active_state_str)
+         + linear_index (active_substate_names, active_substate_str);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  guint64 ops = rmg_bench_ops_from (argc, argv, 1000000);
+  guint count = G_N_ELEMENTS (recorded_states);
+  GVariant *payloads[G_N_ELEMENTS (recorded_states)];
+  volatile guint sink = 0;
+  RmgBench bench;
+
+  for (guint i = 0; i < count; i++)
+    payloads[i] = recorded_payload (&recorded_states[i]);
+
+  rmg_bench_start (&bench, "state names, perfect hash", ops);
+  for (guint64 i = 0; i < ops; i++)
+    {
+      const BenchUnitState *state = &recorded_states[i % count];
+
+      sink += (guint)rmg_mentry_active_state_from (state->active_state)
+              + (guint)rmg_mentry_active_substate_from (state->substate);
+    }
+  rmg_bench_stop (&bench);
+
+  rmg_bench_start (&bench, "state names, linear scan", ops);
+  for (guint64 i = 0; i < ops; i++)
+    {
+      const BenchUnitState *state = &recorded_states[i % count];
+
+      sink += linear_index (active_state_names, state->active_state)
+              + linear_index (active_substate_names, state->substate);
+    }
+  rmg_bench_stop (&bench);
+
+  rmg_bench_start (&bench, "PropertiesChanged decode, perfect hash", ops);
+  for (guint64 i = 0; i < ops; i++)
+    sink += decode_payload (payloads[i % count], TRUE);
+  rmg_bench_stop (&bench);
+
+  rmg_bench_start (&bench, "PropertiesChanged decode, linear scan", ops);
+  for (guint64 i = 0; i < ops; i++)
+    sink += decode_payload (payloads[i % count], FALSE);
+  rmg_bench_stop (&bench);
+
+  for (guint i = 0; i < count; i++)
+    g_variant_unref (payloads[i]);
+
+  return sink > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,351 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file bench-signal-storm.c
+ */
+
+#include "rmg-bench.h"
+#include "rmg-mentry.h"
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <systemd/sd-bus.h>
+#include <time.h>
+
+/* units changing state during the storm */
+#define BENCH_UNITS (64)
+
+/**
+ * @struct BenchReceiver
+ * @brief State decoded by a monitoring backend
+ */
+typedef struct _BenchReceiver
+{
+  GHashTable *units; /**< Known unit object paths */
+  guint64 received;  /**< Signals handled */
+  guint states;      /**< Sum of the decoded states */
+} BenchReceiver;
+
+static gint64
+cpu_time (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+  return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static gchar *
+unit_path (guint64 index)
+{
+  return g_strdup_printf ("/org/freedesktop/systemd1/unit/bench%u_2eservice",
+                          (guint)(index % BENCH_UNITS));
+}
+
+static GVariant *
+state_change (guint64 index)
+{
+  GVariantBuilder changed;
+
+  /* the Unit interface change systemd emits on every state transition */
+  g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&changed, "{sv}", "ActiveState",
+                         g_variant_new_string (index % 2 == 0 ? "failed" : "active"));
+  g_variant_builder_add (&changed, "{sv}", "SubState",
+                         g_variant_new_string (index % 2 == 0 ? "failed" : "running"));
+  g_variant_builder_add (&changed, "{sv}", "StateChangeTimestamp", g_variant_new_uint64 (index));
+  g_variant_builder_add (&changed, "{sv}", "StateChangeTimestampMonotonic",
+                         g_variant_new_uint64 (index));
+  g_variant_builder_add (&changed, "{sv}", "ActiveEnterTimestamp", g_variant_new_uint64 (index));
+  g_variant_builder_add (&changed, "{sv}", "ActiveExitTimestamp", g_variant_new_uint64 (index));
+  g_variant_builder_add (&changed, "{sv}", "Job",
+                         g_variant_new ("(uo)", 0, "/org/freedesktop/systemd1/job/1"));
+
+  return g_variant_new ("(sa{sv}as)", "org.freedesktop.systemd1.Unit", &changed, NULL);
+}
+
+static void
+emit_storm (GDBusConnection *connection, guint64 signals)
+{
+  for (guint64 i = 0; i < signals; i++)
+    {
+      g_autofree gchar *path = unit_path (i);
+
+      g_dbus_connection_emit_signal (connection, NULL, path, "org.freedesktop.DBus.Properties",
+                                     "PropertiesChanged", state_change (i), NULL);
+    }
+
+  g_dbus_connection_flush_sync (connection, NULL, NULL);
+}
+
+static void
+gdbus_properties_changed (GDBusConnection *connection, const gchar *sender_name,
+                          const gchar *object_path, const gchar *interface_name,
+                          const gchar *signal_name, GVariant *parameters, gpointer user_data)
+{
+  BenchReceiver *receiver = (BenchReceiver *)user_data;
+  g_autoptr (GVariant) changed_properties = NULL;
+  const gchar *active_state_str = NULL;
+  const gchar *active_substate_str = NULL;
+  const gchar *properties_interface = NULL;
+
+  RMG_UNUSED (connection);
+  RMG_UNUSED (sender_name);
+  RMG_UNUSED (interface_name);
+  RMG_UNUSED (signal_name);
+
+  receiver->received++;
+
+  /* the same steps as the GDBus monitor handler */
+  if (!g_hash_table_contains (receiver->units, object_path))
+    return;
+
+  g_variant_get_child (parameters, 0, "&s", &properties_interface);
+  changed_properties = g_variant_get_child_value (parameters, 1);
+
+  if (g_variant_lookup (changed_properties, "ActiveState", "&s", &active_state_str)
+      && g_variant_lookup (changed_properties, "SubState", "&s", &active_substate_str))
+    {
+      receiver->states += (guint)rmg_mentry_active_state_from (active_state_str)
+                          + (guint)rmg_mentry_active_substate_from (active_substate_str);
+    }
+}
+
+static gint
+sdbus_properties_changed (sd_bus_message *m, void *userdata, sd_bus_error *ret_error)
+{
+  BenchReceiver *receiver = (BenchReceiver *)userdata;
+  const gchar *active_state_str = NULL;
+  const gchar *active_substate_str = NULL;
+  const gchar *interface = NULL;
+  const gchar *key = NULL;
+  gint r;
+
+  RMG_UNUSED (ret_error);
+
+  receiver->received++;
+
+  /* the same steps as the sd-bus monitor handler */
+  if (!g_hash_table_contains (receiver->units, sd_bus_message_get_path (m)))
+    return 0;
+
+  if (sd_bus_message_read_basic (m, SD_BUS_TYPE_STRING, &interface) < 0
+      || sd_bus_message_enter_container (m, SD_BUS_TYPE_ARRAY, "{sv}") < 0)
+    return 0;
+
+  while ((r = sd_bus_message_enter_container (m, SD_BUS_TYPE_DICT_ENTRY, "sv")) > 0)
+    {
+      if (sd_bus_message_read_basic (m, SD_BUS_TYPE_STRING, &key) < 0)
+        return 0;
+
+      if (strcmp (key, "ActiveState") == 0)
+        r = sd_bus_message_read (m, "v", "s", &active_state_str);
+      else if (strcmp (key, "SubState") == 0)
+        r = sd_bus_message_read (m, "v", "s", &active_substate_str);
+      else
+        r = sd_bus_message_skip (m, "v");
+
+      if (r < 0 || sd_bus_message_exit_container (m) < 0)
+        return 0;
+    }
+
+  if (active_state_str != NULL && active_substate_str != NULL)
+    {
+      receiver->states += (guint)rmg_mentry_active_state_from (active_state_str)
+                          + (guint)rmg_mentry_active_substate_from (active_substate_str);
+    }
+
+  return 0;
+}
+
+static gboolean
+server_new_connection (GDBusServer *server, GDBusConnection *connection, gpointer user_data)
+{
+  GDBusConnection **peer = (GDBusConnection **)user_data;
+
+  RMG_UNUSED (server);
+
+  g_atomic_pointer_set (peer, g_object_ref (connection));
+
+  return TRUE;
+}
+
+static GDBusConnection *
+wait_peer (GDBusConnection **peer)
+{
+  /* the server announces the connection from the main context */
+  while (g_atomic_pointer_get (peer) == NULL)
+    g_main_context_iteration (NULL, FALSE);
+
+  return g_steal_pointer (peer);
+}
+
+static void
+init_receiver (BenchReceiver *receiver)
+{
+  receiver->units = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  receiver->received = 0;
+  receiver->states = 0;
+
+  for (guint i = 0; i < BENCH_UNITS; i++)
+    g_hash_table_add (receiver->units, unit_path (i));
+}
+
+static void
+print_cpu (gint64 cpu_start, guint64 signals)
+{
+  g_print ("%-40s %12" G_GUINT64_FORMAT " ops %10.1f cpu ns/op\n", "", signals,
+           (gdouble)(cpu_time () - cpu_start) / (gdouble)signals);
+}
+
+static void
+run_gdbus (GDBusServer *server, guint64 signals)
+{
+  g_autoptr (GDBusConnection) client = NULL;
+  g_autoptr (GDBusConnection) emitter = NULL;
+  g_autoptr (GError) error = NULL;
+  GDBusConnection *peer = NULL;
+  BenchReceiver receiver;
+  gint64 cpu_start = 0;
+  gulong handler = 0;
+  guint subscription = 0;
+  RmgBench bench;
+
+  handler = g_signal_connect (server, "new-connection", G_CALLBACK (server_new_connection), &peer);
+  client = g_dbus_connection_new_for_address_sync (g_dbus_server_get_client_address (server),
+                                                   G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                                   NULL, NULL, &error);
+  if (client == NULL)
+    g_error ("Cannot connect the GDBus receiver. Error %s", error->message);
+
+  emitter = wait_peer (&peer);
+  g_signal_handler_disconnect (server, handler);
+
+  init_receiver (&receiver);
+  subscription = g_dbus_connection_signal_subscribe (
+      client, NULL, "org.freedesktop.DBus.Properties", "PropertiesChanged", NULL,
+      "org.freedesktop.systemd1.Unit", G_DBUS_SIGNAL_FLAGS_NONE, gdbus_properties_changed,
+      &receiver, NULL);
+
+  cpu_start = cpu_time ();
+  rmg_bench_start (&bench, "PropertiesChanged storm, GDBus", signals);
+
+  emit_storm (emitter, signals);
+  while (receiver.received < signals)
+    g_main_context_iteration (NULL, TRUE);
+
+  rmg_bench_stop (&bench);
+  print_cpu (cpu_start, signals);
+
+  g_dbus_connection_signal_unsubscribe (client, subscription);
+  g_dbus_connection_close_sync (client, NULL, NULL);
+  g_dbus_connection_close_sync (emitter, NULL, NULL);
+  g_hash_table_destroy (receiver.units);
+}
+
+static void
+run_sdbus (GDBusServer *server, guint64 signals)
+{
+  g_autoptr (GDBusConnection) emitter = NULL;
+  GDBusConnection *peer = NULL;
+  sd_bus_slot *slot = NULL;
+  sd_bus *bus = NULL;
+  BenchReceiver receiver;
+  gint64 cpu_start = 0;
+  gulong handler = 0;
+  RmgBench bench;
+  gint r;
+
+  handler = g_signal_connect (server, "new-connection", G_CALLBACK (server_new_connection), &peer);
+
+  /* a peer connection so no bus daemon is needed, matches are filtered locally */
+  if ((r = sd_bus_new (&bus)) < 0
+      || (r = sd_bus_set_address (bus, g_dbus_server_get_client_address (server))) < 0
+      || (r = sd_bus_start (bus)) < 0)
+    g_error ("Cannot connect the sd-bus receiver. Error %s", g_strerror (-r));
+
+  emitter = wait_peer (&peer);
+  g_signal_handler_disconnect (server, handler);
+
+  init_receiver (&receiver);
+  r = sd_bus_add_match (bus, &slot,
+                        "type='signal',"
+                        "interface='org.freedesktop.DBus.Properties',"
+                        "member='PropertiesChanged',"
+                        "arg0='org.freedesktop.systemd1.Unit'",
+                        sdbus_properties_changed, &receiver);
+  if (r < 0)
+    g_error ("Cannot add the sd-bus match. Error %s", g_strerror (-r));
+
+  cpu_start = cpu_time ();
+  rmg_bench_start (&bench, "PropertiesChanged storm, sd-bus", signals);
+
+  emit_storm (emitter, signals);
+  while (receiver.received < signals)
+    {
+      r = sd_bus_process (bus, NULL);
+      if (r < 0)
+        g_error ("sd-bus processing failed. Error %s", g_strerror (-r));
+
+      if (r == 0)
+        sd_bus_wait (bus, G_MAXUINT64);
+    }
+
+  rmg_bench_stop (&bench);
+  print_cpu (cpu_start, signals);
+
+  sd_bus_slot_unref (slot);
+  sd_bus_flush_close_unref (bus);
+  g_dbus_connection_close_sync (emitter, NULL, NULL);
+  g_hash_table_destroy (receiver.units);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  guint64 signals = rmg_bench_ops_from (argc, argv, 100000);
+  g_autofree gchar *guid = g_dbus_generate_guid ();
+  g_autofree gchar *dir = g_dir_make_tmp ("rmg-bench-XXXXXX", NULL);
+  g_autofree gchar *address = NULL;
+  g_autoptr (GDBusServer) server = NULL;
+  g_autoptr (GError) error = NULL;
+
+  if (dir == NULL)
+    g_error ("Cannot create the benchmark directory");
+
+  address = g_strdup_printf ("unix:tmpdir=%s", dir);
+  server = g_dbus_server_new_sync (address, G_DBUS_SERVER_FLAGS_NONE, guid, NULL, NULL, &error);
+  if (server == NULL)
+    g_error ("Cannot create the D-Bus server. Error %s", error->message);
+
+  g_dbus_server_start (server);
+
+  /* the emitting side costs the same for both, the difference is the receiving backend */
+  run_gdbus (server, signals);
+  run_sdbus (server, signals);
+
+  g_dbus_server_stop (server);
+  g_rmdir (dir);
+
+  return EXIT_SUCCESS;
+}
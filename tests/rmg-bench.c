@@ -0,0 +1,62 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-bench.c
+ */
+
+#include "rmg-bench.h"
+
+guint64
+rmg_bench_ops_from (gint argc, gchar *argv[], guint64 fallback)
+{
+  guint64 ops = 0;
+
+  if (argc > 1)
+    ops = g_ascii_strtoull (argv[1], NULL, 10);
+
+  return ops > 0 ? ops : fallback;
+}
+
+void
+rmg_bench_start (RmgBench *bench, const gchar *name, guint64 ops)
+{
+  g_assert (bench);
+  g_assert (name);
+
+  bench->name = name;
+  bench->ops = ops > 0 ? ops : 1;
+  bench->start_time = g_get_monotonic_time ();
+}
+
+gdouble
+rmg_bench_stop (RmgBench *bench)
+{
+  gint64 elapsed = 0;
+  gdouble per_op = 0;
+
+  g_assert (bench);
+
+  elapsed = g_get_monotonic_time () - bench->start_time;
+  per_op = (gdouble)elapsed * 1000.0 / (gdouble)bench->ops;
+
+  g_print ("%-40s %12" G_GUINT64_FORMAT " ops %10.1f ns/op\n", bench->name, bench->ops, per_op);
+
+  return per_op;
+}
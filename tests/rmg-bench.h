@@ -0,0 +1,65 @@
+/*
+ * SPDX license identifier: GPL-2.0-or-later
+ *
+ * Copyright (C) 2019-2020 Alin Popa
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * \author Alin Popa <alin.popa@fxdata.ro>
+ * \file rmg-bench.h
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * @struct RmgBench
+ * @brief A timed benchmark case
+ */
+typedef struct _RmgBench
+{
+  const gchar *name; /**< Case name printed with the result */
+  guint64 ops;       /**< Operations run by the case */
+  gint64 start_time; /**< Monotonic time the case started */
+} RmgBench;
+
+/**
+ * @brief Get the operation count from the first program argument
+ * @param argc The program argument count
+ * @param argv The program arguments
+ * @param fallback The count used without an argument
+ * @return The operation count
+ */
+guint64 rmg_bench_ops_from (gint argc, gchar *argv[], guint64 fallback);
+
+/**
+ * @brief Start a benchmark case
+ * @param bench Pointer to the benchmark case
+ * @param name The case name
+ * @param ops The operations the case runs
+ */
+void rmg_bench_start (RmgBench *bench, const gchar *name, guint64 ops);
+
+/**
+ * @brief Stop a benchmark case and print the time per operation
+ * @param bench Pointer to the benchmark case
+ * @return The time per operation in nanoseconds
+ */
+gdouble rmg_bench_stop (RmgBench *bench);
+
+G_END_DECLS